@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2024
+// SPDX-FileCopyrightText: Gabriel Marcano, 2024 - 2026
 /// @file
 
 #ifndef LWIPOPTS_H_
@@ -24,9 +24,21 @@
 #endif
 
 #define MEM_ALIGNMENT               4
-#define MEM_SIZE                    4000
+// mbedTLS allocates from the lwIP heap too, and a TLS connection needs
+// around 12 KiB while handshaking, so leave room for three along with the
+// usual 4000 bytes for lwIP itself
+#define MEM_SIZE                    (4000 + 3 * 12 * 1024)
 #define MEMP_NUM_TCP_SEG            32
 #define MEMP_NUM_ARP_QUEUE          10
+// Sockets are only used by NTP and the syslog shipper, the servers are on
+// the raw API
+#define MEMP_NUM_NETCONN            8
+// The request and HTTP servers' listening PCBs and connections, and MQTT,
+// with some room to spare for connections closing
+#define MEMP_NUM_TCP_PCB            12
+// DHCP, DHCPv6, DNS, NTP, the UDP request server, Wake-on-LAN, and the
+// syslog shipper
+#define MEMP_NUM_UDP_PCB            7
 #define PBUF_POOL_SIZE              24
 #define LWIP_ARP                    1
 #define LWIP_ETHERNET               1
@@ -49,6 +61,14 @@
 #define LWIP_CHKSUM_ALGORITHM       3
 #define LWIP_DHCP                   1
 #define LWIP_IPV4                   1
+// Dual-stack, with addresses from SLAAC and DNS servers from stateless DHCPv6
+#define LWIP_IPV6                   1
+#define LWIP_IPV6_AUTOCONFIG        1
+#define LWIP_IPV6_MLD               1
+#define LWIP_IPV6_SEND_ROUTER_SOLICIT 1
+#define LWIP_IPV6_DHCP6             1
+#define LWIP_IPV6_DHCP6_STATELESS   1
+#define LWIP_ND6_RDNSS_MAX_DNS_SERVERS 1
 #define LWIP_TCP                    1
 #define LWIP_UDP                    1
 #define LWIP_DNS                    1
@@ -56,8 +76,23 @@
 #define LWIP_NETIF_TX_SINGLE_PBUF   1
 #define DHCP_DOES_ARP_CHECK         0
 #define LWIP_DHCP_DOES_ACD_CHECK    0
+// The request handler deadline tick and the MQTT client cyclic timer
+#define MEMP_NUM_SYS_TIMEOUT        (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 2)
+// TLS for the request server, through altcp. Session tickets let returning
+// clients skip the public key operations of a full handshake, without
+// keeping any state per session on our side.
+#define LWIP_ALTCP                  1
+#define LWIP_ALTCP_TLS              1
+#define LWIP_ALTCP_TLS_MBEDTLS      1
+#define ALTCP_MBEDTLS_USE_SESSION_TICKETS 1
+#define ALTCP_MBEDTLS_SESSION_TICKET_TIMEOUT_SECONDS (24 * 60 * 60)
+// Retained state topics, status, health, and command results can all be in
+// flight at once after (re)connecting
+#define MQTT_REQ_MAX_IN_FLIGHT      8
 
-#define TCPIP_THREAD_STACKSIZE 1024
+// Requests and TLS handshakes are handled from the lwIP thread, so it needs
+// room for them
+#define TCPIP_THREAD_STACKSIZE 6144
 #define DEFAULT_THREAD_STACKSIZE 1024
 #define DEFAULT_RAW_RECVMBOX_SIZE 8
 #define DEFAULT_UDP_RECVMBOX_SIZE 8
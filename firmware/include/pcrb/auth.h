@@ -0,0 +1,139 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_AUTH_H_
+#define PCRB_AUTH_H_
+
+#include <pcrb/protocol.h>
+#include <pcrb/sha256.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <expected>
+#include <span>
+
+namespace pcrb
+{
+
+/// Value of the 4 byte magic field that starts an authenticated request.
+constexpr const uint32_t authenticated_magic = 0x416E6141;
+
+/// Bytes an authenticated request adds around the request body.
+constexpr const std::size_t auth_overhead = 4 + 8 + sha256::digest_size;
+
+/** Why a request failed authentication, the value of an
+ * response_status::unauthorized response.
+ */
+enum class auth_failure : uint32_t
+{
+	/// The request was not authenticated, but a key is configured.
+	missing = 0,
+	/// The tag did not match, or no key is configured.
+	bad_tag = 1,
+	/// The counter was already used, or is too old to tell.
+	replayed = 2,
+};
+
+/** Sliding window of the request counters seen, to reject replays.
+ *
+ * Counters above the highest seen so far are always new. Counters up to
+ * window_size below it are accepted once each, so datagrams can arrive out
+ * of order, and older ones are rejected.
+ */
+class replay_window
+{
+public:
+	/// Number of counters tracked below the highest seen.
+	static constexpr uint64_t window_size = 64;
+
+	constexpr replay_window()
+	:highest_(0), seen_(0)
+	{}
+
+	/** Checks whether a counter is new, and remembers it if it is.
+	 *
+	 * @param[in] counter Counter of a request whose tag has been verified.
+	 *
+	 * @returns True if the counter had not been seen before.
+	 */
+	constexpr bool accept(uint64_t counter)
+	{
+		if (counter > highest_)
+		{
+			uint64_t shift = counter - highest_;
+			seen_ = shift >= window_size ? 0 : seen_ << shift;
+			// Bit 0 is the highest counter itself
+			seen_ |= 1;
+			highest_ = counter;
+			return true;
+		}
+
+		uint64_t age = highest_ - counter;
+		if (age >= window_size || (seen_ & (uint64_t(1) << age)))
+			return false;
+		seen_ |= uint64_t(1) << age;
+		return true;
+	}
+
+private:
+	uint64_t highest_;
+	uint64_t seen_;
+};
+
+/** Statistics about request authentication.
+ */
+struct auth_stats
+{
+	/// Requests whose tag was checked.
+	uint32_t checked;
+	/// Requests rejected, for any reason.
+	uint32_t rejected;
+	/// Time spent checking tags, in microseconds.
+	uint32_t total_us;
+	/// Cycles taken by the quickest check, counted with SysTick, 0 if no
+	/// check could be counted yet.
+	uint32_t min_cycles;
+	/// Cycles taken by the last check that could be counted, 0 if none.
+	uint32_t last_cycles;
+};
+
+/** Checks whether requests must be authenticated.
+ *
+ * @returns True if AUTH_KEY is set in secrets.h.
+ */
+bool authentication_required();
+
+/** Authenticates a network request.
+ *
+ * An authenticated request is a 4 byte magic field (authenticated_magic), an
+ * 8 byte counter, the usual request body (see decode_request()), and a 32
+ * byte HMAC-SHA256 tag over everything before it, keyed with AUTH_KEY from
+ * secrets.h. The counter, big-endian like every other field, must never be
+ * reused with the same key, see replay_window.
+ *
+ * Requests that are not authenticated are passed through as they are, unless
+ * authentication_required().
+ *
+ * The counters seen are only kept in RAM, so clients should use a counter
+ * that keeps increasing across reboots of the board, like a timestamp.
+ * Requests captured before a reboot can be replayed until a newer one is
+ * received.
+ *
+ * Must only be called from the lwIP thread.
+ *
+ * @param[in] frame Request as received, without any length prefix.
+ *
+ * @returns The request body, or the error response to send back.
+ */
+std::expected<std::span<const std::byte>, response> authenticate(std::span<const std::byte> frame);
+
+/** Gets statistics about request authentication.
+ *
+ * @returns The statistics so far.
+ */
+auth_stats authentication_stats();
+
+}
+
+#endif//PCRB_AUTH_H_
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_BOUNDED_QUEUE_H_
+#define PCRB_BOUNDED_QUEUE_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace pcrb
+{
+
+/** Fixed capacity FIFO queue that drops new items when full.
+ *
+ * Counts the items dropped, so consumers can tell they fell behind. This is
+ * not thread-safe.
+ *
+ * @tparam T Type of the items.
+ * @tparam N Capacity of the queue.
+ */
+template<class T, std::size_t N>
+class bounded_queue
+{
+public:
+	/** Adds an item to the back of the queue.
+	 *
+	 * @param[in] item Item to add.
+	 *
+	 * @returns False if the queue was full and the item was dropped.
+	 */
+	bool push(const T& item)
+	{
+		if (size_ == N)
+		{
+			++dropped_;
+			return false;
+		}
+		items_[(head_ + size_) % N] = item;
+		++size_;
+		return true;
+	}
+
+	/** Gets the item at the front of the queue. The queue must not be
+	 * empty.
+	 *
+	 * @returns The oldest item in the queue.
+	 */
+	const T& front() const
+	{
+		return items_[head_];
+	}
+
+	/** Removes the item at the front of the queue. The queue must not be
+	 * empty.
+	 */
+	void pop()
+	{
+		head_ = (head_ + 1) % N;
+		--size_;
+	}
+
+	/** Removes all items, and resets the dropped item count.
+	 */
+	void clear()
+	{
+		head_ = 0;
+		size_ = 0;
+		dropped_ = 0;
+	}
+
+	bool empty() const
+	{
+		return size_ == 0;
+	}
+
+	std::size_t size() const
+	{
+		return size_;
+	}
+
+	/** Gets the number of items dropped because the queue was full.
+	 *
+	 * @returns Items dropped since the last clear().
+	 */
+	uint32_t dropped() const
+	{
+		return dropped_;
+	}
+
+private:
+	std::array<T, N> items_ = {};
+	std::size_t head_ = 0;
+	std::size_t size_ = 0;
+	uint32_t dropped_ = 0;
+};
+
+}
+
+#endif//PCRB_BOUNDED_QUEUE_H_
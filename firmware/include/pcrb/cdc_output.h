@@ -0,0 +1,124 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_CDC_OUTPUT_H_
+#define PCRB_CDC_OUTPUT_H_
+
+#include <tusb.h>
+
+#include <array>
+#include <cstddef>
+#include <format>
+#include <string_view>
+#include <utility>
+
+namespace pcrb
+{
+
+/** Output sink writing text straight into the USB CDC transmit FIFO.
+ *
+ * Text is gathered a USB packet at a time and handed to the FIFO, so
+ * however much is written, only a packet's worth is held here. When the
+ * FIFO is full, the writer sleeps until the host takes a packet (see
+ * transmitted()). If the host is not connected, or stops reading for a
+ * while, the rest of the output is dropped instead of waiting forever.
+ *
+ * This is not thread-safe, each task writing should have its own.
+ */
+class cdc_output
+{
+public:
+	cdc_output();
+
+	/** Destructor, sends anything still gathered.
+	 */
+	~cdc_output();
+
+	/** Writes text.
+	 *
+	 * @param[in] text Text to write.
+	 */
+	void write(std::string_view text);
+
+	/** Formats text straight into the output, with no intermediate
+	 * string.
+	 *
+	 * @param[in] format std::format style format string.
+	 * @param[in] args Arguments for the format string.
+	 */
+	template<class... Args>
+	void print(std::format_string<Args...> format, Args&&... args)
+	{
+		std::format_to(iterator(*this), format, std::forward<Args>(args)...);
+	}
+
+	/** Sends anything gathered, and asks for the FIFO to be sent without
+	 * waiting for it to fill.
+	 */
+	void flush();
+
+	/** Wakes up the writer waiting for room, if any.
+	 *
+	 * Called from the USB stack whenever a packet has been sent.
+	 */
+	static void transmitted();
+
+	cdc_output(const cdc_output&) = delete;
+	cdc_output& operator=(const cdc_output&) = delete;
+
+private:
+	// Output iterator for std::format_to()
+	class iterator
+	{
+	public:
+		using difference_type = std::ptrdiff_t;
+
+		explicit iterator(cdc_output& output)
+		:output_(&output)
+		{}
+
+		iterator& operator*()
+		{
+			return *this;
+		}
+
+		iterator& operator=(char c)
+		{
+			output_->put(c);
+			return *this;
+		}
+
+		iterator& operator++()
+		{
+			return *this;
+		}
+
+		iterator operator++(int)
+		{
+			return *this;
+		}
+
+	private:
+		cdc_output *output_;
+	};
+
+	void put(char c)
+	{
+		chunk_[size_++] = c;
+		if (size_ == chunk_.size())
+			send();
+	}
+
+	/// Hands the chunk to the FIFO, waiting for room as needed
+	void send();
+
+	std::array<char, CFG_TUD_CDC_EP_BUFSIZE> chunk_;
+	std::size_t size_;
+	/// Set once output is being dropped
+	bool dropping_;
+};
+
+}
+
+#endif//PCRB_CDC_OUTPUT_H_
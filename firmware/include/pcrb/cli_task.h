@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2024
+// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2026
 /// @file
 
 #ifndef PCRB_CLI_TASK_H_
@@ -8,8 +8,20 @@
 namespace pcrb
 {
 
+/** Command line over the USB CDC interface.
+ *
+ * Sleeps until cli_input_ready() is called, and then handles everything
+ * received so far, a USB packet at a time.
+ */
 void cli_task(void*);
 
+/** Wakes the CLI task up to read input.
+ *
+ * Called from the USB stack whenever the CDC interface receives data. Does
+ * nothing if the CLI task is not running yet.
+ */
+void cli_input_ready();
+
 }
 
 #endif//PCRB_CLI_TASK_H_
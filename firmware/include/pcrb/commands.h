@@ -0,0 +1,208 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_COMMANDS_H_
+#define PCRB_COMMANDS_H_
+
+#include <pcrb/protocol.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <span>
+#include <string_view>
+
+namespace pcrb
+{
+
+/** Argument schema of a command.
+ */
+enum class argument_type : uint8_t
+{
+	/// No argument. Network requests are 8 bytes long.
+	none,
+	/// A 32 bit unsigned argument. Network requests are 12 bytes long, CLI
+	/// commands take it as a decimal number after the name.
+	u32,
+};
+
+/** Command shared by the network and CLI front ends.
+ *
+ * All commands live in a single constant table (see commands.cpp), from which
+ * the lookups by name and by opcode are generated at compile time.
+ */
+struct command
+{
+	/// Name used by the CLI.
+	std::string_view name;
+	/// Opcode used by network requests.
+	opcode code;
+	/// Argument the command takes.
+	argument_type argument;
+	/// Runs the command with the given argument, 0 if it takes none.
+	response (*run)(uint32_t argument);
+	/// std::format string of the text reply, where {0} is the argument and
+	/// {1} the payload of the response.
+	std::string_view text;
+};
+
+/// Largest number of steps in a batch request.
+constexpr const std::size_t max_batch_steps = 16;
+
+/// Size of a single batch step: a 4 byte opcode and a 4 byte argument, which
+/// is ignored for commands without one.
+constexpr const std::size_t batch_step_size = 8;
+
+/** Looks up a command by its CLI name.
+ *
+ * @param[in] name Name of the command.
+ *
+ * @returns The command, or nullptr if there is none with that name.
+ */
+const command* find_command(std::string_view name);
+
+/** Looks up a command by its network opcode.
+ *
+ * @param[in] code Opcode of the command.
+ *
+ * @returns The command, or nullptr if there is none with that opcode.
+ */
+const command* find_command(opcode code);
+
+/** Runs a command.
+ *
+ * Commands from all front ends are serialized, so a command never runs in
+ * the middle of another front end's batch. If another command or batch does
+ * not finish soon enough, the command is not run and is busy instead.
+ *
+ * This may wait, so it must not be called from the lwIP thread, see
+ * try_execute().
+ *
+ * @param[in] command_ Command to run.
+ * @param[in] argument Argument of the command, 0 if it takes none.
+ *
+ * @returns The response of the command.
+ */
+response execute(const command& command_, uint32_t argument);
+
+/** Runs a command, unless another command or batch is running.
+ *
+ * As execute(), but busy right away instead of waiting, for callers on the
+ * lwIP thread, which every connection waits on.
+ *
+ * @param[in] command_ Command to run.
+ * @param[in] argument Argument of the command, 0 if it takes none.
+ *
+ * @returns The response of the command.
+ */
+response try_execute(const command& command_, uint32_t argument);
+
+/** Gets the network request size expected for a command.
+ *
+ * @param[in] command_ Command to check.
+ *
+ * @returns Size of the request body, including magic and opcode.
+ */
+std::size_t request_size(const command& command_);
+
+/** Formats the text reply of a command.
+ *
+ * @param[in] command_ Command that was run.
+ * @param[in] argument Argument the command was run with.
+ * @param[in] result Response returned by the command.
+ * @param[out] output Where to format the text, max_description_size is
+ *  always enough.
+ *
+ * @returns The text reply.
+ */
+std::string_view describe(const command& command_, uint32_t argument, const response& result, std::span<char> output);
+
+/** Reply to a request, with what is needed to format its text form later,
+ * if at all.
+ */
+struct reply
+{
+	response binary;
+	/// Command that was run, nullptr if the request failed before that
+	const command *command_;
+	/// Argument the command was run with
+	uint32_t argument;
+};
+
+/** Formats the text form of a reply.
+ *
+ * @param[in] reply_ Reply to describe.
+ * @param[out] output Where to format the text, max_description_size is
+ *  always enough.
+ *
+ * @returns The text reply.
+ */
+std::string_view describe(const reply& reply_, std::span<char> output);
+
+/** Runs a decoded network request through the command table.
+ *
+ * Called from the lwIP thread, so the command is busy if another is
+ * running, see try_execute().
+ *
+ * @param[in] request_ Decoded request.
+ *
+ * @returns The reply of the command, or an error reply if there is no such
+ *  command or the request has the wrong size for it.
+ */
+reply run_request(const request& request_);
+
+/** Reply to a batch request.
+ *
+ * The binary form is a response for the batch itself, with the number of
+ * steps run as its u32 payload, followed by the response of every step run,
+ * in order.
+ */
+struct batch_reply
+{
+	std::array<std::byte, response::max_size * (max_batch_steps + 1)> buffer;
+	std::size_t size;
+	/// Response for the batch itself
+	response batch;
+	/// Number of steps in the request, 0 if it was malformed
+	std::size_t steps;
+	/// Reply of every step run, batch.value of them
+	std::array<reply, max_batch_steps> replies;
+
+	/** Gets the binary form of the reply.
+	 *
+	 * @returns The part of buffer holding the encoded reply.
+	 */
+	std::span<const std::byte> binary() const;
+};
+
+/** Formats the text form of a batch reply, the reply of every step run
+ * after a summary of the batch.
+ *
+ * @param[in] reply_ Reply to describe.
+ * @param[out] output Where to format the text. It is truncated if it does
+ *  not fit.
+ *
+ * @returns The text reply.
+ */
+std::string_view describe(const batch_reply& reply_, std::span<char> output);
+
+/** Runs a batch request.
+ *
+ * The payload of the request is a list of steps (see batch_step_size), run
+ * in order without any other command running in between. The batch stops at
+ * the first step that fails, and the status of the batch is then that of the
+ * failed step.
+ *
+ * A toggle step waits for the switch to be released before the next step
+ * runs, so this may block for as long as the presses take. It must not be
+ * called from the lwIP thread.
+ *
+ * @param[in] request_ Decoded batch request.
+ * @param[out] result Reply to the batch.
+ */
+void run_batch(const request& request_, batch_reply& result);
+
+}
+
+#endif//PCRB_COMMANDS_H_
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_COROUTINE_H_
+#define PCRB_COROUTINE_H_
+
+#include <array>
+#include <bitset>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <new>
+
+namespace pcrb
+{
+
+/** Fixed pool of equally sized memory blocks, for coroutine frames.
+ *
+ * Coroutine frames would otherwise come from the heap. Keeping them in a
+ * fixed pool bounds how much memory they can take, and makes running out of
+ * them an ordinary, recoverable error.
+ *
+ * This is not thread-safe, all users must run from the same thread.
+ *
+ * @tparam BlockSize Size of each block, in bytes.
+ * @tparam Count Number of blocks.
+ */
+template<std::size_t BlockSize, std::size_t Count>
+class frame_pool
+{
+public:
+	/** Allocates a block.
+	 *
+	 * @param[in] size Size requested, must be at most BlockSize.
+	 *
+	 * @returns A pointer to the block, or nullptr if size is too large or
+	 *  there are no free blocks.
+	 */
+	void* allocate(std::size_t size) noexcept
+	{
+		if (size > BlockSize)
+			return nullptr;
+		for (std::size_t i = 0; i < Count; ++i)
+		{
+			if (!used_[i])
+			{
+				used_[i] = true;
+				return blocks_[i].data();
+			}
+		}
+		return nullptr;
+	}
+
+	/** Returns a block to the pool.
+	 *
+	 * @param[in] block Block previously returned by allocate().
+	 */
+	void deallocate(void *block) noexcept
+	{
+		std::size_t index = (static_cast<std::byte*>(block) - blocks_[0].data()) / BlockSize;
+		used_[index] = false;
+	}
+
+private:
+	alignas(std::max_align_t) std::array<std::array<std::byte, BlockSize>, Count> blocks_;
+	std::bitset<Count> used_;
+};
+
+/** Fire-and-forget coroutine, with its frame taken from a frame_pool.
+ *
+ * The coroutine starts running as soon as it is called, and its frame is
+ * released once it runs to completion. Whoever resumes it must therefore
+ * keep resuming it until it completes.
+ *
+ * If the pool has no room for the frame, the coroutine never runs and the
+ * returned object evaluates to false.
+ *
+ * @tparam Pool frame_pool to allocate frames from.
+ */
+template<auto& Pool>
+class coroutine
+{
+public:
+	struct promise_type
+	{
+		coroutine get_return_object() noexcept
+		{
+			return coroutine(true);
+		}
+
+		static coroutine get_return_object_on_allocation_failure() noexcept
+		{
+			return coroutine(false);
+		}
+
+		std::suspend_never initial_suspend() noexcept
+		{
+			return {};
+		}
+
+		std::suspend_never final_suspend() noexcept
+		{
+			return {};
+		}
+
+		void return_void() noexcept
+		{}
+
+		void unhandled_exception() noexcept
+		{
+			std::terminate();
+		}
+
+		static void* operator new(std::size_t size) noexcept
+		{
+			return Pool.allocate(size);
+		}
+
+		static void operator delete(void *frame) noexcept
+		{
+			Pool.deallocate(frame);
+		}
+	};
+
+	/** Checks whether the coroutine could be started.
+	 *
+	 * @returns False if there was no room in the pool for the coroutine.
+	 */
+	explicit operator bool() const
+	{
+		return started_;
+	}
+
+private:
+	explicit coroutine(bool started)
+	:started_(started)
+	{}
+
+	bool started_;
+};
+
+}
+
+#endif//PCRB_COROUTINE_H_
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_FLASH_LOG_STORAGE_H_
+#define PCRB_FLASH_LOG_STORAGE_H_
+
+#include <hardware/flash.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace pcrb
+{
+
+/** Log storage in the flash left over after the firmware image, see
+ * pcrb::persistent_log_storage.
+ *
+ * The region is at the very end of flash, as far from the image as it can
+ * be, and is sized at construction from where the image ends.
+ *
+ * Writing stalls execution from flash on both cores while the sector is
+ * erased and programmed, tens of milliseconds. The other core is parked
+ * through flash_safe_execute() for it.
+ */
+class flash_log_storage
+{
+public:
+	static constexpr std::size_t sector_size = FLASH_SECTOR_SIZE;
+
+	/// Most sectors used, so growing the image does not run into the log
+	/// right away
+	static constexpr std::size_t max_sectors = 32;
+
+	flash_log_storage();
+
+	std::size_t sectors() const;
+
+	void read(std::size_t sector, std::size_t offset, std::span<std::byte> output) const;
+
+	bool write(std::size_t sector, std::span<const std::byte> data);
+
+private:
+	/// Offset from the start of flash of the first sector
+	uint32_t offset_;
+	std::size_t sectors_;
+};
+
+}
+
+#endif//PCRB_FLASH_LOG_STORAGE_H_
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_FORMAT_FIXED_H_
+#define PCRB_FORMAT_FIXED_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace pcrb
+{
+
+/** Formats text into a fixed buffer, truncating it if it does not fit.
+ *
+ * Nothing is allocated, unlike with std::format.
+ *
+ * @param[out] output Buffer to format into.
+ * @param[in] format Format string, checked when the text is formatted.
+ * @param[in] args Arguments for the format string, see std::make_format_args.
+ *
+ * @returns The text, in output. It is not NUL terminated.
+ */
+inline std::string_view vformat_fixed(std::span<char> output, std::string_view format, std::format_args args)
+{
+	// Output iterator that drops whatever does not fit. Copies share the
+	// position, as the formatting functions copy iterators around freely.
+	class bounded
+	{
+	public:
+		using difference_type = std::ptrdiff_t;
+
+		explicit bounded(std::span<char>& rest)
+		:rest_(&rest)
+		{}
+
+		bounded& operator*()
+		{
+			return *this;
+		}
+
+		bounded& operator=(char c)
+		{
+			if (!rest_->empty())
+			{
+				rest_->front() = c;
+				*rest_ = rest_->subspan(1);
+			}
+			return *this;
+		}
+
+		bounded& operator++()
+		{
+			return *this;
+		}
+
+		bounded operator++(int)
+		{
+			return *this;
+		}
+
+	private:
+		std::span<char> *rest_;
+	};
+
+	std::span<char> rest = output;
+	std::vformat_to(bounded(rest), format, args);
+	return std::string_view(output.data(), output.size() - rest.size());
+}
+
+/** Formats text into a fixed buffer, truncating it if it does not fit.
+ *
+ * Nothing is allocated, unlike with std::format.
+ *
+ * @param[out] output Buffer to format into.
+ * @param[in] format std::format style format string.
+ * @param[in] args Arguments for the format string.
+ *
+ * @returns The text, in output. It is not NUL terminated.
+ */
+template<class... Args>
+std::string_view format_fixed(std::span<char> output, std::format_string<Args...> format, Args&&... args)
+{
+	auto result = std::format_to_n(output.data(), output.size(), format, std::forward<Args>(args)...);
+	return std::string_view(output.data(), std::min<std::size_t>(result.size, output.size()));
+}
+
+}
+
+#endif//PCRB_FORMAT_FIXED_H_
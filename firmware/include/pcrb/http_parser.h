@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HTTP_PARSER_H_
+#define PCRB_HTTP_PARSER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace pcrb
+{
+
+/** Incremental HTTP/1.1 request parser.
+ *
+ * Requests are parsed as their bytes arrive, in pieces of any size, so
+ * received buffers can be fed in place. Only the request target and the few
+ * headers the server cares about (Connection, Content-Length, and
+ * Transfer-Encoding) are kept, in fixed buffers inside the parser, so it
+ * never allocates. Bodies are skipped.
+ *
+ * Parsing is lenient about line endings, a bare LF ends a line as well as
+ * CRLF does, and empty lines before the request line are ignored.
+ */
+class http_parser
+{
+public:
+	/// Longest request target kept, longer ones are rejected with 414.
+	static constexpr std::size_t max_target_size = 64;
+	/// Largest request line and headers, larger ones are rejected with 431.
+	static constexpr std::size_t max_header_size = 1024;
+	/// Largest body skipped, larger ones are rejected with 413.
+	static constexpr std::size_t max_body_size = 1024;
+
+	/// Request methods understood.
+	enum class method : uint8_t
+	{
+		unknown,
+		get,
+		post,
+		put,
+	};
+
+	/// Progress parsing the current request.
+	enum class status : uint8_t
+	{
+		incomplete,
+		complete,
+		error,
+	};
+
+	http_parser();
+
+	/** Gets ready to parse the next request.
+	 */
+	void reset();
+
+	/** Parses more of the request.
+	 *
+	 * Stops at the end of the request, or at the first error, so the caller
+	 * can handle it before feeding the rest of the data.
+	 *
+	 * @param[in] data Received bytes.
+	 *
+	 * @returns The number of bytes used.
+	 */
+	std::size_t feed(std::span<const char> data);
+
+	/** Gets the progress parsing the current request.
+	 *
+	 * @returns Whether the request is complete, invalid, or still
+	 *  incomplete.
+	 */
+	status state() const;
+
+	/** Gets the HTTP status code to reply to an invalid request with.
+	 *
+	 * @returns An HTTP status code, only meaningful if state() is
+	 *  status::error.
+	 */
+	unsigned error_code() const;
+
+	/** Checks whether any of the current request has been received.
+	 *
+	 * @returns True if at least one byte was fed since the last reset().
+	 */
+	bool started() const;
+
+	method request_method() const;
+
+	/** Gets the request target, including any query.
+	 *
+	 * @returns The target, valid until the next reset().
+	 */
+	std::string_view target() const;
+
+	/** Checks whether the client wants the connection kept open.
+	 *
+	 * @returns True for HTTP/1.1 requests, unless they asked to close the
+	 *  connection, and for HTTP/1.0 ones asking for keep-alive.
+	 */
+	bool keep_alive() const;
+
+private:
+	enum class step : uint8_t
+	{
+		method,
+		target,
+		version,
+		line_start,
+		header_name,
+		header_value,
+		body,
+		done,
+		error,
+	};
+
+	enum class header : uint8_t
+	{
+		other,
+		connection,
+		content_length,
+		transfer_encoding,
+	};
+
+	bool accumulate(char c);
+	void fail(unsigned code);
+	void end_method();
+	void end_version();
+	void end_header_name();
+	void end_header_value();
+	void end_headers();
+
+	std::array<char, max_target_size> target_;
+	std::size_t target_size_;
+	/// Method, version, header name, or header value being received
+	std::array<char, 32> token_;
+	std::size_t token_size_;
+	bool token_overflow_;
+	std::size_t header_bytes_;
+	std::size_t body_left_;
+	unsigned error_code_;
+	step step_;
+	header header_;
+	method method_;
+	bool keep_alive_;
+	bool started_;
+};
+
+}
+
+#endif//PCRB_HTTP_PARSER_H_
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HTTP_SERVER_H_
+#define PCRB_HTTP_SERVER_H_
+
+#include <cstdint>
+
+#include <lwip/tcp.h>
+
+namespace pcrb
+{
+
+/** Small HTTP/1.1 control server, built on the lwIP raw TCP API.
+ *
+ * Runs the shared commands (see pcrb::command) for tools that only speak
+ * HTTP:
+ *  - GET /sense
+ *  - POST /toggle?value=<ms>
+ *  - GET /boot, and PUT or POST /boot?value=<select>
+ *
+ * Replies are JSON objects with the command, its status, and its value, if
+ * any. Once requests must be authenticated (see pcrb::authenticate()), only
+ * the GET routes are served, as HTTP requests can't be. Connections are
+ * kept alive as HTTP/1.1 asks for, and pipelined requests are answered in
+ * order. Requests are parsed in place from the received pbufs (see
+ * pcrb::http_parser), all from the lwIP thread.
+ *
+ * Listens on a single dual-stack PCB, so IPv4 and IPv6 clients are served
+ * alike.
+ */
+class http_server
+{
+public:
+	/** Constructor.
+	 *
+	 * Does not start listening, see listen().
+	 */
+	http_server();
+
+	/** Destructor.
+	 *
+	 * Stops listening, if listening.
+	 */
+	~http_server();
+
+	/** Starts listening on all IP addresses at the provided port.
+	 *
+	 * @param[in] port Port number to listen at.
+	 *
+	 * @returns 0 on success, an error code otherwise.
+	 */
+	int listen(uint16_t port);
+
+	/** Stops listening.
+	 *
+	 * Established connections are not affected.
+	 */
+	void close();
+
+	http_server(const http_server&) = delete;
+	http_server& operator=(const http_server&) = delete;
+
+private:
+	static err_t accept(void *arg, tcp_pcb *pcb, err_t err);
+
+	tcp_pcb *pcb_;
+};
+
+}
+
+#endif//PCRB_HTTP_SERVER_H_
@@ -0,0 +1,537 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_LOG_H_
+#define PCRB_LOG_H_
+
+#include <pcrb/packed_log.h>
+
+#include <pico/mutex.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+namespace pcrb
+{
+
+enum class log_level : uint8_t
+{
+	debug,
+	info,
+	warning,
+	error,
+};
+
+/** Gets the name of a log level.
+ *
+ * @param[in] level Level to name.
+ *
+ * @returns The name, e.g. "warning".
+ */
+std::string_view log_level_name(log_level level);
+
+/** Format string of a log message, usable as a template argument.
+ *
+ * @tparam N Size of the string, including its terminating NUL.
+ */
+template<std::size_t N>
+struct log_format_string
+{
+	consteval log_format_string(const char (&text)[N])
+	{
+		std::copy_n(text, N, data);
+	}
+
+	constexpr std::string_view view() const
+	{
+		return std::string_view(data, N - 1);
+	}
+
+	char data[N];
+};
+
+/** Everything about a log message that is known at compile time.
+ *
+ * One of these lives in flash for each distinct message, and records only
+ * point at it, so its address doubles as the format ID. A host decoder can
+ * map IDs back to formats with the symbols of the firmware image.
+ */
+struct log_format
+{
+	std::string_view text;
+	log_level level;
+};
+
+template<log_format_string Format, log_level Level>
+inline constexpr log_format log_format_v = { Format.view(), Level };
+
+/// Types arguments are stored as.
+enum class log_arg : uint8_t
+{
+	u32,
+	i32,
+	u64,
+	i64,
+	boolean,
+	string,
+};
+
+/** Gets the type a log argument is rendered as.
+ *
+ * Integers are widened to 32 or 64 bits and anything string-like becomes a
+ * std::string_view.
+ */
+template<class T>
+struct log_value
+{
+	using type = std::string_view;
+};
+
+template<class T>
+	requires std::same_as<T, bool>
+struct log_value<T>
+{
+	using type = bool;
+};
+
+template<std::integral T>
+	requires (!std::same_as<T, bool>)
+struct log_value<T>
+{
+	using type = std::conditional_t<(sizeof(T) > 4),
+		std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>,
+		std::conditional_t<std::is_signed_v<T>, int32_t, uint32_t>>;
+};
+
+template<class T>
+using log_value_t = typename log_value<std::remove_cvref_t<T>>::type;
+
+struct log_line;
+
+/** A log message, with its arguments still in binary form.
+ */
+struct log_entry
+{
+	/// Room for arguments, strings are truncated to fit
+	static constexpr std::size_t args_capacity = 96;
+	/// Longest string argument kept, leaving room for the arguments after it
+	static constexpr std::size_t max_string_size = 64;
+	/// Longest text an entry renders to, including the terminating NUL
+	static constexpr std::size_t max_text_size = 192;
+
+	const log_format *format = nullptr;
+	uint64_t timestamp_us = 0;
+	uint32_t sequence = 0;
+	uint8_t args_size = 0;
+	std::array<std::byte, args_capacity> args;
+
+	log_level level() const
+	{
+		return format ? format->level : log_level::info;
+	}
+
+	/** Adds an argument.
+	 *
+	 * @param[in] value Argument to add. Strings are copied, so they don't
+	 *  need to outlive the entry.
+	 */
+	template<class T>
+	void add(const T& value)
+	{
+		using value_type = log_value_t<T>;
+		if constexpr (std::same_as<value_type, std::string_view>)
+		{
+			std::string_view text = value;
+			if (!room(2))
+				return;
+			text = text.substr(0, std::min(max_string_size, args_capacity - args_size - 2));
+			put(log_arg::string);
+			put(static_cast<uint8_t>(text.size()));
+			put_bytes(text.data(), text.size());
+		}
+		else
+		{
+			if (!room(1 + sizeof(value_type)))
+				return;
+			put(tag<value_type>());
+			value_type converted = static_cast<value_type>(value);
+			put_bytes(&converted, sizeof(converted));
+		}
+	}
+
+	/** Renders the entry as text, the only time its format string is
+	 * looked at.
+	 *
+	 * Arguments that did not fit in the entry are rendered as '?'.
+	 *
+	 * @param[out] output Where to write the text. It is always NUL
+	 *  terminated, and truncated if it does not fit.
+	 *
+	 * @returns Length of the text, not counting the NUL.
+	 */
+	std::size_t render(std::span<char> output) const;
+
+	/** Renders the entry as a line of text, along with the rest of what
+	 * identifies it.
+	 *
+	 * @param[out] line Where to render the entry.
+	 */
+	void render(log_line& line) const;
+
+private:
+	template<class T>
+	static constexpr log_arg tag()
+	{
+		if constexpr (std::same_as<T, uint32_t>)
+			return log_arg::u32;
+		else if constexpr (std::same_as<T, int32_t>)
+			return log_arg::i32;
+		else if constexpr (std::same_as<T, uint64_t>)
+			return log_arg::u64;
+		else if constexpr (std::same_as<T, int64_t>)
+			return log_arg::i64;
+		else
+			return log_arg::boolean;
+	}
+
+	bool room(std::size_t amount) const
+	{
+		return amount <= args_capacity - args_size;
+	}
+
+	void put(auto value)
+	{
+		put_bytes(&value, sizeof(value));
+	}
+
+	void put_bytes(const void *data, std::size_t size)
+	{
+		memcpy(args.data() + args_size, data, size);
+		args_size += size;
+	}
+};
+
+/** A log message rendered to text, as kept across reboots.
+ */
+struct log_line
+{
+	uint32_t sequence = 0;
+	uint64_t timestamp_us = 0;
+	log_level level = log_level::info;
+	/// Length of the text, not counting the NUL
+	uint8_t size = 0;
+	std::array<char, log_entry::max_text_size> text;
+
+	std::string_view view() const
+	{
+		return std::string_view(text.data(), size);
+	}
+};
+
+/** Which messages a log query returns.
+ */
+struct log_filter
+{
+	/// Lowest level returned
+	log_level level = log_level::debug;
+	/// Text the rendered message must contain, anything if empty
+	std::string_view text;
+
+	/** Checks whether a message passes the filter.
+	 *
+	 * @param[in] line Rendered message to check.
+	 *
+	 * @returns True if it passes.
+	 */
+	bool matches(const log_line& line) const;
+};
+
+/** Log of binary records, rendered to text only when read.
+ *
+ * Pushing a message copies its format pointer and raw arguments into a
+ * ring of the core it runs on, so nothing is formatted or allocated by
+ * whoever logs. Each core's ring has a single producer, that core, which
+ * only masks its own interrupts while filling a slot so tasks and handlers
+ * on it can't interleave. Nothing is shared with the other core, so pushing
+ * never waits.
+ *
+ * Readers merge the core rings by timestamp into the log proper, numbering
+ * messages as they go, and then read from it. The log proper keeps messages
+ * packed (see pcrb::packed_log), and once full, new messages overwrite the
+ * oldest. Readers serialise among themselves with a mutex.
+ *
+ * Floods are kept from pushing out everything else in two ways. Each
+ * distinct message (format and level) has a token bucket per core, and
+ * pushes beyond it only bump a counter, reported along with the next
+ * message let through. Consecutive identical messages that do get through
+ * are collapsed into one, followed by a "last message repeated N times".
+ */
+class event_log
+{
+public:
+	/** Constructor.
+	 *
+	 * @param[in] storage Ring to keep packed messages in.
+	 * @param[in] checkpoints Checkpoints into the ring, see
+	 *  pcrb::packed_log.
+	 */
+	event_log(std::span<std::byte> storage, std::span<packed_log::checkpoint> checkpoints);
+
+	/// Messages of the same kind let through back to back
+	static constexpr uint32_t rate_limit_burst = 10;
+
+	/// Time to earn back one message of a kind, once the burst is used up
+	static constexpr uint64_t rate_limit_period_us = 1000000;
+
+	/** Token bucket of a kind of message, one per core.
+	 */
+	struct rate_limit
+	{
+		struct bucket
+		{
+			uint64_t refilled_us = 0;
+			uint32_t tokens = rate_limit_burst;
+			/// Messages turned away since the last one let through
+			uint32_t suppressed = 0;
+		};
+		std::array<bucket, 2> cores;
+	};
+
+	/** Logs a message, unless too many like it were logged lately.
+	 *
+	 * The format is checked against the arguments at compile time, as with
+	 * std::format.
+	 *
+	 * @tparam Format std::format style format string.
+	 * @tparam Level Level of the message.
+	 * @param[in] args Arguments for the format string.
+	 */
+	template<log_format_string Format, log_level Level = log_level::info, class... Args>
+	void push(const Args&... args)
+	{
+		static_assert(sizeof...(Args) <= max_args, "too many log arguments");
+		(void)std::format_string<const log_value_t<Args>&...>(Format.view());
+		// Constant initialised, so there is no guard to check on every push
+		static constinit rate_limit limit;
+		uint32_t suppressed = 0;
+		if (!admit(limit, suppressed))
+			return;
+		if (suppressed)
+		{
+			log_entry note;
+			note.format = &log_format_v<"{} more like the next message were rate limited", Level>;
+			note.add(suppressed);
+			push(note);
+		}
+
+		log_entry entry;
+		entry.format = &log_format_v<Format, Level>;
+		(entry.add(args), ...);
+		push(entry);
+	}
+
+	/** Logs a message built by hand.
+	 *
+	 * Safe to call from interrupt handlers.
+	 *
+	 * @param[in] entry Message to log. Its sequence number and timestamp
+	 *  are filled in by the log.
+	 */
+	void push(const log_entry& entry);
+
+	/** Copies out a message.
+	 *
+	 * @param[in] sequence Sequence number of the message.
+	 * @param[out] entry Where to copy the message to.
+	 *
+	 * @returns False if there is no such message, because it has not been
+	 *  pushed yet or has been overwritten.
+	 */
+	bool read(uint32_t sequence, log_entry& entry);
+
+	/** Gets the sequence number of the oldest message still held.
+	 */
+	uint32_t first();
+
+	/** Gets the sequence number the next message will get.
+	 */
+	uint32_t end();
+
+	/** Gets the number of messages held.
+	 */
+	std::size_t size();
+
+	/** Gets the number of bytes the messages held take.
+	 */
+	std::size_t bytes_used();
+
+	/** Gets the number of messages overwritten in a core ring before a
+	 * reader got to them.
+	 */
+	uint32_t dropped();
+
+	/** Gets the number of messages turned away by rate limiting.
+	 *
+	 * Safe to call from any task.
+	 */
+	uint32_t limited() const;
+
+	/** Gets the number of messages collapsed into the one before them.
+	 */
+	uint32_t repeated();
+
+	/// Most messages query() looks at for one page, so a filter that
+	/// matches little can't keep the caller busy rendering the whole log
+	static constexpr std::size_t query_scan_limit = 64;
+
+	/// Most messages tail() goes back over
+	static constexpr std::size_t tail_scan_limit = 256;
+
+	/** Renders the messages passing a filter, a page at a time.
+	 *
+	 * Messages are rendered on the spot, so filtering on their text costs
+	 * as much as reading them. Those below the level of the filter are
+	 * skipped without rendering them.
+	 *
+	 * @param[in] filter Messages to return.
+	 * @param[in,out] cursor Sequence number to start from, moved past the
+	 *  last message looked at, so the next page starts from there. If the
+	 *  message has been overwritten, the oldest message held is used.
+	 * @param[out] lines Where to render the messages.
+	 *
+	 * @returns The number of messages rendered. It is less than the size of
+	 *  lines if the end of the log was reached, or after looking at
+	 *  query_scan_limit messages, so the end of the log has only been
+	 *  reached once a call leaves cursor where it was.
+	 */
+	std::size_t query(const log_filter& filter, uint32_t& cursor, std::span<log_line> lines);
+
+	/** Finds where the last messages passing a filter start.
+	 *
+	 * @param[in] filter Messages to count.
+	 * @param[in] count Number of messages to go back.
+	 *
+	 * @returns Sequence number of the oldest of the last count messages
+	 *  passing the filter, or of the oldest message looked at if there are
+	 *  not that many within the oldest message held or tail_scan_limit
+	 *  messages back. Usable as the cursor of query().
+	 */
+	uint32_t tail(const log_filter& filter, std::size_t count);
+
+	/// Most arguments a message can have
+	static constexpr std::size_t max_args = 8;
+
+	/// Slots in the ring of each core, which can take one less message than
+	/// this between reads before losing some
+	static constexpr std::size_t core_ring_size = 32;
+
+private:
+	/** Entries pushed by one core.
+	 *
+	 * Only that core writes the slots and head, readers only read them.
+	 */
+	struct core_ring
+	{
+		std::array<log_entry, core_ring_size> entries;
+		/// Number of entries ever pushed, published after the slot is
+		/// filled
+		std::atomic<uint32_t> head = 0;
+		/// Number of entries ever taken by readers
+		uint32_t tail = 0;
+		/// Number of entries turned away by rate limiting, only ever
+		/// written by the core
+		std::atomic<uint32_t> limited = 0;
+	};
+
+	/** Takes a token from the bucket of this core.
+	 *
+	 * @param[in,out] limit Buckets of a kind of message.
+	 * @param[out] suppressed Messages turned away since the last one let
+	 *  through, if this one is.
+	 *
+	 * @returns True if the message should be logged.
+	 */
+	bool admit(rate_limit& limit, uint32_t& suppressed);
+
+	/** Adds an entry to the log proper, collapsing repeats. The reader lock
+	 * must be held.
+	 */
+	void append(const log_entry& entry);
+
+	/** Adds the count of repeats of the last entry, if any. The reader lock
+	 * must be held.
+	 */
+	void end_repeats();
+
+	/** Moves everything pushed to the core rings into the log. The reader
+	 * lock must be held.
+	 */
+	void collect();
+
+	/** Takes the oldest entry of a core ring not yet collected. The reader
+	 * lock must be held.
+	 *
+	 * @param[in,out] ring Ring to take from.
+	 * @param[in] until Head of the ring to stop at.
+	 * @param[out] entry Where to copy the entry to.
+	 *
+	 * @returns False if there is nothing before until.
+	 */
+	bool take(core_ring& ring, uint32_t until, log_entry& entry);
+
+	std::array<core_ring, 2> cores_;
+	packed_log entries_;
+	uint32_t dropped_;
+	/// Last entry added to the log proper, to spot repeats
+	log_entry last_;
+	/// Repeats of last_ not added yet
+	uint32_t repeats_;
+	uint64_t first_repeat_us_;
+	uint64_t last_repeat_us_;
+	uint32_t repeated_;
+	mutex_t lock_;
+};
+
+extern event_log sys_log;
+
+/** Echoes new log messages to stdout, rendering them as it goes.
+ *
+ * Everything echoed is also appended to the persistent log in flash, which
+ * is written a sector at a time: when a sector's worth has been gathered,
+ * soon after an error is logged, or after a while without either.
+ */
+void log_task(void*);
+
+/** Writes out messages gathered for the persistent log, so they survive a
+ * reboot that is about to happen.
+ *
+ * Messages the log task has not got to yet are not included.
+ */
+void persist_log();
+
+/** Reads messages persisted during the previous boot, oldest first.
+ *
+ * The previous boot is the newest one before the current boot that left
+ * anything in flash.
+ *
+ * @param[in] first Number of messages to skip.
+ * @param[out] lines Where to copy the messages to.
+ *
+ * @returns The number of messages copied, less than the size of lines only
+ *  if there are no more.
+ */
+std::size_t read_previous_boot_log(std::size_t first, std::span<log_line> lines);
+
+}
+
+#endif//PCRB_LOG_H_
@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_LOG_STORAGE_H_
+#define PCRB_LOG_STORAGE_H_
+
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+namespace pcrb
+{
+
+/** Storage the persistent log is kept in, a number of equally sized sectors
+ * that can only be written whole.
+ *
+ * Requirements:
+ *  - T::sector_size, size of a sector in bytes, usable at compile time.
+ *  - sectors(), number of sectors available.
+ *  - read(sector, offset, output), fills output with what is stored at
+ *    offset in the sector.
+ *  - write(sector, data), replaces the contents of a sector with data, which
+ *    is sector_size bytes. Returns false on failure.
+ *
+ * Erased (never written) storage reads as 0xFF.
+ */
+template<class T>
+concept persistent_log_storage = requires(T& storage, std::size_t sector, std::size_t offset,
+	std::span<std::byte> output, std::span<const std::byte> data)
+{
+	{ T::sector_size } -> std::convertible_to<std::size_t>;
+	{ storage.sectors() } -> std::convertible_to<std::size_t>;
+	storage.read(sector, offset, output);
+	{ storage.write(sector, data) } -> std::same_as<bool>;
+};
+
+/** Storage in RAM, for running the persistent log off the target.
+ *
+ * It starts out erased.
+ *
+ * @tparam SectorSize Size of a sector, in bytes.
+ * @tparam Sectors Number of sectors.
+ */
+template<std::size_t SectorSize, std::size_t Sectors>
+class ram_log_storage
+{
+public:
+	static constexpr std::size_t sector_size = SectorSize;
+
+	ram_log_storage()
+	{
+		data_.fill(std::byte(0xFF));
+	}
+
+	std::size_t sectors() const
+	{
+		return Sectors;
+	}
+
+	void read(std::size_t sector, std::size_t offset, std::span<std::byte> output) const
+	{
+		memcpy(output.data(), data_.data() + sector * SectorSize + offset, output.size());
+	}
+
+	bool write(std::size_t sector, std::span<const std::byte> data)
+	{
+		++writes_;
+		memcpy(data_.data() + sector * SectorSize, data.data(), SectorSize);
+		return true;
+	}
+
+	/** Gets the number of sector writes so far, to check the wear on each
+	 * sector.
+	 */
+	std::size_t writes() const
+	{
+		return writes_;
+	}
+
+private:
+	std::array<std::byte, SectorSize * Sectors> data_;
+	std::size_t writes_ = 0;
+};
+
+}
+
+#endif//PCRB_LOG_STORAGE_H_
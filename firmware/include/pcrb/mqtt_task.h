@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_MQTT_TASK_H_
+#define PCRB_MQTT_TASK_H_
+
+namespace pcrb
+{
+
+/** Wakes the MQTT task, to publish state changes and check the broker
+ * connection right away instead of at its next periodic check.
+ *
+ * Safe to call from any task, even before the MQTT task is running.
+ */
+void mqtt_notify();
+
+/** Asks the MQTT task to drop its broker connection and connect again, as
+ * after the network link is restored the old connection is likely dead.
+ *
+ * Safe to call from any task, even before the MQTT task is running.
+ */
+void mqtt_reconnect();
+
+/** MQTT client task.
+ *
+ * Keeps a connection to the broker in secrets.h (MQTT_BROKER), and under
+ * MQTT_TOPIC_PREFIX:
+ *  - publishes retained state topics, state/pc and state/boot_select, when
+ *    they change,
+ *  - publishes a retained status topic, online or offline (as last will),
+ *  - runs commands from the shared command table published to
+ *    command/<name>, with the argument as a decimal payload, publishing the
+ *    text reply to result. If AUTH_KEY is set, the payload must instead be
+ *    an authenticated request for the same command, as for the TCP server
+ *    (see authenticate()), and anything else is ignored,
+ *  - publishes health telemetry gathered over a period as a single JSON
+ *    message to health.
+ *
+ * Does nothing if no broker is configured.
+ */
+void mqtt_task(void*);
+
+}
+
+#endif//PCRB_MQTT_TASK_H_
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_PACKED_LOG_H_
+#define PCRB_PACKED_LOG_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace pcrb
+{
+
+struct log_entry;
+struct log_format;
+
+/** Ring of log entries packed as tightly as they go.
+ *
+ * Each kind of entry, a format and the types of its arguments, gets a small
+ * index the first time it is seen. An entry is then stored as that index,
+ * the time since the entry before it, and the values of its arguments alone,
+ * integers as varints (zigzag for signed ones). A typical entry takes 5 to
+ * 10 bytes instead of the fixed size of a pcrb::log_entry. Sequence numbers
+ * are not stored, they follow from the position in the ring.
+ *
+ * Entries are grouped in blocks of block_size. The first entry of a block
+ * has its time in full instead of since the entry before, and a checkpoint
+ * with its position makes reading an entry cost at most a block's worth of
+ * skipping. Reading the entry after the last one read skips nothing. Once
+ * full, the oldest block is dropped as a whole.
+ *
+ * This is not thread-safe.
+ */
+class packed_log
+{
+public:
+	/// Entries per block, a power of two
+	static constexpr std::size_t block_size = 32;
+
+	/// Largest packed entry
+	static constexpr std::size_t max_record_size = 128;
+
+	/// Most kinds of entries told apart. Entries of any more are kept as a
+	/// note that they were not.
+	static constexpr std::size_t max_kinds = 128;
+
+	/// Most arguments kept of an entry
+	static constexpr std::size_t max_args = 8;
+
+	/** Where a block starts.
+	 */
+	struct checkpoint
+	{
+		/// Position of the first entry of the block in the ring
+		uint32_t position;
+	};
+
+	/** Constructor.
+	 *
+	 * @param[in] data Ring to pack entries into, at least a couple of blocks
+	 *  of the largest entries.
+	 * @param[in] checkpoints Checkpoint of each block, a power of two of
+	 *  them. This bounds the number of entries held to block_size times as
+	 *  many.
+	 */
+	packed_log(std::span<std::byte> data, std::span<checkpoint> checkpoints);
+
+	/** Adds an entry, dropping the oldest block if there is no room for it.
+	 *
+	 * @param[in] entry Entry to add. Its sequence number is ignored, it gets
+	 *  end(). Arguments past max_args are dropped.
+	 */
+	void append(const log_entry& entry);
+
+	/** Unpacks an entry.
+	 *
+	 * @param[in] sequence Sequence number of the entry.
+	 * @param[out] entry Where to unpack the entry to.
+	 *
+	 * @returns False if there is no such entry.
+	 */
+	bool read(uint32_t sequence, log_entry& entry);
+
+	/** Gets the sequence number of the oldest entry held.
+	 */
+	uint32_t first() const;
+
+	/** Gets the sequence number the next entry will get.
+	 */
+	uint32_t end() const;
+
+	/** Gets the number of bytes of the ring and checkpoints in use.
+	 */
+	std::size_t used() const;
+
+	/** Gets the number of bytes the log takes, ring, checkpoints and the
+	 * table of kinds of entries.
+	 */
+	std::size_t capacity() const;
+
+	/** Gets the number of kinds of entries seen.
+	 */
+	std::size_t kinds() const;
+
+private:
+	/** A kind of entry: its format and the types of its arguments.
+	 */
+	struct kind
+	{
+		const log_format *format;
+		/// Number of arguments in the low 4 bits, then 3 bits for the type
+		/// of each
+		uint32_t signature;
+	};
+
+	/// Number of blocks held, including the one being filled
+	std::size_t blocks() const;
+
+	/// Drops the oldest block
+	void drop_block();
+
+	/// Gets the index of the kind of an entry, adding it if new
+	std::size_t find_kind(const log_format *format, uint32_t signature);
+
+	/// Copies data into the ring at position, wrapping around its end
+	void put(uint32_t position, std::span<const std::byte> data);
+
+	/// Gets the position of the entry after the one with the given sequence
+	/// number at position, and updates timestamp_us to the time of that one
+	uint32_t skip(uint32_t sequence, uint32_t position, uint64_t& timestamp_us) const;
+
+	std::span<std::byte> data_;
+	std::span<checkpoint> checkpoints_;
+	/// Where the next entry goes in the ring
+	uint32_t head_;
+	/// Where the oldest entry is in the ring
+	uint32_t tail_;
+	std::size_t used_;
+	uint32_t first_;
+	uint32_t next_;
+	uint64_t last_timestamp_us_;
+
+	std::array<kind, max_kinds> kinds_;
+	std::size_t kind_count_;
+	/// Open addressed index of kinds_, by format and signature, 0 if free
+	/// and the index plus one otherwise
+	std::array<uint8_t, max_kinds * 2> kind_slots_;
+
+	/// Where the entry after the last one read starts
+	struct cursor
+	{
+		uint32_t sequence;
+		uint32_t position;
+		uint64_t timestamp_us;
+	};
+	cursor read_next_;
+};
+
+}
+
+#endif//PCRB_PACKED_LOG_H_
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_PERFECT_HASH_H_
+#define PCRB_PERFECT_HASH_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <bit>
+#include <optional>
+#include <string_view>
+
+namespace pcrb
+{
+
+/** Perfect hash over a fixed set of strings, built at compile time.
+ *
+ * Construction searches for a seed under which every key hashes to its own
+ * slot. Lookups then cost one hash of the input and a single string
+ * comparison, regardless of the number of keys.
+ *
+ * @tparam N Number of keys.
+ */
+template<std::size_t N>
+class perfect_hash
+{
+public:
+	/** Constructor.
+	 *
+	 * Meant to be evaluated at compile time. Fails to compile if the keys
+	 * contain duplicates or no seed could be found.
+	 *
+	 * @param[in] keys Keys to hash. They must outlive this object.
+	 */
+	consteval perfect_hash(const std::array<std::string_view, N>& keys)
+	:keys_(keys), seed_(0), slots_{}
+	{
+		for (uint32_t seed = 0; seed < max_seed; ++seed)
+		{
+			if (try_seed(seed))
+			{
+				seed_ = seed;
+				return;
+			}
+		}
+		throw "unable to find a perfect hash seed";
+	}
+
+	/** Looks up a key.
+	 *
+	 * @param[in] key Key to look up.
+	 *
+	 * @returns The index of the key in the array given at construction, or
+	 *  an empty optional if the key is not one of them.
+	 */
+	constexpr std::optional<std::size_t> find(std::string_view key) const
+	{
+		uint8_t slot = slots_[hash(key, seed_) % table_size];
+		if (slot == 0 || keys_[slot - 1] != key)
+			return {};
+		return slot - 1;
+	}
+
+private:
+	static_assert(N < 255, "slots are stored as uint8_t");
+
+	/// Twice the keys, rounded up, keeps the seed search short
+	static constexpr std::size_t table_size = std::bit_ceil(2 * N + 1);
+	static constexpr uint32_t max_seed = 1 << 16;
+
+	static constexpr uint32_t hash(std::string_view key, uint32_t seed)
+	{
+		// FNV-1a, with the seed mixed into the offset basis
+		uint32_t result = 2166136261u ^ (seed * 0x9E3779B9u);
+		for (char c : key)
+		{
+			result ^= static_cast<uint8_t>(c);
+			result *= 16777619u;
+		}
+		return result;
+	}
+
+	constexpr bool try_seed(uint32_t seed)
+	{
+		slots_ = {};
+		for (std::size_t i = 0; i < N; ++i)
+		{
+			uint8_t& slot = slots_[hash(keys_[i], seed) % table_size];
+			if (slot != 0)
+				return false;
+			slot = i + 1;
+		}
+		return true;
+	}
+
+	std::array<std::string_view, N> keys_;
+	uint32_t seed_;
+	/// Index + 1 of the key hashing to each slot, 0 for unused slots
+	std::array<uint8_t, table_size> slots_;
+};
+
+}
+
+#endif//PCRB_PERFECT_HASH_H_
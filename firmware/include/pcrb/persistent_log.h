@@ -0,0 +1,273 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_PERSISTENT_LOG_H_
+#define PCRB_PERSISTENT_LOG_H_
+
+#include <pcrb/log.h>
+#include <pcrb/log_storage.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace pcrb
+{
+
+/** Append-only log of rendered messages, kept across reboots.
+ *
+ * Lines are gathered in a RAM copy of a sector, and the storage is only
+ * written a whole sector at a time, when the copy fills up or on flush().
+ * Sectors are written round-robin, each one starting with a header carrying
+ * a serial number, so the newest one can be found again after a reboot and
+ * every sector wears the same. Once all sectors are used, the oldest one is
+ * overwritten.
+ *
+ * Every sector is also tagged with the boot it was written during, boots
+ * being numbered from the newest found when the log was opened, so the lines
+ * of earlier boots can be told apart from those of the current one.
+ *
+ * If the storage has no sectors, as when the firmware image leaves no flash
+ * over, persistence is turned off: lines are dropped and nothing is read.
+ *
+ * This is not thread-safe.
+ *
+ * @tparam Storage Storage to keep the log in, see pcrb::persistent_log_storage.
+ */
+template<persistent_log_storage Storage>
+class persistent_log
+{
+public:
+	/** Constructor.
+	 *
+	 * @param[in] storage Storage to keep the log in. Nothing is read from it
+	 *  until open().
+	 */
+	explicit persistent_log(Storage& storage)
+	:storage_(storage), next_sector_(0), serial_(0), boot_(1), previous_boot_(0),
+		used_(header_size), failures_(0)
+	{}
+
+	/** Finds where earlier boots left off, and starts a new boot.
+	 */
+	void open()
+	{
+		bool found = false;
+		uint32_t newest_serial = 0;
+		std::size_t newest_sector = 0;
+		for (std::size_t sector = 0; sector < storage_.sectors(); ++sector)
+		{
+			sector_header header;
+			if (!read_header(sector, header))
+				continue;
+			if (!found || static_cast<int32_t>(header.serial - newest_serial) > 0)
+			{
+				newest_serial = header.serial;
+				newest_sector = sector;
+				previous_boot_ = header.boot;
+			}
+			found = true;
+		}
+
+		if (found)
+		{
+			next_sector_ = (newest_sector + 1) % storage_.sectors();
+			serial_ = newest_serial + 1;
+			boot_ = previous_boot_ + 1;
+		}
+		used_ = header_size;
+	}
+
+	/** Checks whether lines are kept at all.
+	 *
+	 * @returns False if the storage has no sectors to keep them in.
+	 */
+	bool enabled() const
+	{
+		return storage_.sectors() != 0;
+	}
+
+	/** Adds a line to the log.
+	 *
+	 * @param[in] line Line to add.
+	 *
+	 * @returns False if the line filled the RAM copy and writing it out
+	 *  failed. The line is kept for the next sector either way.
+	 */
+	bool append(const log_line& line)
+	{
+		if (!enabled())
+			return true;
+
+		bool result = true;
+		std::size_t size = std::min<std::size_t>(line.size, max_line_size);
+		if (used_ + record_size + size > Storage::sector_size)
+			result = flush();
+
+		std::byte *data = buffer_.data() + used_;
+		data[0] = static_cast<std::byte>(size);
+		data[1] = static_cast<std::byte>(line.level);
+		memcpy(data + 2, &line.sequence, sizeof(line.sequence));
+		memcpy(data + 6, &line.timestamp_us, sizeof(line.timestamp_us));
+		memcpy(data + record_size, line.text.data(), size);
+		used_ += record_size + size;
+		return result;
+	}
+
+	/** Writes out the lines not yet in storage, if any.
+	 *
+	 * Each call starts a new sector, so this should be left for when the
+	 * lines really need to be kept, like before a reboot.
+	 *
+	 * @returns False if writing to storage failed, in which case the lines
+	 *  are lost.
+	 */
+	bool flush()
+	{
+		if (used_ == header_size || !enabled())
+			return true;
+
+		// Erased storage reads as 0xFF, which also ends the records
+		std::fill(buffer_.begin() + used_, buffer_.end(), std::byte(0xFF));
+		sector_header header = { sector_magic, serial_, boot_, check(serial_, boot_) };
+		memcpy(buffer_.data(), &header, sizeof(header));
+
+		// The sector is moved past even on failure, so a bad one is not
+		// hammered
+		bool result = storage_.write(next_sector_, buffer_);
+		if (!result)
+			++failures_;
+		next_sector_ = (next_sector_ + 1) % storage_.sectors();
+		++serial_;
+		used_ = header_size;
+		return result;
+	}
+
+	/** Reads lines of a boot, oldest first.
+	 *
+	 * Only lines already written to storage are seen.
+	 *
+	 * @param[in] boot Boot to read the lines of.
+	 * @param[in] first Number of lines of the boot to skip.
+	 * @param[out] lines Where to copy the lines to.
+	 *
+	 * @returns The number of lines copied, less than the size of lines only
+	 *  if there are no more.
+	 */
+	std::size_t read(uint32_t boot, std::size_t first, std::span<log_line> lines) const
+	{
+		std::size_t index = 0;
+		std::size_t count = 0;
+		// Starting from the sector written next, which is the oldest
+		for (std::size_t i = 0; i < storage_.sectors() && count < lines.size(); ++i)
+		{
+			std::size_t sector = (next_sector_ + i) % storage_.sectors();
+			sector_header header;
+			if (!read_header(sector, header) || header.boot != boot)
+				continue;
+
+			std::size_t offset = header_size;
+			while (offset + record_size <= Storage::sector_size && count < lines.size())
+			{
+				std::array<std::byte, record_size> record;
+				storage_.read(sector, offset, record);
+				std::size_t size = static_cast<uint8_t>(record[0]);
+				if (size > max_line_size || offset + record_size + size > Storage::sector_size)
+					break;
+
+				if (index++ >= first)
+				{
+					log_line& line = lines[count++];
+					line.size = size;
+					line.level = static_cast<log_level>(record[1]);
+					memcpy(&line.sequence, record.data() + 2, sizeof(line.sequence));
+					memcpy(&line.timestamp_us, record.data() + 6, sizeof(line.timestamp_us));
+					storage_.read(sector, offset + record_size,
+						std::as_writable_bytes(std::span(line.text).first(size)));
+					line.text[size] = '\0';
+				}
+				offset += record_size + size;
+			}
+		}
+		return count;
+	}
+
+	/** Gets the number of the current boot.
+	 */
+	uint32_t boot() const
+	{
+		return boot_;
+	}
+
+	/** Gets the number of the newest boot before this one with anything in
+	 * storage, 0 if there is none.
+	 */
+	uint32_t previous_boot() const
+	{
+		return previous_boot_;
+	}
+
+	/** Gets the number of sector writes that failed.
+	 */
+	uint32_t failures() const
+	{
+		return failures_;
+	}
+
+private:
+	/// "PLOG", marks sectors written by the log
+	static constexpr uint32_t sector_magic = 0x474F4C50;
+
+	struct sector_header
+	{
+		uint32_t magic;
+		/// Number of sectors written before this one
+		uint32_t serial;
+		/// Boot the sector was written during
+		uint32_t boot;
+		/// Guards against torn or foreign headers
+		uint32_t check;
+	};
+
+	static constexpr std::size_t header_size = sizeof(sector_header);
+
+	/// Size of a record before its text: 1 byte text size, 1 byte level,
+	/// 4 byte sequence number and 8 byte timestamp, in native byte order
+	static constexpr std::size_t record_size = 1 + 1 + 4 + 8;
+
+	/// Longest text kept, leaving room for the NUL when read back. A size
+	/// of 0xFF, erased storage, is never valid.
+	static constexpr std::size_t max_line_size = log_entry::max_text_size - 1;
+
+	static_assert(max_line_size < 0xFF, "line sizes must not look like erased storage");
+	static_assert(header_size + record_size + max_line_size <= Storage::sector_size,
+		"sectors must fit the longest line");
+
+	static constexpr uint32_t check(uint32_t serial, uint32_t boot)
+	{
+		return ~(sector_magic ^ serial ^ (boot * 0x9E3779B9));
+	}
+
+	bool read_header(std::size_t sector, sector_header& header) const
+	{
+		storage_.read(sector, 0, std::as_writable_bytes(std::span(&header, 1)));
+		return header.magic == sector_magic && header.check == check(header.serial, header.boot);
+	}
+
+	Storage& storage_;
+	std::array<std::byte, Storage::sector_size> buffer_;
+	std::size_t next_sector_;
+	uint32_t serial_;
+	uint32_t boot_;
+	uint32_t previous_boot_;
+	std::size_t used_;
+	uint32_t failures_;
+};
+
+}
+
+#endif//PCRB_PERSISTENT_LOG_H_
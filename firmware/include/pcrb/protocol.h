@@ -0,0 +1,296 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_PROTOCOL_H_
+#define PCRB_PROTOCOL_H_
+
+#include <pcrb/log.h>
+
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <expected>
+#include <string_view>
+
+namespace pcrb
+{
+
+/// Value of the 4 byte magic field that starts every network request.
+constexpr const uint32_t request_magic = 0x416E614D;
+
+/// Command echoed back when a request was too short to contain one.
+constexpr const uint32_t no_command = 0xFFFFFFFF;
+
+/// Room for the text form of a single response, see describe().
+constexpr const std::size_t max_description_size = 128;
+
+/** Network request opcodes.
+ */
+enum class opcode : uint32_t
+{
+	toggle = 0,
+	get_boot = 1,
+	set_boot = 2,
+	sense = 3,
+	session_options = 4,
+	batch = 5,
+	subscribe = 6,
+	previous_log = 7,
+	log_query = 8,
+};
+
+/** Status code of a binary response.
+ */
+enum class response_status : uint8_t
+{
+	ok = 0,
+	bad_size = 1,
+	bad_magic = 2,
+	unknown_command = 3,
+	timeout = 4,
+	error = 5,
+	busy = 6,
+	unauthorized = 7,
+	bad_argument = 8,
+};
+
+/** Type of the payload carried by a binary response.
+ */
+enum class payload_type : uint8_t
+{
+	none = 0,
+	boolean = 1,
+	u32 = 2,
+	state_event = 3,
+	log_page = 4,
+};
+
+/** Reply to a network request, for clients that negotiated binary responses.
+ *
+ * On the wire, after the usual 2 byte length prefix, a response is a 1 byte
+ * status, the 4 byte command being replied to, a 1 byte payload type, and 0,
+ * 1, or 4 bytes of payload depending on the type. All multibyte fields are
+ * big-endian.
+ */
+struct response
+{
+	/// Largest encoded response, not counting the length prefix.
+	static constexpr std::size_t max_size = 1 + 4 + 1 + 4;
+
+	/** Constructs a successful response with no payload, to no command.
+	 */
+	constexpr response()
+	:response(response_status::ok, no_command)
+	{}
+
+	/** Constructs a response with no payload.
+	 *
+	 * @param[in] status Result of the request.
+	 * @param[in] command Command being replied to.
+	 */
+	constexpr response(response_status status, uint32_t command)
+	:status(status), command(command), type(payload_type::none), value(0)
+	{}
+
+	/** Constructs a response with a boolean payload.
+	 *
+	 * @param[in] status Result of the request.
+	 * @param[in] command Command being replied to.
+	 * @param[in] value Payload.
+	 */
+	constexpr response(response_status status, uint32_t command, bool value)
+	:status(status), command(command), type(payload_type::boolean), value(value)
+	{}
+
+	/** Constructs a response with a 32 bit unsigned payload.
+	 *
+	 * @param[in] status Result of the request.
+	 * @param[in] command Command being replied to.
+	 * @param[in] value Payload.
+	 */
+	constexpr response(response_status status, uint32_t command, uint32_t value)
+	:status(status), command(command), type(payload_type::u32), value(value)
+	{}
+
+	/** Encodes the response into the given buffer.
+	 *
+	 * @param[out] buffer Buffer to encode the response into.
+	 *
+	 * @returns The part of buffer holding the encoded response.
+	 */
+	std::span<const std::byte> encode(std::span<std::byte, max_size> buffer) const;
+
+	response_status status;
+	uint32_t command;
+	payload_type type;
+	uint32_t value;
+};
+
+/** Change of the PC power state, streamed to subscribers (see
+ * opcode::subscribe).
+ *
+ * On the wire it looks like a binary response to opcode::subscribe with
+ * status ok and a payload_type::state_event payload: a 1 byte state, the
+ * 8 byte time of the change in microseconds since boot, and a 4 byte count of
+ * the events dropped so far because the subscriber fell behind, all
+ * big-endian.
+ */
+struct state_event
+{
+	/// Largest encoded event, not counting the length prefix.
+	static constexpr std::size_t max_size = 1 + 4 + 1 + 1 + 8 + 4;
+
+	/** Encodes the event into the given buffer.
+	 *
+	 * @param[out] buffer Buffer to encode the event into.
+	 *
+	 * @returns The part of buffer holding the encoded event.
+	 */
+	std::span<const std::byte> encode(std::span<std::byte, max_size> buffer) const;
+
+	/// New state, true if the PC is on.
+	bool state;
+	/// Time of the change, in microseconds since boot.
+	uint64_t timestamp;
+	/// Events dropped for this subscriber before this one.
+	uint32_t dropped;
+};
+
+/** Page of log messages, the reply to opcode::previous_log and
+ * opcode::log_query.
+ *
+ * On the wire it looks like a binary response with status ok and a
+ * payload_type::log_page payload: the 4 byte argument to ask for the next
+ * page with, a 1 byte count of messages, and then each message as its 4 byte
+ * sequence number, 8 byte timestamp in microseconds since boot, 1 byte
+ * level, 1 byte text length and the text itself, not NUL terminated. All
+ * multibyte fields are big-endian.
+ *
+ * For opcode::previous_log, a page with no messages is the last one. For
+ * opcode::log_query, a page stops early after looking at
+ * event_log::query_scan_limit messages, so it may hold few messages or none
+ * while more follow, and the end of the log has been reached, for now, when
+ * the argument for the next page is the one the page was asked with.
+ */
+struct log_page
+{
+	/// Most messages in a page.
+	static constexpr std::size_t max_lines = 4;
+
+	/// Room for the text form of a page, see describe(): each message on
+	/// its own line as sequence number, timestamp, level and text, and then
+	/// the argument for the next page.
+	static constexpr std::size_t max_text_size =
+		max_lines * (10 + 1 + 20 + 1 + 7 + 2 + log_entry::max_text_size - 1 + 2) + 6 + 10;
+
+	/// Largest encoded page, not counting the length prefix.
+	static constexpr std::size_t max_size = 1 + 4 + 1 + 4 + 1 +
+		max_lines * (4 + 8 + 1 + 1 + log_entry::max_text_size - 1);
+
+	/** Encodes the page into the given buffer.
+	 *
+	 * @param[out] buffer Buffer to encode the page into.
+	 *
+	 * @returns The part of buffer holding the encoded page.
+	 */
+	std::span<const std::byte> encode(std::span<std::byte, max_size> buffer) const;
+
+	/// Command being replied to.
+	uint32_t command;
+	/// Argument to ask for the next page with.
+	uint32_t next;
+	/// Messages in the page, at most max_lines.
+	std::span<const log_line> lines;
+};
+
+/** Decoded network request.
+ */
+struct request
+{
+	/// Requested command, see pcrb::opcode.
+	uint32_t code;
+	/// Argument of the command, 0 if the request did not have one.
+	uint32_t argument;
+	/// Size of the request body, including magic and command.
+	std::size_t size;
+	/// Everything after the command, for requests with more than one
+	/// argument.
+	std::span<const std::byte> payload;
+};
+
+/** Decoded log query, see opcode::log_query.
+ */
+struct log_query
+{
+	/// Sequence number to start from.
+	uint32_t since;
+	/// If not 0, start from the last this many messages passing the filter
+	/// instead.
+	uint8_t tail;
+	/// Messages to return.
+	log_filter filter;
+};
+
+/** Decodes the arguments of a log query.
+ *
+ * After the command, a log query is a 4 byte sequence number to start from,
+ * and optionally a 1 byte lowest level to return, a 1 byte count of the last
+ * messages to start from instead of the sequence number (0 for none), and
+ * text the messages must contain, up to the end of the request.
+ *
+ * @param[in] request Request to decode.
+ *
+ * @returns The decoded query, or the error response to send back:
+ *  response_status::bad_size if the sequence number is missing, or
+ *  response_status::bad_argument with the level if there is no such level.
+ *  The text of the filter points into the request.
+ */
+std::expected<log_query, response> decode_log_query(const request& request);
+
+/** Decodes a network request body.
+ *
+ * The body is a 4 byte magic field (request_magic), a 4 byte command, and
+ * optionally a 4 byte argument, all big-endian. Whether the size is right for
+ * the command is left to the caller.
+ *
+ * @param[in] data Request body.
+ *
+ * @returns The decoded request, or the error response to send back.
+ */
+std::expected<request, response> decode_request(std::span<const std::byte> data);
+
+/** Formats the text form of an error response.
+ *
+ * @param[in] error Response with a status other than response_status::ok.
+ * @param[out] output Where to format the text, max_description_size is
+ *  always enough.
+ *
+ * @returns The text reply, as sent to clients using the text protocol.
+ */
+std::string_view describe(const response& error, std::span<char> output);
+
+/** Formats the text form of a state change event.
+ *
+ * @param[in] event Event to describe.
+ * @param[out] output Where to format the text, max_description_size is
+ *  always enough.
+ *
+ * @returns The text event, as sent to clients using the text protocol.
+ */
+std::string_view describe(const state_event& event, std::span<char> output);
+
+/** Formats the text form of a page of log messages, one per line, followed
+ * by the argument to ask for the next page with.
+ *
+ * @param[in] page Page to describe.
+ * @param[out] output Where to format the text, log_page::max_text_size is
+ *  always enough.
+ *
+ * @returns The text reply, as sent to clients using the text protocol.
+ */
+std::string_view describe(const log_page& page, std::span<char> output);
+
+}
+
+#endif//PCRB_PROTOCOL_H_
@@ -1,36 +1,373 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2025
+// SPDX-FileCopyrightText: Gabriel Marcano, 2025 - 2026
 /// @file
 
 #ifndef PCRB_REQUEST_HANDLER_H_
 #define PCRB_REQUEST_HANDLER_H_
 
+#include <array>
 #include <cstdint>
-#include <memory>
-#include <expected>
-#include <vector>
+#include <coroutine>
 #include <span>
 #include <string_view>
+#include <utility>
 
 #include <pcrb/server.h>
+#include <pcrb/coroutine.h>
+#include <pcrb/protocol.h>
+#include <pcrb/timer_wheel.h>
+#include <pcrb/bounded_queue.h>
+#include <pcrb/response_builder.h>
 
-// forward declaration of addrinfo, so we don't need to pull in the complete
-// networking headers
-struct addrinfo;
+#include <lwip/altcp.h>
+#include <lwip/pbuf.h>
 
 namespace pcrb
 {
 
+/// Size of each connection coroutine frame.
+constexpr const std::size_t session_frame_size = 256;
+
+/// Maximum number of connections served at the same time.
+constexpr const std::size_t max_connections = 6;
+
+/// Pool the connection coroutine frames are allocated from.
+using session_frame_pool = frame_pool<session_frame_size, max_connections>;
+extern session_frame_pool session_frames;
+
+/// Wheel holding the connection deadlines.
+using deadline_wheel = timer_wheel<64>;
+
+/** Per-connection request handler.
+ *
+ * Requests are a 2 byte big-endian length followed by that many bytes of
+ * request body. Each connection is served by a small coroutine that is
+ * resumed from the lwIP altcp callbacks as data arrives or is acknowledged,
+ * so all connections share the lwIP thread instead of each needing a task.
+ *
+ * Received data is kept in the pbuf chain lwIP handed over, and requests are
+ * read from it in place. Only a request split across pbufs is copied, to
+ * make it contiguous. The TCP window is only opened back up as requests are
+ * consumed, so a client pipelining requests is throttled by TCP itself.
+ *
+ * Every phase of a connection has a deadline (see deadline), counted from
+ * the start of the phase and not from the last byte received, so a client
+ * trickling in a request a byte at a time can't hold on to a connection.
+ * Connections missing a deadline are evicted with a timeout reply, carrying
+ * the phase as its value, except when idle between requests, where there is
+ * no request to reply to.
+ *
+ * Everything sent while handling an event (a reply, its length prefix, and
+ * any state change events) is gathered in a shared response_builder and
+ * handed to the stack with a single write once the coroutine suspends, so a
+ * reply never costs more segments than its size needs. Nagle's algorithm is
+ * off, as clients wait on every reply.
+ *
+ * Connections may be plain TCP or TLS, through the same altcp calls, with
+ * TLS connections given longer to set up to allow for the handshake.
+ *
+ * Connections can also subscribe to PC state changes (see subscribe()), and
+ * have them streamed as they happen, interleaved with replies.
+ */
 class request_handler
 {
 public:
-	request_handler(socket socket_);
+	/// Largest request body kept, longer requests are truncated. Large
+	/// enough for a full batch request.
+	static constexpr std::size_t max_request_size = 256;
+
+	/// Send buffer space needed before a request is handled, enough for
+	/// the largest reply.
+	static constexpr std::size_t max_reply_size = 1024;
+
+	/// Session option: keep the connection open after each reply. Replies
+	/// are then prefixed with their 2 byte big-endian length, like requests.
+	static constexpr uint32_t option_keep_alive = 1 << 0;
+
+	/// Session option: reply with binary responses (see pcrb::response)
+	/// instead of text. Replies are prefixed with their length, as with
+	/// option_keep_alive.
+	static constexpr uint32_t option_binary = 1 << 1;
+
+	/// All session options understood by this handler.
+	static constexpr uint32_t supported_options = option_keep_alive | option_binary;
+
+	/// Connection phases with their own deadline
+	enum class deadline : uint32_t
+	{
+		/// From accepting the connection to the first byte of a request,
+		/// including any TLS handshake
+		setup,
+		/// From the first byte of a request to its complete length
+		header,
+		/// From the length of a request to having all of it, and room to
+		/// reply to it
+		body,
+		/// Between requests on a keep-alive connection
+		idle,
+	};
+
+	/// Number of phases in deadline
+	static constexpr std::size_t deadline_count = 4;
+
+	/** Gets the number of connections evicted for missing a deadline.
+	 *
+	 * Safe to call from any task.
+	 *
+	 * @param[in] phase Phase whose deadline was missed.
+	 *
+	 * @returns Number of evictions since boot.
+	 */
+	static uint32_t evictions(deadline phase);
+
+	/// Counts of replies and of what sending them took
+	struct reply_stats
+	{
+		/// Replies and events sent
+		uint32_t replies;
+		/// Writes handed to the stack, each holding one or more replies
+		uint32_t writes;
+		/// TCP segments the writes needed, at the connection's MSS
+		uint32_t segments;
+	};
+
+	/** Gets the counts of replies sent and the segments they took.
+	 *
+	 * Safe to call from any task.
+	 *
+	 * @returns Counts since boot.
+	 */
+	static reply_stats reply_counts();
+
+	/// State change events queued for each subscriber before dropping new
+	/// ones.
+	static constexpr std::size_t max_queued_events = 8;
+
+	/** Subscribes the connection to PC state change events.
+	 *
+	 * The connection is then kept open, as with option_keep_alive, and is no
+	 * longer evicted for being idle. Events are sent as they are published,
+	 * as pcrb::state_event in binary mode or as text otherwise, and further
+	 * requests are still handled. If the client does not keep up, new events
+	 * are dropped once max_queued_events are waiting, and counted in the
+	 * events that do make it.
+	 *
+	 * Must be called from the lwIP thread.
+	 */
+	void subscribe();
+
+	/** Queues a state change event for every subscribed connection, to be
+	 * sent from the lwIP thread.
+	 *
+	 * Must not be called from the lwIP thread.
+	 *
+	 * @param[in] event Event to publish.
+	 */
+	static void publish(const state_event& event);
+
+	/** Starts serving a newly accepted connection.
+	 *
+	 * Must be called from the lwIP thread, normally from an accept callback.
+	 *
+	 * @param[in,out] pcb PCB of the new connection.
+	 * @param[in] callback Function to call for every request received.
+	 * @param[in] secure Whether the connection is over TLS.
+	 *
+	 * @returns ERR_OK on success, or ERR_ABRT if the connection could not be
+	 *  served and was aborted.
+	 */
+	static err_t start(altcp_pcb *pcb, request_callback callback, bool secure);
 
-	std::expected<std::size_t, int> read(std::span<std::byte> data);
-	int send(std::span<std::byte> data);
+	/** Sends a reply to the client.
+	 *
+	 * If the keep-alive or binary options are set, the reply is prefixed with
+	 * its length. The reply is only queued, and goes out along with anything
+	 * else sent before the connection waits for more, see flush().
+	 *
+	 * @param[in] data Reply to send.
+	 *
+	 * @returns 0 on success, an error code otherwise.
+	 */
+	int send(std::span<const std::byte> data);
 	int send(std::string_view data);
+
+	/** Hands everything queued by send() to the network stack, in a single
+	 * write.
+	 *
+	 * Called whenever the connection waits for more, so there is normally no
+	 * need to call it directly.
+	 *
+	 * @returns 0 on success, an error code otherwise.
+	 */
+	int flush();
+
+	/** Sends a reply in the form the client asked for.
+	 *
+	 * The text form is only formatted for clients using the text protocol,
+	 * into a buffer shared by all connections, so nothing is allocated
+	 * either way.
+	 *
+	 * @param[in] binary Binary form of the reply.
+	 * @param[in] describe Called with a std::span<char> of max_reply_size
+	 *  bytes to format the text form of the reply into, returning the text
+	 *  as a std::string_view.
+	 */
+	template<class Describe>
+	void respond(std::span<const std::byte> binary, Describe&& describe)
+	{
+		if (options_ & option_binary)
+			send(binary);
+		else
+			send(std::string_view(describe(text_buffer())));
+	}
+
+	/** Logs a response, and sends it in the form the client asked for.
+	 *
+	 * @param[in] binary Response to send.
+	 * @param[in] describe Formats the text form of the response, see above.
+	 */
+	template<class Describe>
+	void respond(const response& binary, Describe&& describe)
+	{
+		log_response(binary);
+		std::array<std::byte, response::max_size> buffer;
+		respond(binary.encode(buffer), std::forward<Describe>(describe));
+	}
+
+	/** Logs an error response, and sends it in the form the client asked
+	 * for, with its usual text form (see pcrb::describe()).
+	 *
+	 * @param[in] error Response to send.
+	 */
+	void respond(const response& error);
+
+	/** Holds back the connection until resume() is called, for a request
+	 * finished off by another task.
+	 *
+	 * Nothing more is read from the connection until then, so replies stay
+	 * in order, and the request has no deadline while it is held back. Must
+	 * be called from the request callback.
+	 *
+	 * @returns Identifier of the connection, see find().
+	 */
+	uint32_t defer();
+
+	/** Replies to a request held back by defer() have been sent, carry on
+	 * with the connection.
+	 *
+	 * Must be called from the lwIP thread. The handler may be released
+	 * before returning, and must not be used afterwards.
+	 */
+	void resume();
+
+	/** Finds a connection by its identifier.
+	 *
+	 * Must be called from the lwIP thread.
+	 *
+	 * @param[in] id Identifier of the connection, from defer().
+	 *
+	 * @returns The connection, or nullptr if it has been closed since.
+	 */
+	static request_handler* find(uint32_t id);
+
+	/** Gets the session options requested by the client.
+	 *
+	 * @returns Bitmask of session options.
+	 */
+	uint32_t options() const;
+
+	/** Sets the session options.
+	 *
+	 * @param[in] options Bitmask of session options. Unsupported options are
+	 *  ignored.
+	 */
+	void set_options(uint32_t options);
+
+	request_handler(altcp_pcb *pcb, request_callback callback, bool secure);
+	~request_handler();
+	request_handler(const request_handler&) = delete;
+	request_handler& operator=(const request_handler&) = delete;
+
 private:
-	socket socket_;
+	/// What the coroutine is suspended waiting for
+	enum class wait_reason
+	{
+		data,
+		send_space,
+		/// Data, or queued events and room to send them
+		data_or_events,
+		/// The deferred request to be finished, see defer()
+		deferred,
+	};
+
+	/** Awaitable suspending the coroutine until a condition is met.
+	 *
+	 * Resumes with false if the connection closed first.
+	 */
+	struct awaiter
+	{
+		request_handler& handler;
+		wait_reason reason;
+		std::size_t amount;
+
+		bool await_ready() const noexcept;
+		void await_suspend(std::coroutine_handle<> handle) noexcept;
+		bool await_resume() const noexcept;
+	};
+
+	coroutine<session_frames> run();
+	awaiter receive(std::size_t amount);
+	awaiter writable(std::size_t amount);
+	awaiter incoming();
+	awaiter completion();
+
+	bool satisfied(wait_reason reason, std::size_t amount) const;
+	bool send_space(std::size_t amount) const;
+	void send_events();
+	static void wake_subscribers(void *arg);
+	std::size_t available() const;
+	bool idle() const;
+	void consume(std::size_t amount);
+	void dispatch(std::size_t size);
+	void arm(deadline phase);
+	static void expire(void *context);
+	static void tick(void *arg);
+	err_t wake();
+	int write(std::span<const std::byte> data);
+	static err_t release(request_handler *handler);
+	static std::span<char> text_buffer();
+	static void log_response(const response& binary);
+
+	static err_t on_recv(void *arg, altcp_pcb *pcb, pbuf *p, err_t err);
+	static err_t on_sent(void *arg, altcp_pcb *pcb, u16_t len);
+	static void on_err(void *arg, err_t err);
+
+	altcp_pcb *pcb_;
+	request_callback callback_;
+	/// Identifier of the connection, unique since boot
+	uint32_t id_;
+	/// Received data not yet consumed
+	pbuf *chain_;
+	std::coroutine_handle<> waiter_;
+	wait_reason reason_;
+	std::size_t wanted_;
+	uint32_t options_;
+	/// Deadline of the current phase
+	deadline_wheel::entry deadline_;
+	deadline phase_;
+	/// Connection is over TLS
+	bool secure_;
+	/// Client closed its side of the connection
+	bool closed_;
+	/// Connection is being dropped, e.g. after a timeout
+	bool cancelled_;
+	/// Coroutine ran to completion, connection can be released
+	bool finished_;
+	bool subscribed_;
+	/// Request held back until resume(), see defer()
+	bool deferred_;
+	/// Events waiting to be sent, if subscribed
+	bounded_queue<state_event, max_queued_events> events_;
 };
 
 }
@@ -0,0 +1,116 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_RESPONSE_BUILDER_H_
+#define PCRB_RESPONSE_BUILDER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+namespace pcrb
+{
+
+/** Fixed capacity buffer gathering the parts of replies, so they can be
+ * handed to the network stack with a single write.
+ *
+ * This is not thread-safe.
+ *
+ * @tparam N Capacity of the buffer, in bytes.
+ */
+template<std::size_t N>
+class response_builder
+{
+public:
+	/// Capacity of the buffer, in bytes.
+	static constexpr std::size_t capacity = N;
+
+	response_builder()
+	:size_(0)
+	{}
+
+	/** Checks whether there is room for more data.
+	 *
+	 * @param[in] amount Number of bytes to add.
+	 *
+	 * @returns True if amount more bytes fit.
+	 */
+	bool fits(std::size_t amount) const
+	{
+		return amount <= N - size_;
+	}
+
+	/** Adds data to the end of the buffer.
+	 *
+	 * @param[in] data Data to add.
+	 *
+	 * @returns False if the data did not fit, in which case nothing was
+	 *  added.
+	 */
+	bool append(std::span<const std::byte> data)
+	{
+		if (!fits(data.size()))
+			return false;
+		memcpy(buffer_.data() + size_, data.data(), data.size());
+		size_ += data.size();
+		return true;
+	}
+
+	/** Adds data to the end of the buffer, prefixed with its 2 byte
+	 * big-endian length.
+	 *
+	 * @param[in] data Data to add.
+	 *
+	 * @returns False if the data and its prefix did not fit, in which case
+	 *  nothing was added.
+	 */
+	bool append_framed(std::span<const std::byte> data)
+	{
+		if (data.size() > UINT16_MAX || !fits(2 + data.size()))
+			return false;
+		std::array<std::byte, 2> size = {
+			static_cast<std::byte>(data.size() >> 8),
+			static_cast<std::byte>(data.size()),
+		};
+		append(size);
+		append(data);
+		return true;
+	}
+
+	/** Gets the data gathered so far.
+	 *
+	 * @returns The data, valid until the next change to the buffer.
+	 */
+	std::span<const std::byte> data() const
+	{
+		return std::span(buffer_).first(size_);
+	}
+
+	std::size_t size() const
+	{
+		return size_;
+	}
+
+	bool empty() const
+	{
+		return size_ == 0;
+	}
+
+	/** Empties the buffer.
+	 */
+	void clear()
+	{
+		size_ = 0;
+	}
+
+private:
+	std::array<std::byte, N> buffer_;
+	std::size_t size_;
+};
+
+}
+
+#endif//PCRB_RESPONSE_BUILDER_H_
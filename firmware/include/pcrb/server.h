@@ -1,156 +1,83 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2024
+// SPDX-FileCopyrightText: Gabriel Marcano, 2024 - 2026
 /// @file
 
 #ifndef PCRB_SERVER_H_
 #define PCRB_SERVER_H_
 
 #include <cstdint>
-#include <memory>
-#include <expected>
-#include <vector>
+#include <bit>
 #include <span>
 
-// forward declaration of addrinfo, so we don't need to pull in the complete
-// networking headers
-struct addrinfo;
+#include <lwip/tcp.h>
+#include <lwip/altcp_tls.h>
 
 namespace pcrb
 {
 
-/** C++ wrapper around Berkley sockets.
+class request_handler;
+
+/** Function called for every request received by a server.
+ *
+ * @param[in,out] handler Connection the request came from, to reply through.
+ * @param[in] request Request body, without its length prefix. Only valid
+ *  during the call.
+ */
+using request_callback = void (*)(request_handler& handler, std::span<const std::byte> request);
+
+/** Simple server class, built on the lwIP raw TCP API.
  *
- * Objects of this class take ownership over the socket provided at
- * construction. These objects are not copyable.
+ * Every accepted connection gets a request_handler, and all of them are
+ * serviced from the lwIP thread as data arrives, so no task blocks on any
+ * one client.
+ *
+ * Listens on a single dual-stack PCB, so IPv4 and IPv6 clients are served
+ * alike. Connections can also be served over TLS (see listen()), wrapped
+ * with lwIP's altcp layer so request handling is the same either way.
  */
-class socket
+class server
 {
 public:
-	/** Default constructor.
-	 *
-	 * Initializes to an invalid socket.
-	 *
-	 */
-	socket();
-
 	/** Constructor.
 	 *
-	 * Takes ownership of the provided socket.
-	 *
-	 * @param[in,out] sock Socket to take ownership over of.
+	 * Does not start listening, see listen().
 	 */
-	explicit socket(int sock);
+	server();
 
 	/** Destructor.
 	 *
-	 * Shutdowns and closes the internal socket. If the object was default
-	 * constructed, this does nothing.
+	 * Stops listening, if listening.
 	 */
-	~socket();
+	~server();
 
-	/** Shuts down the socket.
-	 *
-	 * Informs the networking stack to shutdown the socket in both
-	 * directions, so no more input or output packets will be accepted.
-	 */
-	void shutdown();
-
-	/** Closes the socket.
-	 *
-	 * Closes the socket and invalidates the internal handle.
-	 */
-	void close();
-
-	/** Move constructor.
-	 *
-	 * Moves the socket owned by the parameter to this object.
-	 *
-	 * @param[in,out] sock Object to move internal socket from.
-	 */
-	socket(socket&& sock);
-
-	/** Move assignment operator.
-	 *
-	 * Moves the socket owned by the parameter to this object.
-	 *
-	 * @param[in,out] sock Object to move internal socket from.
-	 *
-	 * @returns A reference to this object.
-	 */
-	socket& operator=(socket&& sock);
-
-	/** Delete copy constructor.
-	 *
-	 * Forbid copying this object.
-	 */
-	socket(const socket&) = delete;
-
-	/** Delete copy assignment operator.
-	 *
-	 * Forbid copying this object.
-	 */
-	socket& operator=(const socket&) = delete;
-
-	/** Gets the raw handle of the internal socket.
-	 *
-	 * Note, be very careful with what is done with the returned value, as
-	 * it effectively is out of the control of this socket. This method is
-	 * meant mostly as an escape valve for any features not exposed by this
-	 * class.
-	 *
-	 * @returns The raw handle of the internal socket.
-	 */
-	int get();
-
-private:
-	/// Internal socket handle
-	int socket_;
-};
-
-/** Custom deleter for struct addrinfo, for use with std::unique_ptr.
- */
-class addrinfo_deleter
-{
-public:
-	/** Deletes the provided addrinfo structure.
-	 *
-	 * @param[in,out] info addrinfo structure to delete.
-	 */
-	void operator()(addrinfo *info);
-};
-
-using addrinfo_ptr = std::unique_ptr<addrinfo, addrinfo_deleter>;
-
-/** Simple server class, leveraging socket wrapper.
- *
- * Currently only supports ipv4.
- */
-class server
-{
-public:
 	/** Starts listening on all IP addresses associated with the default
 	 * network interface at the provided port.
 	 *
 	 * @param[in] port Port number to listen at.
+	 * @param[in] callback Function to call for every request received.
+	 * @param[in] tls TLS configuration to serve connections with, or
+	 *  nullptr to serve them in the clear. Must outlive the server.
 	 *
 	 * @returns 0 on success, an error code otherwise.
 	 */
-	int listen(uint16_t port);
+	int listen(uint16_t port, request_callback callback, altcp_tls_config *tls = nullptr);
 
-	/** Blocks waiting for a new incoming connection.
+	/** Stops listening.
 	 *
-	 * @returns A socket on a successful connection, or an error code on a
-	 *  failure.
-	 */
-	std::expected<socket, int> accept();
-
-	/** Closes and shuts down the server socket.
+	 * Established connections are not affected.
 	 */
 	void close();
 
+	server(const server&) = delete;
+	server& operator=(const server&) = delete;
+
 private:
-	/// Socket used to listen
-	socket socket_ipv4;
+	static err_t accept(void *arg, tcp_pcb *pcb, err_t err);
+
+	/// PCB used to listen
+	tcp_pcb *pcb_;
+	request_callback callback_;
+	altcp_tls_config *tls_;
 };
 
 template<class T>
@@ -0,0 +1,249 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_SHA256_H_
+#define PCRB_SHA256_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <span>
+#include <string_view>
+
+namespace pcrb
+{
+
+/** SHA-256 hash (FIPS 180-4), usable at compile time.
+ *
+ * The RP2040 has no hashing hardware, and requests are tiny, so this is a
+ * plain implementation without the lookup tables or unrolling that only pay
+ * off on long messages.
+ */
+class sha256
+{
+public:
+	/// Size of the blocks the compression function works on.
+	static constexpr std::size_t block_size = 64;
+	/// Size of a digest.
+	static constexpr std::size_t digest_size = 32;
+
+	using digest = std::array<std::byte, digest_size>;
+
+	constexpr sha256()
+	:state_(initial_state), buffer_{}, buffered_(0), length_(0)
+	{}
+
+	/** Hashes more of the message.
+	 *
+	 * @param[in] data Next part of the message.
+	 */
+	constexpr void update(std::span<const std::byte> data)
+	{
+		length_ += data.size();
+		for (std::byte byte : data)
+		{
+			buffer_[buffered_++] = byte;
+			if (buffered_ == block_size)
+			{
+				compress();
+				buffered_ = 0;
+			}
+		}
+	}
+
+	/** Finishes hashing the message.
+	 *
+	 * The object must not be used afterwards, other than to be assigned to.
+	 *
+	 * @returns The digest of the message.
+	 */
+	constexpr digest finish()
+	{
+		uint64_t bits = length_ * 8;
+		buffer_[buffered_++] = std::byte(0x80);
+		if (buffered_ > block_size - 8)
+		{
+			while (buffered_ < block_size)
+				buffer_[buffered_++] = std::byte(0);
+			compress();
+			buffered_ = 0;
+		}
+		while (buffered_ < block_size - 8)
+			buffer_[buffered_++] = std::byte(0);
+		for (int i = 7; i >= 0; --i)
+			buffer_[buffered_++] = static_cast<std::byte>(bits >> (i * 8));
+		compress();
+
+		digest result{};
+		for (std::size_t i = 0; i < state_.size(); ++i)
+		{
+			for (std::size_t j = 0; j < 4; ++j)
+				result[i * 4 + j] = static_cast<std::byte>(state_[i] >> (24 - j * 8));
+		}
+		return result;
+	}
+
+private:
+	static constexpr std::array<uint32_t, 8> initial_state = {
+		0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+		0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+	};
+
+	static constexpr std::array<uint32_t, 64> round_constants = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+	};
+
+	constexpr void compress()
+	{
+		// Message schedule, kept as a 16 word ring to save stack
+		std::array<uint32_t, 16> w{};
+		for (std::size_t i = 0; i < w.size(); ++i)
+		{
+			w[i] = std::to_integer<uint32_t>(buffer_[i * 4]) << 24 |
+				std::to_integer<uint32_t>(buffer_[i * 4 + 1]) << 16 |
+				std::to_integer<uint32_t>(buffer_[i * 4 + 2]) << 8 |
+				std::to_integer<uint32_t>(buffer_[i * 4 + 3]);
+		}
+
+		auto [a, b, c, d, e, f, g, h] = state_;
+		for (std::size_t i = 0; i < round_constants.size(); ++i)
+		{
+			if (i >= 16)
+			{
+				uint32_t w15 = w[(i - 15) % 16];
+				uint32_t w2 = w[(i - 2) % 16];
+				uint32_t s0 = std::rotr(w15, 7) ^ std::rotr(w15, 18) ^ (w15 >> 3);
+				uint32_t s1 = std::rotr(w2, 17) ^ std::rotr(w2, 19) ^ (w2 >> 10);
+				w[i % 16] += s0 + w[(i - 7) % 16] + s1;
+			}
+
+			uint32_t s1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+			uint32_t choice = (e & f) ^ (~e & g);
+			uint32_t t1 = h + s1 + choice + round_constants[i] + w[i % 16];
+			uint32_t s0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+			uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+			uint32_t t2 = s0 + majority;
+
+			h = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+
+		state_[0] += a;
+		state_[1] += b;
+		state_[2] += c;
+		state_[3] += d;
+		state_[4] += e;
+		state_[5] += f;
+		state_[6] += g;
+		state_[7] += h;
+	}
+
+	std::array<uint32_t, 8> state_;
+	std::array<std::byte, block_size> buffer_;
+	std::size_t buffered_;
+	uint64_t length_;
+};
+
+/** HMAC-SHA256 (RFC 2104) with the key already folded into the hash states.
+ *
+ * The states after hashing the inner and outer padded keys are computed
+ * once, when constructing, so each message only costs the compression
+ * rounds for the message itself and one more for the outer hash.
+ */
+class hmac_sha256
+{
+public:
+	/** Constructor.
+	 *
+	 * Can be evaluated at compile time.
+	 *
+	 * @param[in] key Key, of any length.
+	 */
+	constexpr explicit hmac_sha256(std::string_view key)
+	{
+		std::array<std::byte, sha256::block_size> block{};
+		if (key.size() > block.size())
+		{
+			sha256 hashed;
+			for (char c : key)
+			{
+				std::byte byte = static_cast<std::byte>(c);
+				hashed.update(std::span(&byte, 1));
+			}
+			auto digest = hashed.finish();
+			std::ranges::copy(digest, block.begin());
+		}
+		else
+		{
+			for (std::size_t i = 0; i < key.size(); ++i)
+				block[i] = static_cast<std::byte>(key[i]);
+		}
+
+		for (std::byte& byte : block)
+			byte ^= std::byte(0x36);
+		inner_.update(block);
+		// 0x36 ^ 0x5c, to turn the inner pad into the outer one
+		for (std::byte& byte : block)
+			byte ^= std::byte(0x6a);
+		outer_.update(block);
+	}
+
+	/** Computes the tag of a message.
+	 *
+	 * @param[in] message Message to authenticate.
+	 *
+	 * @returns The tag of the message.
+	 */
+	constexpr sha256::digest sign(std::span<const std::byte> message) const
+	{
+		sha256 inner = inner_;
+		inner.update(message);
+		sha256::digest inner_digest = inner.finish();
+
+		sha256 outer = outer_;
+		outer.update(inner_digest);
+		return outer.finish();
+	}
+
+private:
+	sha256 inner_;
+	sha256 outer_;
+};
+
+/** Compares two byte sequences in time independent of their contents.
+ *
+ * @param[in] a First sequence.
+ * @param[in] b Second sequence.
+ *
+ * @returns True if both sequences have the same size and contents.
+ */
+constexpr bool constant_time_equal(std::span<const std::byte> a, std::span<const std::byte> b)
+{
+	if (a.size() != b.size())
+		return false;
+	// No early exit, so the time taken does not reveal where they differ
+	std::byte difference{};
+	for (std::size_t i = 0; i < a.size(); ++i)
+		difference |= a[i] ^ b[i];
+	return difference == std::byte(0);
+}
+
+}
+
+#endif//PCRB_SHA256_H_
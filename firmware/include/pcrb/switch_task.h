@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2024
+// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2026
 /// @file
 
 #ifndef PCRB_SWITCH_TASK_H_
@@ -9,6 +9,8 @@
 #include <queue.h>
 #include <task.h>
 
+#include <cstdint>
+
 namespace pcrb
 {
 
@@ -34,6 +36,26 @@ private:
 extern switch_queue switch_comms;
 void switch_task(void*);
 
+/** Queues a press of the PC power switch.
+ *
+ * Callers must be serialized with each other, as commands are, so presses
+ * are numbered in the order they are queued.
+ *
+ * @param[in] time_ms How long to hold the switch for, in milliseconds.
+ *
+ * @returns Number of the press, to pass to wait_for_press(), or 0 if a press
+ *  is already waiting to be made.
+ */
+uint32_t queue_press(unsigned time_ms);
+
+/** Waits for a press to be released.
+ *
+ * Only one task may wait at a time. Uses the calling task's notification.
+ *
+ * @param[in] press Number of the press, from queue_press().
+ */
+void wait_for_press(uint32_t press);
+
 }
 
 #endif//PCRB_ SWITCH_TASK_H_
@@ -0,0 +1,49 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_SYSLOG_TASK_H_
+#define PCRB_SYSLOG_TASK_H_
+
+#include <cstdint>
+
+namespace pcrb
+{
+
+/** Counters of the log shipper.
+ */
+struct syslog_stats
+{
+	/// Messages sent to the collector.
+	uint32_t sent;
+	/// Messages overwritten in the log before they could be sent.
+	uint32_t dropped;
+};
+
+/** Gets the counters of the log shipper.
+ *
+ * Safe to call from any task.
+ *
+ * @returns The counters since boot.
+ */
+syslog_stats syslog_counts();
+
+/** Log shipper task.
+ *
+ * Sends new pcrb::sys_log messages to the collector in secrets.h
+ * (SYSLOG_COLLECTOR, and optionally SYSLOG_PORT, 514 by default) as RFC 5424
+ * messages over UDP, one message per datagram as RFC 5426 requires.
+ *
+ * The task keeps a cursor into the log, so each message is sent once. While
+ * the network or the collector is unreachable the cursor stays put, and the
+ * log keeps overwriting its oldest messages as usual, so producers never
+ * wait on the shipper. Messages lost that way are counted, and reported in
+ * the log itself once shipping resumes.
+ *
+ * Does nothing if no collector is configured.
+ */
+void syslog_task(void*);
+
+}
+
+#endif//PCRB_SYSLOG_TASK_H_
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_TIMER_WHEEL_H_
+#define PCRB_TIMER_WHEEL_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace pcrb
+{
+
+/** Hashed timer wheel, for many coarse deadlines.
+ *
+ * Deadlines are kept in one of Slots lists, picked by their expiry tick, so
+ * scheduling and cancelling are constant time and each tick only looks at a
+ * single list. Deadlines further away than Slots ticks simply stay in their
+ * list for more than one turn of the wheel.
+ *
+ * The wheel does not keep time itself, advance() must be called once per
+ * tick. This is not thread-safe, all users must run from the same thread.
+ *
+ * @tparam Slots Number of lists in the wheel.
+ */
+template<std::size_t Slots>
+class timer_wheel
+{
+public:
+	/** A deadline, usually embedded in whatever it is the deadline of.
+	 */
+	struct entry
+	{
+		/// Function called once the deadline expires
+		void (*expire)(void *context) = nullptr;
+		/// Passed to expire
+		void *context = nullptr;
+
+		/** Checks whether the deadline is scheduled.
+		 *
+		 * @returns True if scheduled and not yet expired.
+		 */
+		bool armed() const
+		{
+			return link_ != nullptr;
+		}
+
+	private:
+		friend class timer_wheel;
+		entry *next_ = nullptr;
+		/// Pointer pointing at this entry, nullptr if not scheduled
+		entry **link_ = nullptr;
+		uint32_t expiry_ = 0;
+	};
+
+	/** Schedules a deadline, replacing any previous one of the entry.
+	 *
+	 * @param[in,out] deadline Entry to schedule.
+	 * @param[in] ticks Number of ticks from now until the deadline expires,
+	 *  must be at least 1.
+	 */
+	void schedule(entry& deadline, uint32_t ticks)
+	{
+		cancel(deadline);
+		deadline.expiry_ = now_ + ticks;
+		entry *&head = slots_[deadline.expiry_ % Slots];
+		deadline.next_ = head;
+		deadline.link_ = &head;
+		if (head)
+			head->link_ = &deadline.next_;
+		head = &deadline;
+	}
+
+	/** Cancels a deadline. Does nothing if it is not scheduled.
+	 *
+	 * @param[in,out] deadline Entry to cancel.
+	 */
+	void cancel(entry& deadline)
+	{
+		if (!deadline.link_)
+			return;
+		*deadline.link_ = deadline.next_;
+		if (deadline.next_)
+			deadline.next_->link_ = deadline.link_;
+		deadline.next_ = nullptr;
+		deadline.link_ = nullptr;
+	}
+
+	/** Moves the wheel forward one tick, expiring the deadlines due.
+	 *
+	 * Expire functions may cancel or schedule their own entry, but no
+	 * other.
+	 */
+	void advance()
+	{
+		++now_;
+		entry *deadline = slots_[now_ % Slots];
+		while (deadline)
+		{
+			entry *next = deadline->next_;
+			if (static_cast<int32_t>(deadline->expiry_ - now_) <= 0)
+			{
+				cancel(*deadline);
+				deadline->expire(deadline->context);
+			}
+			deadline = next;
+		}
+	}
+
+private:
+	std::array<entry*, Slots> slots_ = {};
+	uint32_t now_ = 0;
+};
+
+}
+
+#endif//PCRB_TIMER_WHEEL_H_
@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_TLS_H_
+#define PCRB_TLS_H_
+
+#include <lwip/altcp_tls.h>
+
+namespace pcrb
+{
+
+/** Gets the TLS configuration for the request server.
+ *
+ * The certificate and private key are TLS_CERT and TLS_KEY in secrets.h, as
+ * PEM strings. The configuration is created on the first call, and issues
+ * session tickets so returning clients can resume their session and skip
+ * the public key operations of a full handshake.
+ *
+ * mbedTLS allocates through lwIP, so handshakes and sessions live in the
+ * statically allocated lwIP heap (see MEM_SIZE), not in the FreeRTOS heap.
+ *
+ * Must not be called from the lwIP thread.
+ *
+ * @returns The configuration, or nullptr if TLS_CERT is not set or the
+ *  configuration could not be created.
+ */
+altcp_tls_config* tls_server_config();
+
+}
+
+#endif//PCRB_TLS_H_
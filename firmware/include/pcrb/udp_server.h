@@ -0,0 +1,63 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_UDP_SERVER_H_
+#define PCRB_UDP_SERVER_H_
+
+#include <cstdint>
+
+#include <lwip/udp.h>
+
+namespace pcrb
+{
+
+/** Single datagram request server, built directly on an lwIP UDP PCB.
+ *
+ * Each datagram is a 4 byte client nonce followed by a request, exactly as
+ * sent over TCP (without the TCP length prefix), authenticated or not (see
+ * pcrb::authenticate()). The reply is a single datagram with the same nonce
+ * followed by a binary response (see pcrb::response), so clients can match
+ * replies to requests and retry lost ones without a connection.
+ *
+ * Requests are handled from the lwIP thread, as soon as they arrive.
+ */
+class udp_server
+{
+public:
+	/** Constructor.
+	 *
+	 * Does not start listening, see listen().
+	 */
+	udp_server();
+
+	/** Destructor.
+	 *
+	 * Stops listening, if listening.
+	 */
+	~udp_server();
+
+	/** Starts listening on all IP addresses at the provided port.
+	 *
+	 * @param[in] port Port number to listen at.
+	 *
+	 * @returns 0 on success, an error code otherwise.
+	 */
+	int listen(uint16_t port);
+
+	/** Stops listening.
+	 */
+	void close();
+
+	udp_server(const udp_server&) = delete;
+	udp_server& operator=(const udp_server&) = delete;
+
+private:
+	static void receive(void *arg, udp_pcb *pcb, pbuf *p, const ip_addr_t *addr, u16_t port);
+
+	udp_pcb *pcb_;
+};
+
+}
+
+#endif//PCRB_UDP_SERVER_H_
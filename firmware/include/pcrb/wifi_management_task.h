@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2024
+// SPDX-FileCopyrightText: Gabriel Marcano, 2024 - 2026
 /// @file
 
 #ifndef PCRB_WIFI_MANAGEMENT_TASK_H_
@@ -11,6 +11,14 @@ namespace pcrb
 {
 
 extern std::atomic_bool wifi_initd;
+
+/** Checks whether the network is usable, which is the link being up with an
+ * IPv4 address or a global IPv6 address.
+ *
+ * @returns True if the network is usable.
+ */
+bool network_ready();
+
 void wifi_management_task(void*);
 
 }
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_WOL_SERVER_H_
+#define PCRB_WOL_SERVER_H_
+
+#include <cstdint>
+
+#include <lwip/udp.h>
+
+namespace pcrb
+{
+
+/** Wake-on-LAN listener, built directly on an lwIP UDP PCB.
+ *
+ * Magic packets (six 0xFF bytes followed by sixteen copies of a MAC address,
+ * anywhere in the datagram) addressed to the configured MAC press the power
+ * button, so existing WoL tooling can turn the PC on. Packets are matched in
+ * place in the received pbufs, from the lwIP thread.
+ *
+ * Senders usually repeat a packet several times, so only the first packet
+ * of a burst presses the button, and none do while the PC is already on, as
+ * a press would then start shutting it down.
+ *
+ * The MAC to match is WOL_MAC in secrets.h, as a string like
+ * "01:23:45:67:89:ab". Without it, listen() does nothing.
+ *
+ * Magic packets carry nothing to authenticate them with, so listen() also
+ * does nothing once AUTH_KEY is set (see pcrb::authentication_required()),
+ * as anyone on the LAN could otherwise turn the PC on.
+ */
+class wol_server
+{
+public:
+	/** Constructor.
+	 *
+	 * Does not start listening, see listen().
+	 */
+	wol_server();
+
+	/** Destructor.
+	 *
+	 * Stops listening, if listening.
+	 */
+	~wol_server();
+
+	/** Starts listening on all IP addresses at the provided port.
+	 *
+	 * @param[in] port Port number to listen at, usually 9.
+	 *
+	 * @returns 0 on success, an error code otherwise.
+	 */
+	int listen(uint16_t port);
+
+	/** Stops listening.
+	 */
+	void close();
+
+	wol_server(const wol_server&) = delete;
+	wol_server& operator=(const wol_server&) = delete;
+
+private:
+	static void receive(void *arg, udp_pcb *pcb, pbuf *p, const ip_addr_t *addr, u16_t port);
+
+	udp_pcb *pcb_;
+};
+
+}
+
+#endif//PCRB_WOL_SERVER_H_
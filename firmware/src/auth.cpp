@@ -0,0 +1,162 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/auth.h>
+#include <pcrb/protocol.h>
+#include <pcrb/server.h>
+#include <pcrb/sha256.h>
+// This secrets.h includes strings for WIFI_SSID and WIFI_PASSWORD, and
+// optionally AUTH_KEY
+#include "secrets.h"
+
+#include <pico/platform.h>
+#include <pico/time.h>
+#include <hardware/clocks.h>
+#include <hardware/structs/systick.h>
+
+#include <atomic>
+#include <cstring>
+#include <expected>
+#include <optional>
+#include <span>
+#include <utility>
+
+namespace pcrb
+{
+
+#ifdef AUTH_KEY
+// The padded key states are computed by the compiler, so there is nothing
+// left to do at boot
+static constexpr hmac_sha256 key_state(AUTH_KEY);
+
+// Only ever touched from the lwIP thread
+static replay_window window;
+#endif
+
+static std::atomic<uint32_t> checked = 0;
+static std::atomic<uint32_t> rejected = 0;
+static std::atomic<uint32_t> total_us = 0;
+static std::atomic<uint32_t> min_cycles = 0;
+static std::atomic<uint32_t> last_cycles = 0;
+
+// SysTick value, and the core it was read on, as each core has its own.
+struct cycle_stamp
+{
+	uint32_t core;
+	uint32_t count;
+};
+
+[[maybe_unused]] static cycle_stamp cycle_now()
+{
+	return { .core = get_core_num(), .count = systick_hw->cvr };
+}
+
+/** Counts the cycles between two SysTick readings.
+ *
+ * FreeRTOS runs SysTick from clk_sys, counting down and reloading every
+ * tick, which makes it the only cycle counter the M0+ has.
+ *
+ * @param[in] start Reading before the work.
+ * @param[in] end Reading after the work.
+ * @param[in] elapsed_us Time between the readings, from time_us_64().
+ *
+ * @returns The cycles in between, or nothing if they can't be told: SysTick
+ *  is not counting clk_sys, the task moved to the other core, or it took
+ *  long enough for SysTick to reload more than once.
+ */
+[[maybe_unused]] static std::optional<uint32_t> cycles_between(cycle_stamp start, cycle_stamp end, uint64_t elapsed_us)
+{
+	constexpr uint32_t counting = M0PLUS_SYST_CSR_ENABLE_BITS | M0PLUS_SYST_CSR_CLKSOURCE_BITS;
+	if ((systick_hw->csr & counting) != counting || start.core != end.core)
+		return std::nullopt;
+
+	uint32_t period = systick_hw->rvr + 1;
+	if (elapsed_us * (clock_get_hz(clk_sys) / 1000000) >= period)
+		return std::nullopt;
+	return start.count >= end.count ? start.count - end.count : start.count + period - end.count;
+}
+
+static std::unexpected<response> failure(auth_failure reason)
+{
+	rejected.fetch_add(1, std::memory_order_relaxed);
+	return std::unexpected(response(response_status::unauthorized, no_command, std::to_underlying(reason)));
+}
+
+bool authentication_required()
+{
+#ifdef AUTH_KEY
+	return true;
+#else
+	return false;
+#endif
+}
+
+std::expected<std::span<const std::byte>, response> authenticate(std::span<const std::byte> frame)
+{
+	uint32_t magic = 0;
+	if (frame.size() >= sizeof(magic))
+	{
+		memcpy(&magic, frame.data(), sizeof(magic));
+		magic = ntoh(magic);
+	}
+
+	if (magic != authenticated_magic)
+	{
+		if (authentication_required())
+			return failure(auth_failure::missing);
+		return frame;
+	}
+
+	// Too short to even hold the envelope, so it can't be authentic
+	if (frame.size() < auth_overhead)
+		return failure(auth_failure::bad_tag);
+
+#ifdef AUTH_KEY
+	auto signed_part = frame.first(frame.size() - sha256::digest_size);
+	auto tag = frame.last<sha256::digest_size>();
+
+	uint64_t start = time_us_64();
+	cycle_stamp start_cycles = cycle_now();
+	sha256::digest expected = key_state.sign(signed_part);
+	bool valid = constant_time_equal(expected, tag);
+	cycle_stamp end_cycles = cycle_now();
+	uint64_t elapsed = time_us_64() - start;
+	total_us.fetch_add(static_cast<uint32_t>(elapsed), std::memory_order_relaxed);
+	checked.fetch_add(1, std::memory_order_relaxed);
+	if (auto cycles = cycles_between(start_cycles, end_cycles, elapsed))
+	{
+		// Only written from here, on the lwIP thread
+		uint32_t quickest = min_cycles.load(std::memory_order_relaxed);
+		if (!quickest || *cycles < quickest)
+			min_cycles.store(*cycles, std::memory_order_relaxed);
+		last_cycles.store(*cycles, std::memory_order_relaxed);
+	}
+	if (!valid)
+		return failure(auth_failure::bad_tag);
+
+	uint64_t counter;
+	memcpy(&counter, frame.data() + 4, sizeof(counter));
+	counter = ntoh(counter);
+	if (!window.accept(counter))
+		return failure(auth_failure::replayed);
+
+	return signed_part.subspan(4 + sizeof(counter));
+#else
+	// Nothing to check the tag against
+	return failure(auth_failure::bad_tag);
+#endif
+}
+
+auth_stats authentication_stats()
+{
+	return {
+		.checked = checked.load(std::memory_order_relaxed),
+		.rejected = rejected.load(std::memory_order_relaxed),
+		.total_us = total_us.load(std::memory_order_relaxed),
+		.min_cycles = min_cycles.load(std::memory_order_relaxed),
+		.last_cycles = last_cycles.load(std::memory_order_relaxed),
+	};
+}
+
+}
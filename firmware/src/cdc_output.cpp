@@ -0,0 +1,103 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/cdc_output.h>
+
+#include <tusb.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+namespace pcrb
+{
+
+// Longest wait for a wake up, in case it came before the writer slept
+constexpr const TickType_t transmit_poll_period = pdMS_TO_TICKS(10);
+
+// How long the host can go without taking anything before output is
+// dropped
+constexpr const TickType_t stall_timeout = pdMS_TO_TICKS(1000);
+
+// Task waiting for room in the FIFO
+static std::atomic<TaskHandle_t> waiting_task = nullptr;
+
+cdc_output::cdc_output()
+:size_(0), dropping_(false)
+{}
+
+cdc_output::~cdc_output()
+{
+	flush();
+}
+
+void cdc_output::write(std::string_view text)
+{
+	while (!text.empty())
+	{
+		std::size_t amount = std::min(text.size(), chunk_.size() - size_);
+		memcpy(chunk_.data() + size_, text.data(), amount);
+		size_ += amount;
+		text.remove_prefix(amount);
+		if (size_ == chunk_.size())
+			send();
+	}
+}
+
+void cdc_output::flush()
+{
+	send();
+	if (!dropping_)
+		tud_cdc_write_flush();
+}
+
+void cdc_output::transmitted()
+{
+	if (TaskHandle_t task = waiting_task.load(std::memory_order_acquire))
+		xTaskNotifyGive(task);
+}
+
+void cdc_output::send()
+{
+	std::span<const char> data(chunk_.data(), size_);
+	size_ = 0;
+	TickType_t progress = xTaskGetTickCount();
+	while (!data.empty() && !dropping_)
+	{
+		// Nobody is listening
+		if (!tud_cdc_connected())
+		{
+			dropping_ = true;
+			break;
+		}
+
+		uint32_t written = tud_cdc_write(data.data(), data.size());
+		data = data.subspan(written);
+		if (data.empty())
+			break;
+
+		TickType_t now = xTaskGetTickCount();
+		if (written)
+			progress = now;
+		else if ((now - progress) >= stall_timeout)
+		{
+			dropping_ = true;
+			break;
+		}
+
+		// The FIFO is full, so have it sent and wait for the host to take
+		// some
+		tud_cdc_write_flush();
+		waiting_task.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+		ulTaskNotifyTake(pdTRUE, transmit_poll_period);
+		waiting_task.store(nullptr, std::memory_order_release);
+	}
+}
+
+}
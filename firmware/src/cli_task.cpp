@@ -1,13 +1,16 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2024
+// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2026
 /// @file
 
 #include <pcrb/cli_task.h>
-#include <pcrb/switch_task.h>
-#include <pcrb/usb.h>
-#include <pcrb/monitor_task.h>
+#include <pcrb/cdc_output.h>
+#include <pcrb/commands.h>
+#include <pcrb/perfect_hash.h>
+#include <pcrb/request_handler.h>
+#include <pcrb/auth.h>
+#include <pcrb/log.h>
+#include <pcrb/syslog_task.h>
 
-#include <gpico/log.h>
 #include <gpico/reset.h>
 
 #include <pico/unique_id.h>
@@ -15,157 +18,305 @@
 #include <pico/cyw43_arch.h>
 #include <pico/bootrom.h>
 
+
+#include <tusb.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
 #include <cstdint>
-#include <cstdio>
 #include <algorithm>
+#include <atomic>
 #include <limits>
 #include <span>
 #include <charconv>
+#include <array>
+#include <string_view>
+#include <vector>
 
-using gpico::sys_log;
+using pcrb::sys_log;
 
-void toggle(uint32_t time)
+static void status(pcrb::cdc_output& out)
 {
-	unsigned data = std::clamp<unsigned>(time, 0, std::numeric_limits<unsigned>::max());
-	xQueueSendToBack(pcrb::switch_comms.get(), &data, 0);
-}
+	out.print("IP Address: {}\r\n", ip4addr_ntoa(netif_ip4_addr(netif_list)));
+	for (int i = 0; i < LWIP_IPV6_NUM_ADDRESSES; ++i)
+	{
+		if (ip6_addr_isvalid(netif_ip6_addr_state(netif_list, i)))
+			out.print("IPv6 Address: {}\r\n", ip6addr_ntoa(netif_ip6_addr(netif_list, i)));
+	}
+	out.print("default instance: {}\r\n", static_cast<const void*>(netif_default));
+	out.print("NETIF is up? {}\r\n", netif_is_up(netif_default) ? "yes" : "no");
+	out.print("NETIF flags: 0x{:02X}\r\n", netif_default->flags);
+	out.print("Wifi state: {}\r\n", cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA));
 
-static void command(std::string_view input, std::span<char> output)
-{
-	if (input.starts_with("toggle"))
+	int32_t rssi = 0;
+	cyw43_wifi_get_rssi(&cyw43_state, &rssi);
+	out.print("  RSSI: {}\r\n", rssi);
+	uint32_t pm_state = 0;
+	cyw43_wifi_get_pm(&cyw43_state, &pm_state);
+	out.print("power mode: 0x{:08X}\r\n", pm_state);
+	using deadline = pcrb::request_handler::deadline;
+	out.print("evictions: setup {}, header {}, body {}, idle {}\r\n",
+		pcrb::request_handler::evictions(deadline::setup),
+		pcrb::request_handler::evictions(deadline::header),
+		pcrb::request_handler::evictions(deadline::body),
+		pcrb::request_handler::evictions(deadline::idle));
+	auto replies = pcrb::request_handler::reply_counts();
+	out.print("replies: {} in {} writes, {} segments\r\n",
+		replies.replies, replies.writes, replies.segments);
+	pcrb::auth_stats auth = pcrb::authentication_stats();
+	out.print("auth: {}, checked {}, rejected {}, {} us per check, {} cycles min, {} last\r\n",
+		pcrb::authentication_required() ? "required" : "optional", auth.checked, auth.rejected,
+		auth.checked ? auth.total_us / auth.checked : 0, auth.min_cycles, auth.last_cycles);
+	pcrb::syslog_stats shipped = pcrb::syslog_counts();
+	out.print("syslog: sent {}, dropped {}\r\n", shipped.sent, shipped.dropped);
+	out.print("ticks: {}\r\n", xTaskGetTickCount());
+	out.print("FreeRTOS Heap Free: {}\r\n", xPortGetFreeHeapSize());
+	UBaseType_t number_of_tasks = uxTaskGetNumberOfTasks();
+	out.print("Tasks active: {}\r\n", number_of_tasks);
+	std::vector<TaskStatus_t> tasks(number_of_tasks);
+	uxTaskGetSystemState(tasks.data(), tasks.size(), nullptr);
+	for (auto& status: tasks)
 	{
-		unsigned long ms = 0;
-		std::from_chars(input.substr(7).data(), input.substr(7).data() + input.substr(7).size(), ms);
-		if (ms != 0)
-		{
-			snprintf(output.data(), output.size(), "Toggling switch for %lu milliseconds\r\n", ms);
-			toggle(ms);
-		}
+		out.print("  task name: {}\r\n", status.pcTaskName);
+		out.print("    task mark: {}\r\n", status.usStackHighWaterMark);
+		out.print("    task counter: {}\r\n", status.ulRunTimeCounter);
+		out.print("    task priority: {}\r\n", status.uxCurrentPriority);
 	}
 
-	if (input == "sense")
+	char foo[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
+	pico_get_unique_board_id_string(foo, sizeof(foo));
+	out.print("unique id: {}\r\n", foo);
+
+	out.print("log size: {} in {} bytes, dropped {}, rate limited {}, repeats {}, see \"log tail\"\r\n",
+		sys_log.size(), sys_log.bytes_used(), sys_log.dropped(), sys_log.limited(), sys_log.repeated());
+}
+
+static void print_log_line(pcrb::cdc_output& out, const pcrb::log_line& line)
+{
+	out.print("log {} ({} us) {}: {}\r\n", line.sequence, line.timestamp_us,
+		pcrb::log_level_name(line.level), line.view());
+}
+
+static void last_boot(pcrb::cdc_output& out)
+{
+	std::array<pcrb::log_line, 4> lines;
+	std::size_t next = 0;
+	for (;;)
 	{
-		snprintf(output.data(), output.size(), "sense: %u\r\n", pcrb::current_pc_state());
+		std::size_t count = pcrb::read_previous_boot_log(next, lines);
+		for (const pcrb::log_line& line: std::span(lines).first(count))
+			print_log_line(out, line);
+		next += count;
+		if (count < lines.size())
+			break;
 	}
+	if (!next)
+		out.write("nothing logged during the previous boot\r\n");
+}
+
+// Splits off the first word of input
+static std::string_view next_word(std::string_view& input)
+{
+	std::string_view word = input.substr(0, input.find(' '));
+	input.remove_prefix(std::min(word.size() + 1, input.size()));
+	return word;
+}
 
-	else if (input == "get_boot")
+// Messages of the current boot, optionally filtered:
+//  log tail [count] [level] [text]
+//  log since <sequence> [level] [text]
+static void log_command(std::string_view arguments, pcrb::cdc_output& out)
+{
+	std::string_view mode = next_word(arguments);
+	bool tail = mode == "tail";
+	if (!tail && mode != "since")
 	{
-		snprintf(output.data(), output.size(), "boot select: %u\r\n", pcrb::get_boot_select());
+		out.write("usage: log tail [count] [level] [text], log since <sequence> [level] [text]\r\n");
+		return;
 	}
 
-	else if (input.starts_with("set_boot"))
+	// The last screenful by default
+	uint32_t number = 20;
+	std::string_view rest = arguments;
+	std::string_view word = next_word(rest);
+	auto [end, err] = std::from_chars(word.data(), word.data() + word.size(), number);
+	if (err == std::errc() && end == word.data() + word.size() && !word.empty())
+		arguments = rest;
+	else if (!tail)
 	{
-		unsigned long select = 0;
-        std::from_chars(input.substr(9).data(), input.substr(9).data() + input.substr(9).size(), select);
-		pcrb::set_boot_select(select);
-		snprintf(output.data(), output.size(), "set boot select: %lu, actual %u\r\n", select, pcrb::get_boot_select());
+		out.write("usage: log since <sequence> [level] [text]\r\n");
+		return;
 	}
 
-	else if (input == "status")
+	pcrb::log_filter filter;
+	rest = arguments;
+	word = next_word(rest);
+	for (pcrb::log_level level: {pcrb::log_level::debug, pcrb::log_level::info, pcrb::log_level::warning, pcrb::log_level::error})
 	{
-		size_t amount = 0;
-		amount += snprintf(output.data() + amount, output.size() - amount, "IP Address: %s\r\n", ip4addr_ntoa(netif_ip4_addr(netif_list)));
-		amount += snprintf(output.data() + amount, output.size() - amount, "default instance: 0x%p\r\n", netif_default);
-		amount += snprintf(output.data() + amount, output.size() - amount, "NETIF is up? %s\r\n", netif_is_up(netif_default) ? "yes" : "no");
-		amount += snprintf(output.data() + amount, output.size() - amount, "NETIF flags: 0x%02X\r\n", netif_default->flags);
-		amount += snprintf(output.data() + amount, output.size() - amount, "Wifi state: %d\r\n", cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA));
-
-		int32_t rssi = 0;
-		cyw43_wifi_get_rssi(&cyw43_state, &rssi);
-		amount += snprintf(output.data() + amount, output.size() - amount, "  RSSI: %ld\r\n", rssi);
-		uint32_t pm_state = 0;
-		cyw43_wifi_get_pm(&cyw43_state, &pm_state);
-		amount += snprintf(output.data() + amount, output.size() - amount, "power mode: 0x%08lX\r\n", pm_state);
-		amount += snprintf(output.data() + amount, output.size() - amount, "ticks: %lu\r\n", xTaskGetTickCount());
-		amount += snprintf(output.data() + amount, output.size() - amount, "FreeRTOS Heap Free: %u\r\n", xPortGetFreeHeapSize());
-		UBaseType_t number_of_tasks = uxTaskGetNumberOfTasks();
-		amount += snprintf(output.data() + amount, output.size() - amount, "Tasks active: %lu\r\n", number_of_tasks);
-		std::vector<TaskStatus_t> tasks(number_of_tasks);
-		uxTaskGetSystemState(tasks.data(), tasks.size(), nullptr);
-		for (auto& status: tasks)
+		if (word == pcrb::log_level_name(level))
 		{
-			amount += snprintf(output.data() + amount, output.size() - amount, "  task name: %s\r\n", status.pcTaskName);
-			amount += snprintf(output.data() + amount, output.size() - amount, "    task mark: %lu\r\n", status.usStackHighWaterMark);
-			amount += snprintf(output.data() + amount, output.size() - amount, "    task counter: %lu\r\n", status.ulRunTimeCounter);
-			amount += snprintf(output.data() + amount, output.size() - amount, "    task priority: %lu\r\n", status.uxCurrentPriority);
+			filter.level = level;
+			arguments = rest;
 		}
+	}
+	filter.text = arguments;
+
+	uint32_t cursor = tail ? sys_log.tail(filter, number) : number;
+	std::array<pcrb::log_line, 4> lines;
+	for (;;)
+	{
+		uint32_t previous = cursor;
+		std::size_t count = sys_log.query(filter, cursor, lines);
+		for (const pcrb::log_line& line: std::span(lines).first(count))
+			print_log_line(out, line);
+		// Pages stop early on a filter that matches little
+		if (cursor == previous)
+			break;
+	}
+}
 
-		char foo[2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1];
-		pico_get_unique_board_id_string(foo, sizeof(foo));
-		amount += snprintf(output.data() + amount, output.size() - amount, "unique id: %s\r\n", foo);
+// Commands only available from the CLI, the rest come from the shared
+// command table
+enum class cli_command
+{
+	status,
+	programming,
+	reboot,
+	lastboot,
+	log,
+};
+
+static constexpr std::array<std::string_view, 5> cli_command_names = {
+	"status",
+	"programming",
+	"reboot",
+	"lastboot",
+	"log",
+};
 
-		amount += snprintf(output.data() + amount, output.size() - amount, "log size: %u\r\n", sys_log.size());
-		for (size_t i = 0; i < sys_log.size(); ++i)
+static constexpr pcrb::perfect_hash cli_commands(cli_command_names);
+
+static void command(std::string_view input, pcrb::cdc_output& out)
+{
+	std::string_view name = input.substr(0, input.find(' '));
+	std::string_view arguments = input.substr(std::min(name.size() + 1, input.size()));
+
+	if (const pcrb::command* command_ = pcrb::find_command(name))
+	{
+		uint32_t argument = 0;
+		if (command_->argument == pcrb::argument_type::u32)
 		{
-			amount += snprintf(output.data() + amount, output.size() - amount, "log %u: %s\r\n", i, sys_log[i].c_str());
+			auto [end, err] = std::from_chars(arguments.data(), arguments.data() + arguments.size(), argument);
+			if (err != std::errc() || end != arguments.data() + arguments.size())
+			{
+				out.print("usage: {} <number>\r\n", name);
+				return;
+			}
 		}
+		pcrb::response result = pcrb::execute(*command_, argument);
+		std::array<char, pcrb::max_description_size> text;
+		out.print("{}\r\n", pcrb::describe(*command_, argument, result, text));
+		return;
 	}
 
-	if (input == "programming")
+	auto index = cli_commands.find(name);
+	if (!index)
 	{
-		snprintf(output.data(), output.size(), "Rebooting into programming mode...\r\n");
-		gpico::bootsel_reset();
+		if (!input.empty())
+			out.print("unknown command: {}\r\n", input);
+		return;
 	}
 
-	if (input == "reboot")
+	switch (static_cast<cli_command>(*index))
 	{
-		snprintf(output.data(), output.size(), "Killing (hanging)...\r\n");
-		gpico::flash_reset();
+		case cli_command::status:
+			status(out);
+			break;
+		case cli_command::programming:
+			out.write("Rebooting into programming mode...\r\n");
+			out.flush();
+			pcrb::persist_log();
+			gpico::bootsel_reset();
+			break;
+		case cli_command::reboot:
+			out.write("Killing (hanging)...\r\n");
+			out.flush();
+			pcrb::persist_log();
+			gpico::flash_reset();
+			break;
+		case cli_command::lastboot:
+			last_boot(out);
+			break;
+		case cli_command::log:
+			log_command(arguments, out);
+			break;
 	}
 }
 
-static void run(const char* line, std::string& buffer)
+namespace pcrb
 {
-	command(line, std::span(buffer.data(), buffer.data() + buffer.size()));
-	printf("%s", buffer.data());
-	fflush(stdout);
-}
 
-namespace pcrb
+// Set once the CLI task is ready to be woken up
+static std::atomic<TaskHandle_t> cli_handle = nullptr;
+
+void cli_input_ready()
 {
+	if (TaskHandle_t task = cli_handle.load(std::memory_order_acquire))
+		xTaskNotifyGive(task);
+}
 
 void cli_task(void*)
 {
-	std::string buffer(32*1024, '\0');
-	char line[33] = {0};
-	int pos = 0;
-	printf("> ");
+	// Room for log filters
+	char line[65] = {0};
+	std::size_t pos = 0;
+	cli_handle.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+	{
+		cdc_output out;
+		out.write("> ");
+	}
 	for(;;)
 	{
-		fflush(stdout);
-		int c = fgetc(stdin);
-		if (c != EOF)
+		// Anything that arrived before the task got here is read before
+		// going to sleep, so no wake up is missed
+		std::array<char, CFG_TUD_CDC_EP_BUFSIZE> input;
+		while (uint32_t count = tud_cdc_read(input.data(), input.size()))
 		{
-			if (c == '\r')
-			{
-				printf("\r\n");
-				line[pos] = '\0';
-				run(line, buffer);
-				memset(line, 0, sizeof(line));
-				pos = 0;
-				printf("> ");
-				continue;
-			}
-			if (c == '\b')
+			// The echo for a whole packet goes out in one go
+			cdc_output out;
+			for (char c: std::span(input).first(count))
 			{
-				if (pos > 0)
+				if (c == '\r')
 				{
-					--pos;
-					printf("\b \b");
+					out.write("\r\n");
+					line[pos] = '\0';
+					::command(line, out);
+					memset(line, 0, sizeof(line));
+					pos = 0;
+					out.write("> ");
+					continue;
+				}
+				if (c == '\b')
+				{
+					if (pos > 0)
+					{
+						--pos;
+						out.write("\b \b");
+					}
+					continue;
 				}
-				continue;
-			}
 
-			if (pos < (sizeof(line) - 1))
-			{
-				line[pos++] = c;
-				printf("%c", c);
+				if (pos < (sizeof(line) - 1))
+				{
+					line[pos++] = c;
+					out.write(std::string_view(&c, 1));
+				}
 			}
 		}
-		else
-		{
-			printf("WTF, we got an EOF?\r\n");
-		}
+
+		// Nothing to do until more arrives, however long that takes
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 	}
 }
 
@@ -0,0 +1,241 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/commands.h>
+#include <pcrb/format_fixed.h>
+#include <pcrb/perfect_hash.h>
+#include <pcrb/protocol.h>
+#include <pcrb/monitor_task.h>
+#include <pcrb/switch_task.h>
+#include <pcrb/usb.h>
+#include <pcrb/server.h>
+
+#include <pico/mutex.h>
+
+#include <algorithm>
+#include <array>
+#include <format>
+#include <string_view>
+#include <utility>
+#include <cstring>
+
+namespace pcrb
+{
+
+// Serializes commands across the network, UDP, and CLI front ends
+auto_init_recursive_mutex(command_mutex);
+
+// How long a command waits for another front end's command or batch to
+// finish before giving up as busy, in milliseconds
+constexpr const uint32_t command_wait_ms = 100;
+
+// Last press queued by toggle, under command_mutex
+static uint32_t last_press = 0;
+
+static response toggle(uint32_t time)
+{
+	// The switch only queues one press at a time
+	uint32_t press = queue_press(time);
+	if (!press)
+		return response(response_status::busy, std::to_underlying(opcode::toggle), time);
+	last_press = press;
+	return response(response_status::ok, std::to_underlying(opcode::toggle), time);
+}
+
+static response get_boot(uint32_t)
+{
+	uint32_t select = get_boot_select();
+	return response(response_status::ok, std::to_underlying(opcode::get_boot), select);
+}
+
+static response set_boot(uint32_t select)
+{
+	set_boot_select(select);
+	uint32_t actual = get_boot_select();
+	return response(response_status::ok, std::to_underlying(opcode::set_boot), actual);
+}
+
+static response sense(uint32_t)
+{
+	bool state = current_pc_state();
+	return response(response_status::ok, std::to_underlying(opcode::sense), state);
+}
+
+static constexpr auto commands = std::to_array<command>({
+	{ "toggle", opcode::toggle, argument_type::u32, toggle, "Received network toggle request {0}" },
+	{ "get_boot", opcode::get_boot, argument_type::none, get_boot, "boot select: {1}" },
+	{ "set_boot", opcode::set_boot, argument_type::u32, set_boot, "Received boot select request {0}, boot select: {1}" },
+	{ "sense", opcode::sense, argument_type::none, sense, "PC 3.3V rail status: {1}" },
+});
+
+static constexpr auto command_names = []
+{
+	std::array<std::string_view, commands.size()> result;
+	std::ranges::transform(commands, result.begin(), &command::name);
+	return result;
+}();
+
+static constexpr perfect_hash by_name(command_names);
+
+// Opcodes are small and dense, so they index straight into this table
+static constexpr auto by_opcode = []
+{
+	constexpr auto max = std::ranges::max(commands, {}, &command::code).code;
+	std::array<const command*, std::to_underlying(max) + 1> result{};
+	for (const auto& command_ : commands)
+	{
+		result[std::to_underlying(command_.code)] = &command_;
+	}
+	return result;
+}();
+
+const command* find_command(std::string_view name)
+{
+	auto index = by_name.find(name);
+	return index ? &commands[*index] : nullptr;
+}
+
+const command* find_command(opcode code)
+{
+	auto index = std::to_underlying(code);
+	return (index < by_opcode.size()) ? by_opcode[index] : nullptr;
+}
+
+response execute(const command& command_, uint32_t argument)
+{
+	// Batches hold on to the mutex while waiting for presses
+	if (!recursive_mutex_enter_timeout_ms(&command_mutex, command_wait_ms))
+		return response(response_status::busy, std::to_underlying(command_.code), argument);
+	response result = command_.run(argument);
+	recursive_mutex_exit(&command_mutex);
+	return result;
+}
+
+response try_execute(const command& command_, uint32_t argument)
+{
+	// The lwIP thread serves every connection, so it doesn't wait at all
+	uint32_t owner;
+	if (!recursive_mutex_try_enter(&command_mutex, &owner))
+		return response(response_status::busy, std::to_underlying(command_.code), argument);
+	response result = command_.run(argument);
+	recursive_mutex_exit(&command_mutex);
+	return result;
+}
+
+std::size_t request_size(const command& command_)
+{
+	return command_.argument == argument_type::u32 ? 12 : 8;
+}
+
+std::string_view describe(const command& command_, uint32_t argument, const response& result, std::span<char> output)
+{
+	if (result.status != response_status::ok)
+		return describe(result, output);
+
+	if (result.type == payload_type::boolean)
+	{
+		bool value = result.value;
+		return vformat_fixed(output, command_.text, std::make_format_args(argument, value));
+	}
+	uint32_t value = result.value;
+	return vformat_fixed(output, command_.text, std::make_format_args(argument, value));
+}
+
+std::string_view describe(const reply& reply_, std::span<char> output)
+{
+	if (!reply_.command_)
+		return describe(reply_.binary, output);
+	return describe(*reply_.command_, reply_.argument, reply_.binary, output);
+}
+
+reply run_request(const request& request_)
+{
+	const command* command_ = find_command(static_cast<opcode>(request_.code));
+	if (!command_)
+		return { response(response_status::unknown_command, request_.code), nullptr, 0 };
+
+	if (request_.size != request_size(*command_))
+	{
+		response error(response_status::bad_size, request_.code, static_cast<uint32_t>(request_.size));
+		return { error, nullptr, 0 };
+	}
+
+	response result = try_execute(*command_, request_.argument);
+	return { result, command_, request_.argument };
+}
+
+std::span<const std::byte> batch_reply::binary() const
+{
+	return std::span(buffer).first(size);
+}
+
+std::string_view describe(const batch_reply& reply_, std::span<char> output)
+{
+	if (!reply_.steps)
+		return describe(reply_.batch, output);
+
+	std::span<char> rest = output;
+	rest = rest.subspan(format_fixed(rest, "batch of {} steps, ran {}", reply_.steps, reply_.batch.value).size());
+	for (const reply& step: std::span(reply_.replies).first(reply_.batch.value))
+	{
+		rest = rest.subspan(format_fixed(rest, "; ").size());
+		rest = rest.subspan(describe(step, rest).size());
+	}
+	return std::string_view(output.data(), output.size() - rest.size());
+}
+
+void run_batch(const request& request_, batch_reply& result)
+{
+	auto steps = request_.payload;
+	size_t count = steps.size() / batch_step_size;
+	if (steps.empty() || (steps.size() % batch_step_size) || count > max_batch_steps)
+	{
+		result.batch = response(response_status::bad_size, request_.code, static_cast<uint32_t>(request_.size));
+		result.steps = 0;
+		result.size = result.batch.encode(std::span(result.buffer).first<response::max_size>()).size();
+		return;
+	}
+
+	// The batch response goes first, but it depends on how the steps went, so
+	// it is filled in last
+	size_t size = response::max_size;
+	response_status status = response_status::ok;
+	uint32_t ran = 0;
+
+	recursive_mutex_enter_blocking(&command_mutex);
+	for (; ran < count && status == response_status::ok; ++ran)
+	{
+		auto step = steps.subspan(ran * batch_step_size, batch_step_size);
+		uint32_t code;
+		uint32_t argument;
+		memcpy(&code, step.data(), 4);
+		memcpy(&argument, step.data() + 4, 4);
+		code = ntoh(code);
+		argument = ntoh(argument);
+
+		const command* command_ = find_command(static_cast<opcode>(code));
+		response step_result = command_ ?
+			execute(*command_, command_->argument == argument_type::u32 ? argument : 0) :
+			response(response_status::unknown_command, code);
+
+		// A toggle only queues the press, so later steps, like sensing the
+		// rail, would otherwise run before the switch is even pressed
+		if (command_ && command_->code == opcode::toggle && step_result.status == response_status::ok)
+			wait_for_press(last_press);
+
+		size += step_result.encode(std::span(result.buffer).subspan(size).first<response::max_size>()).size();
+		result.replies[ran] = { step_result, command_, argument };
+		status = step_result.status;
+	}
+	recursive_mutex_exit(&command_mutex);
+
+	// The batch response, with its u32 payload, exactly fills the space left
+	// for it before the steps
+	result.batch = response(status, request_.code, ran);
+	result.batch.encode(std::span(result.buffer).first<response::max_size>());
+	result.size = size;
+	result.steps = count;
+}
+
+}
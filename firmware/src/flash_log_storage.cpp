@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/flash_log_storage.h>
+#include <pcrb/log_storage.h>
+
+#include <pico/flash.h>
+#include <hardware/flash.h>
+#include <hardware/regs/addressmap.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// Set by the linker to the end of the image in flash
+extern "C" char __flash_binary_end;
+
+namespace pcrb
+{
+
+static_assert(persistent_log_storage<flash_log_storage>);
+
+// How long to wait for the other core to get out of the way
+constexpr const uint32_t flash_lockout_timeout_ms = 1000;
+
+namespace
+{
+
+struct sector_write
+{
+	uint32_t offset;
+	const std::byte *data;
+};
+
+}
+
+// Runs with the other core parked and interrupts off
+static void erase_and_program(void *param)
+{
+	const sector_write *write = static_cast<const sector_write*>(param);
+	flash_range_erase(write->offset, FLASH_SECTOR_SIZE);
+	flash_range_program(write->offset, reinterpret_cast<const uint8_t*>(write->data), FLASH_SECTOR_SIZE);
+}
+
+flash_log_storage::flash_log_storage()
+{
+	uint32_t image_end = reinterpret_cast<uintptr_t>(&__flash_binary_end) - XIP_BASE;
+	uint32_t spare_start = (image_end + FLASH_SECTOR_SIZE - 1) & ~(FLASH_SECTOR_SIZE - 1);
+	std::size_t spare = spare_start < PICO_FLASH_SIZE_BYTES ?
+		(PICO_FLASH_SIZE_BYTES - spare_start) / FLASH_SECTOR_SIZE : 0;
+	sectors_ = std::min(spare, max_sectors);
+	offset_ = PICO_FLASH_SIZE_BYTES - sectors_ * FLASH_SECTOR_SIZE;
+}
+
+std::size_t flash_log_storage::sectors() const
+{
+	return sectors_;
+}
+
+void flash_log_storage::read(std::size_t sector, std::size_t offset, std::span<std::byte> output) const
+{
+	// Flash is memory mapped, and programming it flushes the XIP cache
+	const std::byte *data = reinterpret_cast<const std::byte*>(XIP_BASE + offset_ + sector * FLASH_SECTOR_SIZE + offset);
+	memcpy(output.data(), data, output.size());
+}
+
+bool flash_log_storage::write(std::size_t sector, std::span<const std::byte> data)
+{
+	sector_write write = { static_cast<uint32_t>(offset_ + sector * FLASH_SECTOR_SIZE), data.data() };
+	return flash_safe_execute(erase_and_program, &write, flash_lockout_timeout_ms) == PICO_OK;
+}
+
+}
@@ -0,0 +1,301 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/http_parser.h>
+
+#include <algorithm>
+#include <charconv>
+#include <span>
+#include <string_view>
+
+namespace pcrb
+{
+
+static bool equals_ignore_case(std::string_view a, std::string_view b)
+{
+	auto lower = [](char c) { return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c; };
+	return std::ranges::equal(a, b, {}, lower, lower);
+}
+
+http_parser::http_parser()
+{
+	reset();
+}
+
+void http_parser::reset()
+{
+	target_size_ = 0;
+	token_size_ = 0;
+	token_overflow_ = false;
+	header_bytes_ = 0;
+	body_left_ = 0;
+	error_code_ = 0;
+	step_ = step::method;
+	header_ = header::other;
+	method_ = method::unknown;
+	keep_alive_ = false;
+	started_ = false;
+}
+
+std::size_t http_parser::feed(std::span<const char> data)
+{
+	std::size_t used = 0;
+	if (!data.empty())
+		started_ = true;
+
+	while (used < data.size() && step_ != step::done && step_ != step::error)
+	{
+		if (step_ == step::body)
+		{
+			std::size_t skipped = std::min(body_left_, data.size() - used);
+			used += skipped;
+			body_left_ -= skipped;
+			if (!body_left_)
+				step_ = step::done;
+			continue;
+		}
+
+		char c = data[used++];
+		if (++header_bytes_ > max_header_size)
+		{
+			fail(431);
+			break;
+		}
+
+		// Line endings are LF, with an optional CR before it
+		if (c == '\r')
+			continue;
+
+		switch (step_)
+		{
+			case step::method:
+				// Empty lines before the request line are skipped (RFC 9112
+				// section 2.2), as some clients send an extra CRLF after a
+				// body. They still count against max_header_size.
+				if (c == '\n' && !token_size_)
+					break;
+				if (c == ' ')
+					end_method();
+				else if (!accumulate(c))
+					fail(501);
+				break;
+			case step::target:
+				if (c == ' ')
+				{
+					step_ = step::version;
+				}
+				else if (c == '\n')
+				{
+					fail(400);
+				}
+				else if (target_size_ == target_.size())
+				{
+					fail(414);
+				}
+				else
+				{
+					target_[target_size_++] = c;
+				}
+				break;
+			case step::version:
+				if (c == '\n')
+					end_version();
+				else if (!accumulate(c))
+					fail(505);
+				break;
+			case step::line_start:
+				if (c == '\n')
+				{
+					end_headers();
+				}
+				else
+				{
+					step_ = step::header_name;
+					accumulate(c);
+				}
+				break;
+			case step::header_name:
+				if (c == ':')
+					end_header_name();
+				else if (c == '\n')
+					fail(400);
+				else
+					accumulate(c);
+				break;
+			case step::header_value:
+				if (c == '\n')
+					end_header_value();
+				// Skip leading whitespace
+				else if (token_size_ || (c != ' ' && c != '\t'))
+					accumulate(c);
+				break;
+			case step::body:
+			case step::done:
+			case step::error:
+				break;
+		}
+	}
+	return used;
+}
+
+bool http_parser::accumulate(char c)
+{
+	if (token_size_ == token_.size())
+	{
+		token_overflow_ = true;
+		return false;
+	}
+	token_[token_size_++] = c;
+	return true;
+}
+
+void http_parser::fail(unsigned code)
+{
+	error_code_ = code;
+	step_ = step::error;
+}
+
+void http_parser::end_method()
+{
+	std::string_view name(token_.data(), token_size_);
+	if (name == "GET")
+		method_ = method::get;
+	else if (name == "POST")
+		method_ = method::post;
+	else if (name == "PUT")
+		method_ = method::put;
+	token_size_ = 0;
+	step_ = step::target;
+}
+
+void http_parser::end_version()
+{
+	std::string_view version(token_.data(), token_size_);
+	token_size_ = 0;
+	if (target_size_ == 0)
+	{
+		fail(400);
+		return;
+	}
+	if (version == "HTTP/1.1")
+		keep_alive_ = true;
+	else if (version == "HTTP/1.0")
+		keep_alive_ = false;
+	else
+	{
+		fail(505);
+		return;
+	}
+	step_ = step::line_start;
+}
+
+void http_parser::end_header_name()
+{
+	std::string_view name(token_.data(), token_size_);
+	header_ = header::other;
+	if (!token_overflow_)
+	{
+		if (equals_ignore_case(name, "connection"))
+			header_ = header::connection;
+		else if (equals_ignore_case(name, "content-length"))
+			header_ = header::content_length;
+		else if (equals_ignore_case(name, "transfer-encoding"))
+			header_ = header::transfer_encoding;
+	}
+	token_size_ = 0;
+	token_overflow_ = false;
+	step_ = step::header_value;
+}
+
+void http_parser::end_header_value()
+{
+	// Trim trailing whitespace
+	while (token_size_ && (token_[token_size_ - 1] == ' ' || token_[token_size_ - 1] == '\t'))
+		--token_size_;
+	std::string_view value(token_.data(), token_size_);
+	bool overflow = token_overflow_;
+	token_size_ = 0;
+	token_overflow_ = false;
+	step_ = step::line_start;
+
+	switch (header_)
+	{
+		case header::other:
+			break;
+		case header::connection:
+			if (equals_ignore_case(value, "close"))
+				keep_alive_ = false;
+			else if (equals_ignore_case(value, "keep-alive"))
+				keep_alive_ = true;
+			break;
+		case header::content_length:
+		{
+			std::size_t length = 0;
+			auto [end, err] = std::from_chars(value.data(), value.data() + value.size(), length);
+			if (overflow || err == std::errc::result_out_of_range)
+				fail(413);
+			else if (err != std::errc() || end != value.data() + value.size())
+				fail(400);
+			else if (length > max_body_size)
+				fail(413);
+			else
+				body_left_ = length;
+			break;
+		}
+		case header::transfer_encoding:
+			// Chunked bodies are not supported
+			fail(501);
+			break;
+	}
+}
+
+void http_parser::end_headers()
+{
+	if (method_ == method::unknown)
+	{
+		fail(501);
+		return;
+	}
+	step_ = body_left_ ? step::body : step::done;
+}
+
+http_parser::status http_parser::state() const
+{
+	switch (step_)
+	{
+		case step::done:
+			return status::complete;
+		case step::error:
+			return status::error;
+		default:
+			return status::incomplete;
+	}
+}
+
+unsigned http_parser::error_code() const
+{
+	return error_code_;
+}
+
+bool http_parser::started() const
+{
+	return started_;
+}
+
+http_parser::method http_parser::request_method() const
+{
+	return method_;
+}
+
+std::string_view http_parser::target() const
+{
+	return std::string_view(target_.data(), target_size_);
+}
+
+bool http_parser::keep_alive() const
+{
+	return keep_alive_;
+}
+
+}
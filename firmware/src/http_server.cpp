@@ -0,0 +1,409 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/http_server.h>
+#include <pcrb/http_parser.h>
+#include <pcrb/commands.h>
+#include <pcrb/protocol.h>
+#include <pcrb/format_fixed.h>
+#include <pcrb/auth.h>
+#include <pcrb/log.h>
+
+#include <pico/cyw43_arch.h>
+
+#include <lwip/tcp.h>
+#include <lwip/pbuf.h>
+#include <lwip/err.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include <errno.h>
+
+namespace pcrb
+{
+
+// HTTP clients are expected to be few, mostly scripts
+constexpr const std::size_t http_max_connections = 2;
+
+// Requests must arrive in full within this long of their first byte.
+constexpr const TickType_t request_timeout = pdMS_TO_TICKS(5000);
+
+// Keep-alive connections idle between requests for this long are closed.
+constexpr const TickType_t keep_alive_timeout = pdMS_TO_TICKS(30 * 1000);
+
+// How often lwIP calls on_poll, in TCP coarse timer ticks (500 ms each).
+constexpr const u8_t poll_interval = 2;
+
+struct route
+{
+	http_parser::method method;
+	std::string_view path;
+	/// Name of the shared command run for the route
+	std::string_view command;
+};
+
+static constexpr auto routes = std::to_array<route>({
+	{ http_parser::method::get, "/sense", "sense" },
+	{ http_parser::method::post, "/toggle", "toggle" },
+	{ http_parser::method::get, "/boot", "get_boot" },
+	{ http_parser::method::put, "/boot", "set_boot" },
+	{ http_parser::method::post, "/boot", "set_boot" },
+});
+
+struct http_connection
+{
+	tcp_pcb *pcb;
+	http_parser parser;
+	/// Start of the current request, or of the idle time before it
+	TickType_t since;
+};
+
+// Only ever touched from the lwIP thread
+static std::array<std::optional<http_connection>, http_max_connections> connections;
+
+static std::string_view reason_phrase(unsigned code)
+{
+	switch (code)
+	{
+		case 200: return "OK";
+		case 400: return "Bad Request";
+		case 403: return "Forbidden";
+		case 404: return "Not Found";
+		case 405: return "Method Not Allowed";
+		case 408: return "Request Timeout";
+		case 413: return "Content Too Large";
+		case 414: return "URI Too Long";
+		case 431: return "Request Header Fields Too Large";
+		case 500: return "Internal Server Error";
+		case 501: return "Not Implemented";
+		case 503: return "Service Unavailable";
+		case 505: return "HTTP Version Not Supported";
+		default: return "Unknown";
+	}
+}
+
+static std::string_view status_name(response_status status)
+{
+	switch (status)
+	{
+		case response_status::ok: return "ok";
+		case response_status::bad_size: return "bad_size";
+		case response_status::bad_magic: return "bad_magic";
+		case response_status::unknown_command: return "unknown_command";
+		case response_status::timeout: return "timeout";
+		case response_status::error: return "error";
+		case response_status::busy: return "busy";
+		case response_status::unauthorized: return "unauthorized";
+		case response_status::bad_argument: return "bad_argument";
+	}
+	return "unknown";
+}
+
+static bool reply(http_connection& connection, unsigned code, std::string_view body, bool keep_alive)
+{
+	std::array<char, 160> head_buffer;
+	std::string_view head = format_fixed(head_buffer,
+		"HTTP/1.1 {} {}\r\n"
+		"Content-Type: application/json\r\n"
+		"Content-Length: {}\r\n"
+		"Connection: {}\r\n"
+		"\r\n",
+		code, reason_phrase(code), body.size(), keep_alive ? "keep-alive" : "close");
+
+	// Sent together with any other replies when the received data has been
+	// handled
+	err_t err = tcp_write(connection.pcb, head.data(), head.size(), TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE);
+	if (err == ERR_OK)
+		err = tcp_write(connection.pcb, body.data(), body.size(), TCP_WRITE_FLAG_COPY);
+	if (err != ERR_OK)
+	{
+		sys_log.push<"http: unable to reply, error {}", log_level::warning>(err);
+		return false;
+	}
+	return true;
+}
+
+static bool reply_error(http_connection& connection, unsigned code, bool keep_alive)
+{
+	std::array<char, 64> body_buffer;
+	std::string_view body = format_fixed(body_buffer, "{{\"error\":\"{}\"}}", reason_phrase(code));
+	return reply(connection, code, body, keep_alive);
+}
+
+static std::optional<uint32_t> query_value(std::string_view query)
+{
+	constexpr std::string_view key = "value=";
+	while (!query.empty())
+	{
+		std::string_view parameter = query.substr(0, query.find('&'));
+		query.remove_prefix(std::min(parameter.size() + 1, query.size()));
+		if (!parameter.starts_with(key))
+			continue;
+
+		parameter.remove_prefix(key.size());
+		uint32_t value = 0;
+		auto [end, err] = std::from_chars(parameter.data(), parameter.data() + parameter.size(), value);
+		if (err != std::errc() || end != parameter.data() + parameter.size())
+			return std::nullopt;
+		return value;
+	}
+	return std::nullopt;
+}
+
+// Returns whether the connection should be kept open
+static bool handle_request(http_connection& connection)
+{
+	const http_parser& parser = connection.parser;
+	bool keep_alive = parser.keep_alive();
+	std::string_view target = parser.target();
+	std::string_view path = target.substr(0, target.find('?'));
+	std::string_view query = target.substr(std::min(path.size() + 1, target.size()));
+
+	auto matches = [path](const route& route_) { return route_.path == path; };
+	auto route_ = std::ranges::find_if(routes, [&](const route& candidate)
+	{
+		return matches(candidate) && candidate.method == parser.request_method();
+	});
+	if (route_ == routes.end())
+	{
+		unsigned code = std::ranges::any_of(routes, matches) ? 405 : 404;
+		return reply_error(connection, code, keep_alive) && keep_alive;
+	}
+
+	// There is no way to authenticate HTTP requests, so only reads are
+	// allowed once requests must be authenticated
+	if (authentication_required() && route_->method != http_parser::method::get)
+		return reply_error(connection, 403, keep_alive) && keep_alive;
+
+	const command *command_ = find_command(route_->command);
+	uint32_t argument = 0;
+	if (command_->argument == argument_type::u32)
+	{
+		auto value = query_value(query);
+		if (!value)
+			return reply_error(connection, 400, keep_alive) && keep_alive;
+		argument = *value;
+	}
+
+	response result = try_execute(*command_, argument);
+	sys_log.push<"http: {} {}: status {}, value {}">(
+		command_->name, argument, std::to_underlying(result.status), result.value);
+
+	unsigned code = 200;
+	if (result.status == response_status::busy)
+		code = 503;
+	else if (result.status == response_status::bad_argument)
+		code = 400;
+	else if (result.status != response_status::ok)
+		code = 500;
+
+	std::array<char, 128> body_buffer;
+	std::string_view body;
+	switch (result.type)
+	{
+		case payload_type::boolean:
+			body = format_fixed(body_buffer, "{{\"command\":\"{}\",\"status\":\"{}\",\"value\":{}}}",
+				command_->name, status_name(result.status), result.value != 0);
+			break;
+		case payload_type::u32:
+			body = format_fixed(body_buffer, "{{\"command\":\"{}\",\"status\":\"{}\",\"value\":{}}}",
+				command_->name, status_name(result.status), result.value);
+			break;
+		default:
+			body = format_fixed(body_buffer, "{{\"command\":\"{}\",\"status\":\"{}\"}}",
+				command_->name, status_name(result.status));
+			break;
+	}
+	return reply(connection, code, body, keep_alive) && keep_alive;
+}
+
+static err_t close_connection(http_connection *connection)
+{
+	err_t result = ERR_OK;
+	tcp_pcb *pcb = connection->pcb;
+	if (pcb)
+	{
+		tcp_arg(pcb, nullptr);
+		tcp_recv(pcb, nullptr);
+		tcp_err(pcb, nullptr);
+		tcp_poll(pcb, nullptr, 0);
+		if (tcp_close(pcb) != ERR_OK)
+		{
+			tcp_abort(pcb);
+			result = ERR_ABRT;
+		}
+	}
+
+	auto slot = std::ranges::find_if(connections,
+		[connection](auto& entry){ return entry && &*entry == connection; });
+	slot->reset();
+	return result;
+}
+
+static err_t on_recv(void *arg, tcp_pcb *pcb, pbuf *p, err_t err)
+{
+	http_connection *connection = static_cast<http_connection*>(arg);
+	if (err != ERR_OK)
+	{
+		if (p)
+			pbuf_free(p);
+		return ERR_OK;
+	}
+	if (!p)
+		return close_connection(connection);
+
+	// Parse straight out of the received pbufs
+	bool keep_open = true;
+	for (pbuf *q = p; q && keep_open; q = q->next)
+	{
+		std::span<const char> data(static_cast<const char*>(q->payload), q->len);
+		while (!data.empty() && keep_open)
+		{
+			http_parser& parser = connection->parser;
+			if (!parser.started())
+				connection->since = xTaskGetTickCount();
+			data = data.subspan(parser.feed(data));
+
+			switch (parser.state())
+			{
+				case http_parser::status::incomplete:
+					break;
+				case http_parser::status::complete:
+					keep_open = handle_request(*connection);
+					parser.reset();
+					connection->since = xTaskGetTickCount();
+					break;
+				case http_parser::status::error:
+					reply_error(*connection, parser.error_code(), false);
+					keep_open = false;
+					break;
+			}
+		}
+	}
+
+	// Everything is consumed even when closing, as closing with unread data
+	// resets the connection and throws away the replies
+	tcp_recved(pcb, p->tot_len);
+	pbuf_free(p);
+	tcp_output(pcb);
+	if (!keep_open)
+		return close_connection(connection);
+	return ERR_OK;
+}
+
+static err_t on_poll(void *arg, tcp_pcb *pcb)
+{
+	http_connection *connection = static_cast<http_connection*>(arg);
+	TickType_t elapsed = xTaskGetTickCount() - connection->since;
+	if (connection->parser.started())
+	{
+		if (elapsed <= request_timeout)
+			return ERR_OK;
+		reply_error(*connection, 408, false);
+		tcp_output(pcb);
+	}
+	else if (elapsed <= keep_alive_timeout)
+	{
+		return ERR_OK;
+	}
+	return close_connection(connection);
+}
+
+static void on_err(void *arg, err_t)
+{
+	// lwIP already freed the PCB
+	http_connection *connection = static_cast<http_connection*>(arg);
+	connection->pcb = nullptr;
+	close_connection(connection);
+}
+
+http_server::http_server()
+:pcb_(nullptr)
+{}
+
+http_server::~http_server()
+{
+	close();
+}
+
+int http_server::listen(uint16_t port)
+{
+	close();
+
+	cyw43_arch_lwip_begin();
+	tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+	if (!pcb)
+	{
+		cyw43_arch_lwip_end();
+		return ENOMEM;
+	}
+
+	ip_set_option(pcb, SOF_REUSEADDR);
+	err_t err = tcp_bind(pcb, IP_ANY_TYPE, port);
+	if (err != ERR_OK)
+	{
+		tcp_close(pcb);
+		cyw43_arch_lwip_end();
+		return err_to_errno(err);
+	}
+
+	tcp_pcb *listener = tcp_listen(pcb);
+	if (!listener)
+	{
+		tcp_close(pcb);
+		cyw43_arch_lwip_end();
+		return ENOMEM;
+	}
+
+	tcp_accept(listener, accept);
+	pcb_ = listener;
+	cyw43_arch_lwip_end();
+	return 0;
+}
+
+void http_server::close()
+{
+	if (!pcb_)
+		return;
+	cyw43_arch_lwip_begin();
+	tcp_accept(pcb_, nullptr);
+	tcp_close(pcb_);
+	cyw43_arch_lwip_end();
+	pcb_ = nullptr;
+}
+
+err_t http_server::accept(void*, tcp_pcb *pcb, err_t err)
+{
+	if (err != ERR_OK || !pcb)
+	{
+		sys_log.push<"http: unable to accept connection, error {}", log_level::warning>(err);
+		return ERR_VAL;
+	}
+
+	auto slot = std::ranges::find_if(connections, [](auto& entry){ return !entry.has_value(); });
+	if (slot == connections.end())
+	{
+		sys_log.push<"http: too many connections, dropping new connection", log_level::warning>();
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+
+	http_connection& connection = slot->emplace(pcb, http_parser(), xTaskGetTickCount());
+	tcp_arg(pcb, &connection);
+	tcp_recv(pcb, on_recv);
+	tcp_err(pcb, on_err);
+	tcp_poll(pcb, on_poll, poll_interval);
+	return ERR_OK;
+}
+
+}
@@ -1,13 +1,656 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2024
+// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2026
 /// @file
 
 #include <pcrb/log.h>
-#include <pcrb/syslog.h>
+#include <pcrb/persistent_log.h>
+#include <pcrb/flash_log_storage.h>
+
+#include <pico/mutex.h>
+#include <pico/platform.h>
+#include <hardware/sync.h>
+#include <pico/time.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <format>
+#include <span>
+#include <string_view>
+#include <variant>
 
 namespace pcrb
 {
 
-safe_syslog<syslog<1024*128>> sys_log;
+// Packed messages take about 8 bytes, so this holds around 3900, with the
+// checkpoints and kinds in under 32 KB, more than the 128 KB text log this
+// replaced, which held about 3800
+constexpr const std::size_t log_bytes = 30 * 1024;
+
+// Enough for 4096 messages, which is more than fit unless most are repeats
+// of messages without arguments
+constexpr const std::size_t log_checkpoints = 128;
+
+// How often the log task looks for new messages to echo
+constexpr const TickType_t log_echo_period = pdMS_TO_TICKS(100);
+
+// Longest time repeats of a message are held back before being counted in
+// the log, so a message repeated forever still shows up
+constexpr const uint64_t repeat_report_us = 30000000;
+
+// Shortest time between sector writes forced by errors, so a burst of them
+// doesn't wear out the flash
+constexpr const TickType_t error_flush_period = pdMS_TO_TICKS(10000);
+
+// Longest time messages wait in RAM for the rest of their sector, so a hang
+// on a quiet day still leaves something behind
+constexpr const TickType_t idle_flush_period = pdMS_TO_TICKS(10 * 60 * 1000);
+
+static std::array<std::byte, log_bytes> log_storage;
+static std::array<packed_log::checkpoint, log_checkpoints> log_checkpoint_storage;
+event_log sys_log(log_storage, log_checkpoint_storage);
+
+// Everything below is guarded by persist_lock
+auto_init_mutex(persist_lock);
+static flash_log_storage flash;
+static persistent_log<flash_log_storage> persisted(flash);
+static bool persisted_open = false;
+// Next message to echo and persist
+static uint32_t persisted_next = 0;
+
+std::string_view log_level_name(log_level level)
+{
+	switch (level)
+	{
+		case log_level::debug:
+			return "debug";
+		case log_level::info:
+			return "info";
+		case log_level::warning:
+			return "warning";
+		case log_level::error:
+			return "error";
+	}
+	return "unknown";
+}
+
+namespace
+{
+
+using decoded_arg = std::variant<std::monostate, uint32_t, int32_t, uint64_t, int64_t, bool, std::string_view>;
+
+// Output iterator for std::vformat_to() that drops whatever does not fit.
+// Copies share the position, as the formatting functions copy iterators
+// around freely.
+class bounded_output
+{
+public:
+	using difference_type = std::ptrdiff_t;
+
+	struct position
+	{
+		char *next;
+		char *end;
+	};
+
+	explicit bounded_output(position& at)
+	:at_(&at)
+	{}
+
+	bounded_output& operator*()
+	{
+		return *this;
+	}
+
+	bounded_output& operator=(char c)
+	{
+		if (at_->next != at_->end)
+			*at_->next++ = c;
+		return *this;
+	}
+
+	bounded_output& operator++()
+	{
+		return *this;
+	}
+
+	bounded_output operator++(int)
+	{
+		return *this;
+	}
+
+private:
+	position *at_;
+};
+
+template<class T>
+static T load(const std::byte *data)
+{
+	T value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+static std::size_t decode(std::span<const std::byte> args, std::span<decoded_arg> decoded)
+{
+	std::size_t count = 0;
+	std::size_t offset = 0;
+	while (offset < args.size() && count < decoded.size())
+	{
+		const std::byte *data = args.data() + offset + 1;
+		switch (static_cast<log_arg>(args[offset]))
+		{
+			case log_arg::u32:
+				decoded[count] = load<uint32_t>(data);
+				offset += 1 + sizeof(uint32_t);
+				break;
+			case log_arg::i32:
+				decoded[count] = load<int32_t>(data);
+				offset += 1 + sizeof(int32_t);
+				break;
+			case log_arg::u64:
+				decoded[count] = load<uint64_t>(data);
+				offset += 1 + sizeof(uint64_t);
+				break;
+			case log_arg::i64:
+				decoded[count] = load<int64_t>(data);
+				offset += 1 + sizeof(int64_t);
+				break;
+			case log_arg::boolean:
+				decoded[count] = load<bool>(data);
+				offset += 1 + sizeof(bool);
+				break;
+			case log_arg::string:
+			{
+				std::size_t size = static_cast<uint8_t>(*data);
+				decoded[count] = std::string_view(reinterpret_cast<const char*>(data + 1), size);
+				offset += 2 + size;
+				break;
+			}
+			default:
+				return count;
+		}
+		++count;
+	}
+	return count;
+}
+
+}
+
+std::size_t log_entry::render(std::span<char> output) const
+{
+	if (output.empty())
+		return 0;
+
+	bounded_output::position at = { output.data(), output.data() + output.size() - 1 };
+	bounded_output out(at);
+	if (!format)
+	{
+		*at.next = '\0';
+		return 0;
+	}
+
+	std::array<decoded_arg, event_log::max_args> decoded;
+	std::size_t count = decode(std::span(args).first(args_size), decoded);
+
+	std::string_view text = format->text;
+	std::size_t next_arg = 0;
+	for (std::size_t i = 0; i < text.size(); ++i)
+	{
+		char c = text[i];
+		// Escaped braces, the format was checked at compile time so a lone
+		// '}' can't happen
+		if ((c == '{' || c == '}') && i + 1 < text.size() && text[i + 1] == c)
+		{
+			out = c;
+			++i;
+			continue;
+		}
+		if (c != '{')
+		{
+			out = c;
+			continue;
+		}
+
+		// A replacement field, with an optional argument index and format
+		// spec, e.g. {}, {0} or {:#x}
+		std::size_t close = text.find('}', i);
+		std::string_view field = text.substr(i + 1, close - i - 1);
+		i = close;
+		std::size_t index = next_arg++;
+		if (!field.empty() && field[0] >= '0' && field[0] <= '9')
+		{
+			index = 0;
+			while (!field.empty() && field[0] >= '0' && field[0] <= '9')
+			{
+				index = index * 10 + (field[0] - '0');
+				field.remove_prefix(1);
+			}
+		}
+
+		if (index >= count)
+		{
+			out = '?';
+			continue;
+		}
+
+		// Only this one argument is formatted, with the spec of the field
+		std::array<char, 32> spec;
+		std::size_t spec_size = std::min(field.size(), spec.size() - 2);
+		spec[0] = '{';
+		memcpy(spec.data() + 1, field.data(), spec_size);
+		spec[spec_size + 1] = '}';
+		std::string_view single(spec.data(), spec_size + 2);
+		std::visit([&](const auto& value) {
+			if constexpr (std::same_as<std::remove_cvref_t<decltype(value)>, std::monostate>)
+				out = '?';
+			else
+				std::vformat_to(out, single, std::make_format_args(value));
+		}, decoded[index]);
+	}
+	*at.next = '\0';
+	return at.next - output.data();
+}
+
+void log_entry::render(log_line& line) const
+{
+	line.sequence = sequence;
+	line.timestamp_us = timestamp_us;
+	line.level = level();
+	line.size = render(line.text);
+}
+
+bool log_filter::matches(const log_line& line) const
+{
+	return line.level >= level && line.view().find(text) != std::string_view::npos;
+}
+
+event_log::event_log(std::span<std::byte> storage, std::span<packed_log::checkpoint> checkpoints)
+:entries_(storage, checkpoints), dropped_(0), repeats_(0), first_repeat_us_(0),
+	last_repeat_us_(0), repeated_(0)
+{
+	mutex_init(&lock_);
+}
+
+void event_log::push(const log_entry& entry)
+{
+	// Only the header and the arguments actually used are copied
+	std::size_t size = offsetof(log_entry, args) + entry.args_size;
+	// Keeps tasks and handlers on this core from interleaving, and the task
+	// from moving to the other core. The other core is left alone.
+	uint32_t interrupts = save_and_disable_interrupts();
+	core_ring& ring = cores_[get_core_num()];
+	uint32_t head = ring.head.load(std::memory_order_relaxed);
+	log_entry& slot = ring.entries[head % core_ring_size];
+	memcpy(&slot, &entry, size);
+	slot.timestamp_us = time_us_64();
+	ring.head.store(head + 1, std::memory_order_release);
+	restore_interrupts(interrupts);
+}
+
+bool event_log::admit(rate_limit& limit, uint32_t& suppressed)
+{
+	// As with pushing, each core has its own bucket, so nothing is shared
+	uint32_t interrupts = save_and_disable_interrupts();
+	uint32_t core = get_core_num();
+	rate_limit::bucket& bucket = limit.cores[core];
+	uint64_t now = time_us_64();
+	uint64_t elapsed = now - bucket.refilled_us;
+	if (elapsed >= rate_limit_period_us)
+	{
+		uint64_t earned = elapsed / rate_limit_period_us;
+		if (bucket.tokens + earned >= rate_limit_burst)
+		{
+			bucket.tokens = rate_limit_burst;
+			bucket.refilled_us = now;
+		}
+		else
+		{
+			bucket.tokens += earned;
+			bucket.refilled_us += earned * rate_limit_period_us;
+		}
+	}
+
+	bool admitted = bucket.tokens > 0;
+	if (admitted)
+	{
+		--bucket.tokens;
+		suppressed = bucket.suppressed;
+		bucket.suppressed = 0;
+	}
+	else
+	{
+		++bucket.suppressed;
+		std::atomic<uint32_t>& limited = cores_[core].limited;
+		limited.store(limited.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+	restore_interrupts(interrupts);
+	return admitted;
+}
+
+bool event_log::take(core_ring& ring, uint32_t until, log_entry& entry)
+{
+	for (;;)
+	{
+		// The slot of the oldest entry is the one the core writes next, so
+		// it can't be trusted
+		uint32_t head = ring.head.load(std::memory_order_acquire);
+		if (head - ring.tail >= core_ring_size)
+		{
+			dropped_ += head - ring.tail - (core_ring_size - 1);
+			ring.tail = head - (core_ring_size - 1);
+		}
+		if (static_cast<int32_t>(ring.tail - until) >= 0)
+			return false;
+
+		entry = ring.entries[ring.tail % core_ring_size];
+		// If the core got around to the slot while it was being copied, the
+		// copy may be torn, so try again with what is now the oldest
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (ring.head.load(std::memory_order_relaxed) - ring.tail < core_ring_size)
+		{
+			++ring.tail;
+			return true;
+		}
+	}
+}
+
+void event_log::collect()
+{
+	// Only what was there to begin with, so a core that keeps logging can't
+	// keep the reader here forever
+	std::array<uint32_t, 2> until;
+	for (std::size_t core = 0; core < cores_.size(); ++core)
+		until[core] = cores_[core].head.load(std::memory_order_acquire);
+
+	std::array<log_entry, 2> next;
+	std::array<bool, 2> held = {};
+	for (;;)
+	{
+		for (std::size_t core = 0; core < cores_.size(); ++core)
+		{
+			if (!held[core])
+				held[core] = take(cores_[core], until[core], next[core]);
+		}
+
+		// Oldest first, so the numbering follows the order things happened
+		// in across cores
+		std::size_t core;
+		if (held[0] && held[1])
+			core = next[1].timestamp_us < next[0].timestamp_us ? 1 : 0;
+		else if (held[0] || held[1])
+			core = held[0] ? 0 : 1;
+		else
+			break;
+
+		append(next[core]);
+		held[core] = false;
+	}
+
+	if (repeats_ && (time_us_64() - first_repeat_us_) >= repeat_report_us)
+		end_repeats();
+}
+
+void event_log::append(const log_entry& entry)
+{
+	if (entry.format == last_.format && entry.args_size == last_.args_size &&
+		memcmp(entry.args.data(), last_.args.data(), entry.args_size) == 0)
+	{
+		if (!repeats_++)
+			first_repeat_us_ = entry.timestamp_us;
+		last_repeat_us_ = entry.timestamp_us;
+		++repeated_;
+		return;
+	}
+
+	end_repeats();
+	entries_.append(entry);
+	memcpy(&last_, &entry, offsetof(log_entry, args) + entry.args_size);
+}
+
+void event_log::end_repeats()
+{
+	if (!repeats_)
+		return;
+
+	log_entry note;
+	switch (last_.level())
+	{
+		case log_level::debug:
+			note.format = &log_format_v<"last message repeated {} times", log_level::debug>;
+			break;
+		case log_level::info:
+			note.format = &log_format_v<"last message repeated {} times", log_level::info>;
+			break;
+		case log_level::warning:
+			note.format = &log_format_v<"last message repeated {} times", log_level::warning>;
+			break;
+		case log_level::error:
+			note.format = &log_format_v<"last message repeated {} times", log_level::error>;
+			break;
+	}
+	note.add(repeats_);
+	note.timestamp_us = last_repeat_us_;
+	entries_.append(note);
+	repeats_ = 0;
+}
+
+bool event_log::read(uint32_t sequence, log_entry& entry)
+{
+	mutex_enter_blocking(&lock_);
+	collect();
+	bool held = entries_.read(sequence, entry);
+	mutex_exit(&lock_);
+	return held;
+}
+
+uint32_t event_log::first()
+{
+	mutex_enter_blocking(&lock_);
+	collect();
+	uint32_t result = entries_.first();
+	mutex_exit(&lock_);
+	return result;
+}
+
+uint32_t event_log::end()
+{
+	mutex_enter_blocking(&lock_);
+	collect();
+	uint32_t result = entries_.end();
+	mutex_exit(&lock_);
+	return result;
+}
+
+std::size_t event_log::size()
+{
+	mutex_enter_blocking(&lock_);
+	collect();
+	std::size_t result = entries_.end() - entries_.first();
+	mutex_exit(&lock_);
+	return result;
+}
+
+std::size_t event_log::bytes_used()
+{
+	mutex_enter_blocking(&lock_);
+	collect();
+	std::size_t result = entries_.used();
+	mutex_exit(&lock_);
+	return result;
+}
+
+uint32_t event_log::limited() const
+{
+	uint32_t result = 0;
+	for (const core_ring& ring: cores_)
+		result += ring.limited.load(std::memory_order_relaxed);
+	return result;
+}
+
+uint32_t event_log::repeated()
+{
+	mutex_enter_blocking(&lock_);
+	collect();
+	uint32_t result = repeated_;
+	mutex_exit(&lock_);
+	return result;
+}
+
+uint32_t event_log::dropped()
+{
+	mutex_enter_blocking(&lock_);
+	collect();
+	uint32_t result = dropped_;
+	mutex_exit(&lock_);
+	return result;
+}
+
+std::size_t event_log::query(const log_filter& filter, uint32_t& cursor, std::span<log_line> lines)
+{
+	// Collected once, and nothing is overwritten while the lock is held, so
+	// the page is read straight from the log proper
+	mutex_enter_blocking(&lock_);
+	collect();
+	uint32_t oldest = entries_.first();
+	uint32_t newest = entries_.end();
+	if (static_cast<int32_t>(cursor - oldest) < 0)
+		cursor = oldest;
+	// Nothing has been logged there yet
+	if (static_cast<int32_t>(cursor - newest) > 0)
+		cursor = newest;
+
+	std::size_t count = 0;
+	for (std::size_t scanned = 0; cursor != newest && count < lines.size() && scanned < query_scan_limit;
+		++cursor, ++scanned)
+	{
+		log_entry entry;
+		if (!entries_.read(cursor, entry) || entry.level() < filter.level)
+			continue;
+		entry.render(lines[count]);
+		if (filter.matches(lines[count]))
+			++count;
+	}
+	mutex_exit(&lock_);
+	return count;
+}
+
+uint32_t event_log::tail(const log_filter& filter, std::size_t count)
+{
+	mutex_enter_blocking(&lock_);
+	collect();
+	uint32_t oldest = entries_.first();
+	uint32_t cursor = entries_.end();
+	for (std::size_t found = 0, scanned = 0; cursor != oldest && found < count && scanned < tail_scan_limit;
+		--cursor, ++scanned)
+	{
+		log_entry entry;
+		if (!entries_.read(cursor - 1, entry) || entry.level() < filter.level)
+			continue;
+		// Only rendered if there is text to look for
+		if (filter.text.empty())
+		{
+			++found;
+			continue;
+		}
+		log_line line;
+		entry.render(line);
+		if (filter.matches(line))
+			++found;
+	}
+	mutex_exit(&lock_);
+	return cursor;
+}
+
+static persistent_log<flash_log_storage>& open_persisted()
+{
+	if (!persisted_open)
+	{
+		persisted.open();
+		persisted_open = true;
+		persisted_next = sys_log.first();
+	}
+	return persisted;
+}
+
+// Echoes and persists new messages. Returns true if any was an error.
+static bool drain()
+{
+	bool error = false;
+	persistent_log<flash_log_storage>& log = open_persisted();
+	// The oldest first, as reading collects newer messages
+	uint32_t first = sys_log.first();
+	uint32_t end = sys_log.end();
+	// Anything overwritten before it could be echoed is gone
+	if (static_cast<int32_t>(persisted_next - first) < 0)
+		persisted_next = first;
+	for (; persisted_next != end; ++persisted_next)
+	{
+		log_entry entry;
+		if (!sys_log.read(persisted_next, entry))
+			continue;
+		log_line line;
+		entry.render(line);
+		printf("syslog: %s\r\n", line.text.data());
+		if (!log.append(line))
+			sys_log.push<"log: unable to write to flash", log_level::warning>();
+		error = error || line.level >= log_level::error;
+	}
+	return error;
+}
+
+void log_task(void*)
+{
+	mutex_enter_blocking(&persist_lock);
+	persistent_log<flash_log_storage>& log = open_persisted();
+	sys_log.push<"log: boot {}, previous boot {}, {} flash sectors">(
+		log.boot(), log.previous_boot(), flash.sectors());
+	if (!log.enabled())
+		sys_log.push<"log: no flash left after the image, not persisting the log", log_level::warning>();
+	mutex_exit(&persist_lock);
+
+	bool error_pending = false;
+	TickType_t last_flush = xTaskGetTickCount();
+	for (;;)
+	{
+		vTaskDelay(log_echo_period);
+		mutex_enter_blocking(&persist_lock);
+		error_pending = drain() || error_pending;
+		// Errors are often followed by a hang or a reset, so what led up
+		// to them is written out right away
+		TickType_t now = xTaskGetTickCount();
+		TickType_t elapsed = now - last_flush;
+		if ((error_pending && elapsed >= error_flush_period) || elapsed >= idle_flush_period)
+		{
+			if (!log.flush())
+				sys_log.push<"log: unable to write to flash", log_level::warning>();
+			last_flush = now;
+			error_pending = false;
+		}
+		mutex_exit(&persist_lock);
+	}
+}
+
+void persist_log()
+{
+	mutex_enter_blocking(&persist_lock);
+	drain();
+	persisted.flush();
+	mutex_exit(&persist_lock);
+}
+
+std::size_t read_previous_boot_log(std::size_t first, std::span<log_line> lines)
+{
+	mutex_enter_blocking(&persist_lock);
+	persistent_log<flash_log_storage>& log = open_persisted();
+	std::size_t count = log.previous_boot() ? log.read(log.previous_boot(), first, lines) : 0;
+	mutex_exit(&persist_lock);
+	return count;
+}
 
 }
@@ -1,5 +1,5 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2024
+// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2026
 /// @file
 
 #include <pcrb/ntp.h>
@@ -11,6 +11,9 @@
 #include <pcrb/cli_task.h>
 #include <pcrb/wifi_management_task.h>
 #include <pcrb/monitor_task.h>
+#include <pcrb/mqtt_task.h>
+#include <pcrb/syslog_task.h>
+#include <pcrb/log.h>
 // This secrets.h includes strings for WIFI_SSID and WIFI_PASSWORD
 #include "secrets.h"
 
@@ -52,16 +55,20 @@ void print_callback(std::string_view str)
 	printf("syslog: %.*s\r\n", str.size(), str.data());
 }
 
-using gpico::sys_log;
+using pcrb::sys_log;
 
 void init_task(void*)
 {
 	gpico::initialize_watchdog_tasks();
 	gpico::initialize_usb_task();
 
-	sys_log.register_push_callback(print_callback);
+	// gpico keeps its own text log, echo it as it comes. The firmware's log is
+	// echoed by the log task, so nothing is rendered by whoever logs.
+	gpico::sys_log.register_push_callback(print_callback);
+	xTaskCreateAffinitySet(pcrb::log_task, "pcrb_log", 1024, nullptr, tskIDLE_PRIORITY+1, CPUS_MASK, nullptr);
 
-	xTaskCreateAffinitySet(pcrb::cli_task, "pcrb_cli", 512, nullptr, tskIDLE_PRIORITY+1, CPUS_MASK, nullptr);
+	// Rendering the log for status needs the larger stack
+	xTaskCreateAffinitySet(pcrb::cli_task, "pcrb_cli", 1024, nullptr, tskIDLE_PRIORITY+1, CPUS_MASK, nullptr);
 	xTaskCreateAffinitySet(pcrb::wifi_management_task, "pcrb_wifi", 512, nullptr, tskIDLE_PRIORITY+2, CPUS_MASK, nullptr);
 
 	// Wait for wifi to be ready before continuing, this variable is set by the
@@ -70,14 +77,22 @@ void init_task(void*)
 		taskYIELD();
 	}
 
-	sys_log.push(std::format("Connected with IP address {}", ip4addr_ntoa(netif_ip4_addr(netif_default))));
+	sys_log.push<"Connected with IP address {}">(ip4addr_ntoa(netif_ip4_addr(netif_default)));
+	for (int i = 0; i < LWIP_IPV6_NUM_ADDRESSES; ++i)
+	{
+		if (ip6_addr_isvalid(netif_ip6_addr_state(netif_default, i)))
+			sys_log.push<"Connected with IPv6 address {}">(ip6addr_ntoa(netif_ip6_addr(netif_default, i)));
+	}
 
 	// FIXME should we call this somewhere?
 	//cyw43_arch_deinit();
 
 	xTaskCreateAffinitySet(pcrb::switch_task, "pcrb_switch", 512, nullptr, tskIDLE_PRIORITY+2, CPUS_MASK, nullptr);
-	xTaskCreateAffinitySet(pcrb::network_task, "pcrb_network", 512 + 1024/4, nullptr, tskIDLE_PRIORITY+2, CPUS_MASK, nullptr);
-	xTaskCreateAffinitySet(pcrb::monitor_task, "pcrb_monitor", 256, nullptr, tskIDLE_PRIORITY+1, CPUS_MASK, nullptr);
+	// Parsing the TLS key and certificate needs the larger stack
+	xTaskCreateAffinitySet(pcrb::network_task, "pcrb_network", 1024, nullptr, tskIDLE_PRIORITY+2, CPUS_MASK, nullptr);
+	xTaskCreateAffinitySet(pcrb::monitor_task, "pcrb_monitor", 512, nullptr, tskIDLE_PRIORITY+1, CPUS_MASK, nullptr);
+	xTaskCreateAffinitySet(pcrb::mqtt_task, "pcrb_mqtt", 1024, nullptr, tskIDLE_PRIORITY+1, CPUS_MASK, nullptr);
+	xTaskCreateAffinitySet(pcrb::syslog_task, "pcrb_syslog", 1024, nullptr, tskIDLE_PRIORITY+1, CPUS_MASK, nullptr);
 
 	vTaskDelete(nullptr);
 	for(;;);
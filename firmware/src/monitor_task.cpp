@@ -1,11 +1,12 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2025
+// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2026
 /// @file
 
 #include <pcrb/switch_task.h>
 #include <pcrb/switch.h>
-
-#include <gpico/log.h>
+#include <pcrb/protocol.h>
+#include <pcrb/request_handler.h>
+#include <pcrb/mqtt_task.h>
 
 #include <pico/stdlib.h>
 #include <pico/cyw43_arch.h>
@@ -16,32 +17,76 @@
 
 #include <format>
 #include <atomic>
-
-using gpico::sys_log;
+#include <array>
 
 namespace pcrb
 {
 
 static std::atomic_bool pc_state = false;
 
-// FIXME wouldn't it be better to do this with interrupts?
+constexpr const unsigned on_state_gpio = 21;
+
+// Edges seen by the interrupt handler, waiting for the monitor task
+constexpr const size_t max_pending_edges = 16;
+static StaticQueue_t edge_queue_storage;
+static std::array<uint8_t, max_pending_edges * sizeof(state_event)> edge_queue_buffer;
+static QueueHandle_t edge_queue;
+
+// How often to sample the rail anyway, in case an edge was lost.
+constexpr const TickType_t resample_period = pdMS_TO_TICKS(1000);
+
+static void queue_edge(bool state, uint64_t timestamp, BaseType_t *woken)
+{
+	state_event event = { .state = state, .timestamp = timestamp, .dropped = 0 };
+	xQueueSendFromISR(edge_queue, &event, woken);
+}
+
+static void on_edge(unsigned gpio, uint32_t events)
+{
+	if (gpio != on_state_gpio)
+		return;
+
+	// Both edges at once means a blip shorter than the interrupt latency,
+	// report it anyway, ending at the current level
+	uint64_t now = time_us_64();
+	bool state = gpio_get(on_state_gpio);
+	BaseType_t woken = pdFALSE;
+	if ((events & GPIO_IRQ_EDGE_RISE) && (events & GPIO_IRQ_EDGE_FALL))
+		queue_edge(!state, now, &woken);
+	queue_edge(state, now, &woken);
+	portYIELD_FROM_ISR(woken);
+}
+
 void monitor_task(void*)
 {
-	constexpr const unsigned on_state_gpio = 21;
 	gpio_init(on_state_gpio);
 	gpio_pull_down(on_state_gpio);
 	gpio_set_dir(on_state_gpio, GPIO_IN);
 
 	static pcrb::pc_switch<22> switch_(false);
+
+	// Edges are caught by interrupt, so short blips are not missed between
+	// samples
+	edge_queue = xQueueCreateStatic(max_pending_edges, sizeof(state_event),
+		edge_queue_buffer.data(), &edge_queue_storage);
+	pc_state = gpio_get(on_state_gpio);
+	gpio_set_irq_enabled_with_callback(on_state_gpio,
+		GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true, on_edge);
+
 	for (;;)
 	{
-		bool state = gpio_get(on_state_gpio);
-		if (state != pc_state)
+		state_event event;
+		if (xQueueReceive(edge_queue, &event, resample_period) != pdTRUE)
+		{
+			event = { .state = gpio_get(on_state_gpio), .timestamp = time_us_64(), .dropped = 0 };
+		}
+
+		if (event.state != pc_state)
 		{
-			// FIXME MQTT or something push?
+			pc_state = event.state;
+			request_handler::publish(event);
+			mqtt_notify();
 		}
-		pc_state = state;
-		vTaskDelay(1000);
 	}
 }
 
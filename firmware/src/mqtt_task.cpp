@@ -0,0 +1,467 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/mqtt_task.h>
+#include <pcrb/auth.h>
+#include <pcrb/commands.h>
+#include <pcrb/protocol.h>
+#include <pcrb/monitor_task.h>
+#include <pcrb/request_handler.h>
+#include <pcrb/usb.h>
+#include <pcrb/wifi_management_task.h>
+#include <pcrb/log.h>
+// This secrets.h includes strings for WIFI_SSID and WIFI_PASSWORD, and
+// optionally MQTT_BROKER and the rest of the MQTT settings below
+#include "secrets.h"
+
+#include <pico/stdlib.h>
+#include <pico/cyw43_arch.h>
+
+#include <lwip/apps/mqtt.h>
+#include <lwip/apps/mqtt_priv.h>
+#include <lwip/netdb.h>
+#include <lwip/sockets.h>
+
+#include <FreeRTOS.h>
+#include <queue.h>
+#include <task.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <expected>
+#include <format>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifndef MQTT_PORT
+#define MQTT_PORT 1883
+#endif
+
+#ifndef MQTT_CLIENT_ID
+#define MQTT_CLIENT_ID "pcrb"
+#endif
+
+#ifndef MQTT_USER
+#define MQTT_USER nullptr
+#endif
+
+#ifndef MQTT_PASSWORD
+#define MQTT_PASSWORD nullptr
+#endif
+
+#ifndef MQTT_TOPIC_PREFIX
+#define MQTT_TOPIC_PREFIX "pcrb"
+#endif
+
+namespace pcrb
+{
+
+// How often to check for state changes and on the broker connection, if
+// not woken up earlier by mqtt_notify().
+constexpr const TickType_t check_period = pdMS_TO_TICKS(1000);
+
+// Health is sampled every check, and published every this many samples.
+constexpr const uint32_t health_samples = 60;
+
+// Time between attempts to connect to the broker.
+constexpr const TickType_t reconnect_delay = pdMS_TO_TICKS(5000);
+
+// MQTT keep-alive, in seconds.
+constexpr const u16_t keep_alive = 60;
+
+// Everything is published at least once, state topics are small enough
+// that duplicates don't matter.
+constexpr const u8_t publish_qos = 1;
+
+// Retain bit of the fixed header of a PUBLISH packet.
+constexpr const u8_t publish_retain_flag = 0x01;
+
+constexpr const size_t max_queued_commands = 4;
+constexpr const size_t max_argument_size = 16;
+
+// With AUTH_KEY set, a command payload is an authenticated request for the
+// same command: magic, opcode and argument, wrapped as described in auth.h.
+constexpr const size_t max_authenticated_size = auth_overhead + 12;
+constexpr const size_t max_payload_size = std::max(max_argument_size, max_authenticated_size);
+
+constexpr const char status_topic[] = MQTT_TOPIC_PREFIX "/status";
+constexpr const char pc_state_topic[] = MQTT_TOPIC_PREFIX "/state/pc";
+constexpr const char boot_select_topic[] = MQTT_TOPIC_PREFIX "/state/boot_select";
+constexpr const char health_topic[] = MQTT_TOPIC_PREFIX "/health";
+constexpr const char result_topic[] = MQTT_TOPIC_PREFIX "/result";
+constexpr const char command_topics[] = MQTT_TOPIC_PREFIX "/command/+";
+constexpr const std::string_view command_prefix = MQTT_TOPIC_PREFIX "/command/";
+
+static std::atomic<TaskHandle_t> task_handle = nullptr;
+static std::atomic_bool connected = false;
+static std::atomic_bool reconnect_requested = false;
+
+void mqtt_notify()
+{
+	if (TaskHandle_t handle = task_handle.load())
+		xTaskNotifyGive(handle);
+}
+
+void mqtt_reconnect()
+{
+	reconnect_requested = true;
+	mqtt_notify();
+}
+
+#ifdef MQTT_BROKER
+
+// Command received from the broker, waiting to be run by the MQTT task
+struct pending_command
+{
+	const command *command_;
+	uint32_t argument;
+};
+
+static StaticQueue_t command_queue_storage;
+static std::array<uint8_t, max_queued_commands * sizeof(pending_command)> command_queue_buffer;
+static QueueHandle_t command_queue;
+
+// Command being received, only touched from the lwIP thread
+static const command *incoming_command = nullptr;
+static std::array<char, max_payload_size> incoming_argument;
+static size_t incoming_size = 0;
+
+static void on_publish(void *arg, const char *topic, u32_t size)
+{
+	std::string_view name(topic);
+	incoming_command = nullptr;
+	incoming_size = 0;
+	if (!name.starts_with(command_prefix))
+		return;
+
+	name.remove_prefix(command_prefix.size());
+	// A retained command would run again on every reconnect. lwIP does not
+	// pass the flags of a message on, but its fixed header is still at the
+	// start of the receive buffer while this is called.
+	const mqtt_client_t *client = static_cast<const mqtt_client_t*>(arg);
+	if (client->rx_buffer[0] & publish_retain_flag)
+	{
+		sys_log.push<"mqtt: ignoring retained command {}", log_level::warning>(name);
+		return;
+	}
+	const command *command_ = find_command(name);
+	if (!command_)
+	{
+		sys_log.push<"mqtt: unknown command {}", log_level::warning>(name);
+		return;
+	}
+	if (size > (authentication_required() ? max_authenticated_size : max_argument_size))
+	{
+		sys_log.push<"mqtt: argument for {} is too long", log_level::warning>(name);
+		return;
+	}
+	incoming_command = command_;
+}
+
+static void on_data(void*, const u8_t *data, u16_t size, u8_t flags)
+{
+	if (!incoming_command)
+		return;
+
+	size_t amount = std::min<size_t>(size, incoming_argument.size() - incoming_size);
+	memcpy(incoming_argument.data() + incoming_size, data, amount);
+	incoming_size += amount;
+	if (!(flags & MQTT_DATA_FLAG_LAST))
+		return;
+
+	const command *command_ = std::exchange(incoming_command, nullptr);
+	uint32_t argument = 0;
+	if (authentication_required())
+	{
+		// The broker is not trusted to check who may publish commands, so
+		// they need the same tag as network requests
+		auto frame = std::as_bytes(std::span(incoming_argument.data(), incoming_size));
+		auto body = authenticate(frame);
+		std::expected<request, response> decoded = body ? decode_request(*body) : std::unexpected(body.error());
+		if (!decoded)
+		{
+			sys_log.push<"mqtt: rejected {}, status {}, value {}", log_level::warning>(command_->name,
+				std::to_underlying(decoded.error().status), decoded.error().value);
+			return;
+		}
+		if (decoded->code != std::to_underlying(command_->code))
+		{
+			sys_log.push<"mqtt: request for {} sent to {}", log_level::warning>(decoded->code, command_->name);
+			return;
+		}
+		argument = decoded->argument;
+	}
+	else if (command_->argument == argument_type::u32)
+	{
+		const char *end = incoming_argument.data() + incoming_size;
+		auto [last, err] = std::from_chars(incoming_argument.data(), end, argument);
+		if (err != std::errc() || last != end)
+		{
+			sys_log.push<"mqtt: bad argument for {}", log_level::warning>(command_->name);
+			return;
+		}
+	}
+
+	// Commands may block, so they are run from the MQTT task and not here
+	pending_command pending = { .command_ = command_, .argument = argument };
+	if (xQueueSendToBack(command_queue, &pending, 0) != pdTRUE)
+	{
+		sys_log.push<"mqtt: too many commands queued, dropping {}", log_level::warning>(command_->name);
+		return;
+	}
+	mqtt_notify();
+}
+
+static void on_connection(mqtt_client_t*, void*, mqtt_connection_status_t status)
+{
+	connected = (status == MQTT_CONNECT_ACCEPTED);
+	if (!connected)
+	{
+		sys_log.push<"mqtt: disconnected, status {}", log_level::warning>(static_cast<int>(status));
+	}
+	mqtt_notify();
+}
+
+struct addrinfo_deleter
+{
+	void operator()(addrinfo *info) const
+	{
+		freeaddrinfo(info);
+	}
+};
+
+static void connect(mqtt_client_t *client)
+{
+	addrinfo hints = {};
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo *result = nullptr;
+	int err = getaddrinfo(MQTT_BROKER, nullptr, &hints, &result);
+	std::unique_ptr<addrinfo, addrinfo_deleter> info(result);
+	if (err != 0 || !info)
+	{
+		sys_log.push<"mqtt: unable to resolve {}, error {}", log_level::warning>(MQTT_BROKER, err);
+		return;
+	}
+
+	ip_addr_t broker;
+	if (info->ai_family == AF_INET6)
+	{
+		const sockaddr_in6 *address = reinterpret_cast<sockaddr_in6*>(info->ai_addr);
+		inet6_addr_to_ip6addr(ip_2_ip6(&broker), &address->sin6_addr);
+		IP_SET_TYPE_VAL(broker, IPADDR_TYPE_V6);
+		ip6_addr_assign_zone(ip_2_ip6(&broker), IP6_UNKNOWN, netif_default);
+	}
+	else
+	{
+		ip_addr_set_ip4_u32(&broker, reinterpret_cast<sockaddr_in*>(info->ai_addr)->sin_addr.s_addr);
+	}
+
+	mqtt_connect_client_info_t client_info = {};
+	client_info.client_id = MQTT_CLIENT_ID;
+	client_info.client_user = MQTT_USER;
+	client_info.client_pass = MQTT_PASSWORD;
+	client_info.keep_alive = keep_alive;
+	client_info.will_topic = status_topic;
+	client_info.will_msg = "offline";
+	client_info.will_qos = publish_qos;
+	client_info.will_retain = 1;
+
+	cyw43_arch_lwip_begin();
+	err_t connect_err = mqtt_client_connect(client, &broker, MQTT_PORT, on_connection, nullptr, &client_info);
+	cyw43_arch_lwip_end();
+	// Still trying from a previous attempt otherwise
+	if (connect_err != ERR_OK && connect_err != ERR_ISCONN)
+	{
+		sys_log.push<"mqtt: unable to connect to {}, error {}", log_level::warning>(MQTT_BROKER, connect_err);
+	}
+}
+
+static void publish(mqtt_client_t *client, const char *topic, std::string_view payload, bool retain)
+{
+	// The payload is copied to the client's output buffer
+	cyw43_arch_lwip_begin();
+	err_t err = mqtt_publish(client, topic, payload.data(), payload.size(), publish_qos, retain, nullptr, nullptr);
+	cyw43_arch_lwip_end();
+	if (err != ERR_OK)
+	{
+		sys_log.push<"mqtt: unable to publish to {}, error {}", log_level::warning>(topic, err);
+	}
+}
+
+// Health sampled over a period, published as a single message
+class health_telemetry
+{
+public:
+	void sample()
+	{
+		int32_t rssi = 0;
+		cyw43_wifi_get_rssi(&cyw43_state, &rssi);
+		rssi_min_ = samples_ ? std::min(rssi_min_, rssi) : rssi;
+		rssi_max_ = samples_ ? std::max(rssi_max_, rssi) : rssi;
+		rssi_sum_ += rssi;
+		++samples_;
+	}
+
+	bool due() const
+	{
+		return samples_ >= health_samples;
+	}
+
+	std::string message() const
+	{
+		using deadline = request_handler::deadline;
+		return std::format(
+			"{{\"uptime_ms\":{},\"heap_free\":{},\"heap_min\":{},"
+			"\"rssi_min\":{},\"rssi_max\":{},\"rssi_avg\":{},"
+			"\"evictions\":[{},{},{},{}]}}",
+			time_us_64() / 1000, xPortGetFreeHeapSize(), xPortGetMinimumEverFreeHeapSize(),
+			rssi_min_, rssi_max_, samples_ ? rssi_sum_ / static_cast<int32_t>(samples_) : 0,
+			request_handler::evictions(deadline::setup),
+			request_handler::evictions(deadline::header),
+			request_handler::evictions(deadline::body),
+			request_handler::evictions(deadline::idle));
+	}
+
+	void reset()
+	{
+		*this = {};
+	}
+
+private:
+	uint32_t samples_ = 0;
+	int32_t rssi_min_ = 0;
+	int32_t rssi_max_ = 0;
+	int32_t rssi_sum_ = 0;
+};
+
+void mqtt_task(void*)
+{
+	command_queue = xQueueCreateStatic(max_queued_commands, sizeof(pending_command),
+		command_queue_buffer.data(), &command_queue_storage);
+
+	cyw43_arch_lwip_begin();
+	mqtt_client_t *client = mqtt_client_new();
+	if (client)
+		mqtt_set_inpub_callback(client, on_publish, on_data, client);
+	cyw43_arch_lwip_end();
+	if (!client)
+	{
+		sys_log.push<"mqtt: unable to allocate client", log_level::warning>();
+		vTaskDelete(nullptr);
+		for(;;);
+	}
+	task_handle = xTaskGetCurrentTaskHandle();
+
+	// Session started on the current connection
+	bool online = false;
+	std::optional<bool> published_pc_state;
+	std::optional<uint32_t> published_boot_select;
+	TickType_t last_attempt = xTaskGetTickCount() - reconnect_delay;
+	TickType_t last_sample = xTaskGetTickCount();
+	health_telemetry health;
+
+	for (;;)
+	{
+		ulTaskNotifyTake(pdTRUE, check_period);
+
+		if (reconnect_requested.exchange(false) && connected)
+		{
+			// The link came back, the old connection is likely dead
+			sys_log.push<"mqtt: link restored, reconnecting">();
+			cyw43_arch_lwip_begin();
+			mqtt_disconnect(client);
+			cyw43_arch_lwip_end();
+			// Disconnecting does not call on_connection()
+			connected = false;
+			last_attempt = xTaskGetTickCount() - reconnect_delay;
+		}
+
+		if (!connected)
+		{
+			online = false;
+			TickType_t now = xTaskGetTickCount();
+			if (network_ready() && (now - last_attempt) >= reconnect_delay)
+			{
+				last_attempt = now;
+				connect(client);
+			}
+		}
+		else if (!online)
+		{
+			sys_log.push<"mqtt: connected to {}">(MQTT_BROKER);
+			cyw43_arch_lwip_begin();
+			mqtt_subscribe(client, command_topics, publish_qos, nullptr, nullptr);
+			cyw43_arch_lwip_end();
+			publish(client, status_topic, "online", true);
+			// Publish everything again, in case the broker lost it
+			published_pc_state.reset();
+			published_boot_select.reset();
+			online = true;
+		}
+
+		if (online)
+		{
+			pending_command pending;
+			while (xQueueReceive(command_queue, &pending, 0) == pdTRUE)
+			{
+				response result = execute(*pending.command_, pending.argument);
+				sys_log.push<"mqtt: {} {}: status {}, value {}">(pending.command_->name,
+					pending.argument, std::to_underlying(result.status), result.value);
+				// Subscribers get the same text as other front ends
+				std::array<char, max_description_size> buffer;
+				publish(client, result_topic, describe(*pending.command_, pending.argument, result, buffer), false);
+			}
+
+			bool pc_state = current_pc_state();
+			if (published_pc_state != pc_state)
+			{
+				publish(client, pc_state_topic, pc_state ? "on" : "off", true);
+				published_pc_state = pc_state;
+			}
+
+			uint32_t boot_select = get_boot_select();
+			if (published_boot_select != boot_select)
+			{
+				publish(client, boot_select_topic, std::format("{}", boot_select), true);
+				published_boot_select = boot_select;
+			}
+		}
+
+		// Woken up early by notifications, so keep sampling periodic
+		TickType_t now = xTaskGetTickCount();
+		if ((now - last_sample) >= check_period)
+		{
+			last_sample = now;
+			health.sample();
+			if (health.due())
+			{
+				if (online)
+					publish(client, health_topic, health.message(), false);
+				health.reset();
+			}
+		}
+	}
+}
+
+#else
+
+void mqtt_task(void*)
+{
+	sys_log.push<"mqtt: no broker configured", log_level::warning>();
+	vTaskDelete(nullptr);
+	for(;;);
+}
+
+#endif
+
+}
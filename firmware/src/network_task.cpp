@@ -1,177 +1,274 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2024
+// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2026
 /// @file
 
 #include <pcrb/network_task.h>
-#include <pcrb/monitor_task.h>
-#include <pcrb/switch_task.h>
 #include <pcrb/server.h>
 #include <pcrb/request_handler.h>
-#include <pcrb/usb.h>
+#include <pcrb/protocol.h>
+#include <pcrb/auth.h>
+#include <pcrb/commands.h>
+#include <pcrb/format_fixed.h>
+#include <pcrb/udp_server.h>
+#include <pcrb/http_server.h>
+#include <pcrb/tls.h>
+#include <pcrb/wol_server.h>
+#include <pcrb/monitor_task.h>
+#include <pcrb/log.h>
 
-#include <lwip/sockets.h>
+#include <lwip/tcpip.h>
 
-#include <gpico/log.h>
+#include <FreeRTOS.h>
+#include <task.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
-#include <cstdio>
-#include <format>
 #include <cstring>
-
-using gpico::sys_log;
+#include <array>
+#include <utility>
 
 namespace pcrb
 {
 
+// Port for both the TCP server and the UDP fast path
+constexpr const uint16_t server_port = 48686;
+
+// Port for the TLS request server
+constexpr const uint16_t tls_port = 48687;
+
+// Port for the HTTP control server
+constexpr const uint16_t http_port = 80;
+
+// Port Wake-on-LAN magic packets are usually sent to
+constexpr const uint16_t wol_port = 9;
+
+// How long to wait before trying to listen again after failing to
+constexpr const TickType_t listen_retry_delay = pdMS_TO_TICKS(1000);
+
+static_assert(request_handler::max_request_size >= auth_overhead + 8 + batch_step_size * max_batch_steps,
+	"request handler must fit a full batch request");
+static_assert(request_handler::max_reply_size >= response::max_size * (max_batch_steps + 1),
+	"request handler must fit a full batch reply");
+static_assert(request_handler::max_reply_size >= log_page::max_size,
+	"request handler must fit a full log page");
+static_assert(request_handler::max_reply_size >= log_page::max_text_size,
+	"request handler must fit the text of a full log page");
+static_assert(request_handler::max_reply_size >= max_description_size,
+	"request handler must fit the text of any reply");
+
+// Only ever used from the lwIP thread, and too large for its stack
+static std::array<log_line, log_page::max_lines> log_lines;
+
+// Batch handed over from the lwIP thread to network_task, which runs it, as
+// its presses may take seconds. Only one runs at a time: the lwIP thread
+// fills it in while batch_running is clear, and clears it again once the
+// reply is sent.
+struct batch_job
+{
+	/// Connection to reply to, see request_handler::defer()
+	uint32_t connection;
+	std::array<std::byte, request_handler::max_request_size> body;
+	std::size_t size;
+	batch_reply result;
+};
+static batch_job job;
+static bool batch_running = false;
+static std::atomic<TaskHandle_t> batch_worker = nullptr;
+static std::atomic_bool batch_ready = false;
+
+// Called from the lwIP thread once network_task is done with a batch
+static void finish_batch(void*)
+{
+	sys_log.push<"batch of {} steps, ran {}, status {}">(job.result.steps,
+		job.result.batch.value, std::to_underlying(job.result.batch.status));
+	// The connection may have gone away while the batch ran
+	if (request_handler *handler = request_handler::find(job.connection))
+	{
+		handler->respond(job.result.binary(),
+			[](std::span<char> text) { return describe(job.result, text); });
+		handler->resume();
+	}
+	batch_running = false;
+}
+
+static void send_log_page(request_handler& handler, const log_page& page)
+{
+	static std::array<std::byte, log_page::max_size> buffer;
+	handler.respond(page.encode(buffer),
+		[&page](std::span<char> text) { return describe(page, text); });
+}
+
+// Called from the lwIP thread for every request received over TCP
+static void handle_request(request_handler& handler, std::span<const std::byte> data)
+{
+	auto body = authenticate(data);
+	if (!body)
+	{
+		handler.respond(body.error());
+		return;
+	}
+
+	auto decoded = decode_request(*body);
+	if (!decoded)
+	{
+		handler.respond(decoded.error());
+		return;
+	}
+
+	// Session options only make sense for network connections, so they are
+	// not part of the shared command table
+	if (decoded->code == std::to_underlying(opcode::session_options))
+	{
+		if (decoded->size != 12)
+		{
+			handler.respond(response(response_status::bad_size, decoded->code, static_cast<uint32_t>(decoded->size)));
+			return;
+		}
+		// The reply already uses the new options
+		handler.set_options(decoded->argument);
+		uint32_t options = handler.options();
+		handler.respond(response(response_status::ok, decoded->code, options),
+			[options](std::span<char> text) { return format_fixed(text, "session options: {:#x}", options); });
+		return;
+	}
+
+	// Subscribing needs a connection to stream events over, so it is not
+	// part of the shared command table either
+	if (decoded->code == std::to_underlying(opcode::subscribe))
+	{
+		handler.subscribe();
+		bool state = current_pc_state();
+		handler.respond(response(response_status::ok, decoded->code, state),
+			[state](std::span<char> text) { return format_fixed(text, "subscribed, PC 3.3V rail status: {}", state); });
+		return;
+	}
+
+	// Batches wait for their presses, so they are run by network_task and
+	// replied to once done, see finish_batch()
+	if (decoded->code == std::to_underlying(opcode::batch))
+	{
+		TaskHandle_t worker = batch_worker.load();
+		if (batch_running || !worker)
+		{
+			handler.respond(response(response_status::busy, decoded->code));
+			return;
+		}
+		batch_running = true;
+		job.connection = handler.defer();
+		job.size = body->size();
+		std::ranges::copy(*body, job.body.begin());
+		batch_ready = true;
+		xTaskNotifyGive(worker);
+		return;
+	}
+
+	// Log pages are too long to log as they are, so only how much went out
+	// is, and the page is sent as is
+	if (decoded->code == std::to_underlying(opcode::previous_log))
+	{
+		std::size_t count = read_previous_boot_log(decoded->argument, log_lines);
+		log_page page = {
+			.command = decoded->code,
+			.next = decoded->argument + static_cast<uint32_t>(count),
+			.lines = std::span(log_lines).first(count),
+		};
+		sys_log.push<"sent {} messages of the previous boot from {}">(count, decoded->argument);
+		send_log_page(handler, page);
+		return;
+	}
+
+	if (decoded->code == std::to_underlying(opcode::log_query))
+	{
+		auto query = decode_log_query(*decoded);
+		if (!query)
+		{
+			handler.respond(query.error());
+			return;
+		}
+		uint32_t cursor = query->tail ? sys_log.tail(query->filter, query->tail) : query->since;
+		std::size_t count = sys_log.query(query->filter, cursor, log_lines);
+		log_page page = {
+			.command = decoded->code,
+			.next = cursor,
+			.lines = std::span(log_lines).first(count),
+		};
+		// Debug, so clients following the log can leave their own queries
+		// out
+		sys_log.push<"sent {} log messages, next {}", log_level::debug>(count, cursor);
+		send_log_page(handler, page);
+		return;
+	}
+
+	reply result = run_request(*decoded);
+	handler.respond(result.binary,
+		[&result](std::span<char> text) { return describe(result, text); });
+}
+
 void network_task(void*)
 {
-	// Loop endlessly, restarting the server if there are errors
-	server server_;
+	// Datagram requests are served from the lwIP thread, independently of
+	// this task
+	static udp_server udp_server_;
+	int udp_err = udp_server_.listen(server_port);
+	if (udp_err != 0)
+	{
+		sys_log.push<"unable to listen on udp server, error {}", log_level::error>(strerror(udp_err));
+	}
+
+	// As is HTTP
+	static http_server http_server_;
+	int http_err = http_server_.listen(http_port);
+	if (http_err != 0)
+	{
+		sys_log.push<"unable to listen on http server, error {}", log_level::error>(strerror(http_err));
+	}
+
+	// And Wake-on-LAN
+	static wol_server wol_server_;
+	int wol_err = wol_server_.listen(wol_port);
+	if (wol_err != 0)
+	{
+		sys_log.push<"unable to listen for wake-on-lan, error {}", log_level::error>(strerror(wol_err));
+	}
 
-	for(;;)
+	// The same requests over TLS, if a certificate is configured
+	if (altcp_tls_config *tls = tls_server_config())
 	{
-		// FIXME maybe move wifi initialization here?
-		int err;
-		do
+		static server tls_server_;
+		int tls_err = tls_server_.listen(tls_port, handle_request, tls);
+		if (tls_err != 0)
 		{
-			err = server_.listen(48686);
-			if (err != 0)
-			{
-				sys_log.push(std::format("unable to listen on server, error {}", strerror(err)));
-			}
-		} while (err != 0);
-
-		for(;;)
+			sys_log.push<"unable to listen on tls server, error {}", log_level::error>(strerror(tls_err));
+		}
+	}
+
+	// Connections are also served entirely from the lwIP thread, except for
+	// batches, which this task runs once listening
+	batch_worker = xTaskGetCurrentTaskHandle();
+	static server server_;
+	int err;
+	do
+	{
+		err = server_.listen(server_port, handle_request);
+		if (err != 0)
 		{
-			auto accept_result = server_.accept();
-			if (!accept_result)
-			{
-				sys_log.push(std::format("unable to accept socket, error {}", strerror(accept_result.error())));
-				// FIXME what if the error is terminal? Are there any terminal errors?
-				continue;
-			}
-			sys_log.push("new connection accepted");
-			std::array<std::byte, 1024> data;
-			request_handler handler(std::move(*accept_result));
-			auto request_result = handler.read(std::span(data));
-			if (request_result)
-			{
-				// First 4 bytes are a magic field, followed by a 4 byte
-				// request. Additional bytes may be required by the request
-				// type.
-				size_t amount = request_result.value();
-				if (amount < 8)
-				{
-					auto explanation = std::format("Received bad network request with size {}", amount);
-					sys_log.push(explanation);
-					handler.send(explanation);
-					continue;
-				}
-				uint32_t magic;
-				memcpy(&magic, data.data(), 4);
-				magic = ntoh(magic);
-				if (magic != 0x416E614D)
-				{
-					auto explanation = std::format("Received bad network request, bad magic {}", magic);
-					sys_log.push(explanation);
-					handler.send(explanation);
-					continue;
-				}
-
-				uint32_t request;
-				memcpy(&request, data.data() + 4, 4);
-				request = ntoh(request);
-				switch (request)
-				{
-					case 0: // toggle, an additional 4 byte field
-					{
-						if (amount != 12)
-						{
-							auto explanation = std::format("Received bad network request, bad size {}", amount);
-							sys_log.push(explanation);
-							handler.send(explanation);
-							continue;
-						}
-						uint32_t time;
-						memcpy(&time, data.data() + 8, 4);
-						time = ntoh(time);
-						auto explanation = std::format("Received network toggle request {}", time);
-						sys_log.push(explanation);
-						handler.send(explanation);
-						xQueueSendToBack(switch_comms.get(), &time, 0);
-						break;
-					}
-					case 1:
-					{
-						if (amount != 8)
-						{
-							auto explanation = std::format("Received bad network request, bad size {}", amount);
-							sys_log.push(explanation);
-							handler.send(explanation);
-							continue;
-
-						}
-						auto explanation = std::format("boot select: {}", pcrb::get_boot_select());
-						sys_log.push(explanation);
-						handler.send(explanation);
-						break;
-					}
-					case 2:
-					{
-						if (amount != 12)
-						{
-							auto explanation = std::format("Received bad network request, bad size {}", amount);
-							sys_log.push(explanation);
-							handler.send(explanation);
-							continue;
-						}
-						uint32_t select;
-						memcpy(&select, data.data() + 8, 4);
-						select = ntoh(select);
-						auto explanation = std::format("Received boot select request {}, ", select);
-						sys_log.push(explanation);
-						handler.send(explanation);
-						pcrb::set_boot_select(select);
-						explanation = std::format("boot select: {}", pcrb::get_boot_select());
-						sys_log.push(explanation);
-						handler.send(explanation);
-						break;
-					}
-					case 3:
-					{
-						if (amount != 8)
-						{
-							auto explanation = std::format("Received bad network request, bad size {}", amount);
-							sys_log.push(explanation);
-							handler.send(explanation);
-							continue;
-
-						}
-						auto explanation = std::format("PC 3.3V rail status: {}", pcrb::current_pc_state());
-						sys_log.push(explanation);
-						handler.send(explanation);
-						break;
-
-					}
-					default:
-					{
-						auto explanation = std::format("Received bad network request, unknown command {}", request);
-						sys_log.push(explanation);
-						handler.send(explanation);
-						continue;
-					}
-				}
-			}
-			else
-			{
-				const char *err = request_result.error() == EAGAIN ? "timeout": strerror(request_result.error());
-				auto explanation = std::format("failed to handle request: {}", err);
-				sys_log.push(explanation);
-				handler.send(explanation);
-			}
+			sys_log.push<"unable to listen on server, error {}", log_level::error>(strerror(err));
+			vTaskDelay(listen_retry_delay);
 		}
+	} while (err != 0);
+
+	for (;;)
+	{
+		// Presses being waited on also notify this task
+		while (!batch_ready.exchange(false))
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
-		server_.close();
+		// Already decoded once on the lwIP thread
+		auto decoded = decode_request(std::span(job.body).first(job.size));
+		run_batch(*decoded, job.result);
+		while (tcpip_callback(finish_batch, nullptr) != ERR_OK)
+			vTaskDelay(1);
 	}
 }
 
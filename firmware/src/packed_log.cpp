@@ -0,0 +1,496 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/packed_log.h>
+#include <pcrb/log.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+
+namespace pcrb
+{
+
+static_assert((packed_log::block_size & (packed_log::block_size - 1)) == 0,
+	"blocks must divide the sequence numbers evenly");
+
+static_assert(packed_log::max_args >= event_log::max_args,
+	"messages pushed must keep all their arguments");
+
+static_assert(packed_log::max_kinds <= 255, "kinds are indexed by a byte");
+
+namespace
+{
+
+// Longest varint of a 64 bit value
+constexpr const std::size_t max_varint_size = 10;
+
+// A record starts with a byte holding how its time is stored in the top 2
+// bits and the index of its kind in the rest. Kinds past the last index
+// that fits there have their index, less that one, in the byte after.
+constexpr const unsigned time_shift = 6;
+constexpr const std::size_t kind_escape = (1 << time_shift) - 1;
+
+static_assert(kind_escape + 255 >= packed_log::max_kinds, "kinds must fit in the header");
+
+// How the time of a record is stored, unless it starts a block, which has
+// its time in full as a varint
+enum time_code : uint8_t
+{
+	// The same time as the record before
+	same_time,
+	// Microseconds since the record before, in 2 bytes
+	short_delta,
+	// Microseconds since the record before, in 3 bytes
+	medium_delta,
+	// Microseconds since the record before as a zigzag varint, as entries
+	// from different cores can be a little out of order
+	long_delta,
+};
+
+// Header, time and each argument gaining at most a byte over its raw form,
+// in which a u64 takes 9
+static_assert(2 + max_varint_size + log_entry::args_capacity * 10 / 9 + 1 <= packed_log::max_record_size,
+	"packed entries must fit in a record");
+
+constexpr const log_format overflow_format = {
+	"log: too many kinds of message, one was not kept", log_level::error
+};
+
+std::size_t put_varint(std::byte *out, uint64_t value)
+{
+	std::size_t size = 0;
+	while (value >= 0x80)
+	{
+		out[size++] = static_cast<std::byte>(value | 0x80);
+		value >>= 7;
+	}
+	out[size++] = static_cast<std::byte>(value);
+	return size;
+}
+
+uint64_t zigzag(int64_t value)
+{
+	return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value)
+{
+	return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+template<class T>
+T load(const std::byte *data)
+{
+	T value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+// Size of a raw argument, including its tag, 0 if it is cut short
+std::size_t raw_size(std::span<const std::byte> args)
+{
+	std::size_t size = 0;
+	switch (static_cast<log_arg>(args[0]))
+	{
+		case log_arg::u32:
+		case log_arg::i32:
+			size = 1 + sizeof(uint32_t);
+			break;
+		case log_arg::u64:
+		case log_arg::i64:
+			size = 1 + sizeof(uint64_t);
+			break;
+		case log_arg::boolean:
+			size = 1 + sizeof(bool);
+			break;
+		case log_arg::string:
+			size = args.size() < 2 ? 0 : 2 + static_cast<uint8_t>(args[1]);
+			break;
+		default:
+			break;
+	}
+	return size <= args.size() ? size : 0;
+}
+
+// Types of the arguments of an entry, up to max_args of them
+uint32_t signature_of(std::span<const std::byte> args)
+{
+	uint32_t count = 0;
+	uint32_t types = 0;
+	for (std::size_t offset = 0; offset < args.size() && count < packed_log::max_args; ++count)
+	{
+		std::size_t size = raw_size(args.subspan(offset));
+		if (!size)
+			break;
+		types |= std::to_integer<uint32_t>(args[offset]) << (3 * count);
+		offset += size;
+	}
+	return count | types << 4;
+}
+
+// Packs the values of the arguments of a signature, returns the packed size
+std::size_t pack_args(std::span<const std::byte> args, uint32_t signature, std::byte *out)
+{
+	std::size_t size = 0;
+	std::size_t offset = 0;
+	for (uint32_t i = 0; i < (signature & 0xF); ++i)
+	{
+		const std::byte *data = args.data() + offset + 1;
+		switch (static_cast<log_arg>(args[offset]))
+		{
+			case log_arg::u32:
+				size += put_varint(out + size, load<uint32_t>(data));
+				break;
+			case log_arg::i32:
+				size += put_varint(out + size, zigzag(load<int32_t>(data)));
+				break;
+			case log_arg::u64:
+				size += put_varint(out + size, load<uint64_t>(data));
+				break;
+			case log_arg::i64:
+				size += put_varint(out + size, zigzag(load<int64_t>(data)));
+				break;
+			case log_arg::boolean:
+				out[size++] = *data;
+				break;
+			case log_arg::string:
+			{
+				std::size_t length = static_cast<uint8_t>(*data);
+				memcpy(out + size, data, 1 + length);
+				size += 1 + length;
+				break;
+			}
+		}
+		offset += raw_size(args.subspan(offset));
+	}
+	return size;
+}
+
+// Reads a record out of the ring, a byte at a time, wrapping around its end
+class ring_reader
+{
+public:
+	ring_reader(std::span<const std::byte> data, uint32_t position)
+	:data_(data), position_(position % data.size())
+	{}
+
+	std::byte next()
+	{
+		std::byte value = data_[position_];
+		if (++position_ == data_.size())
+			position_ = 0;
+		return value;
+	}
+
+	uint64_t varint()
+	{
+		uint64_t value = 0;
+		for (std::size_t i = 0; i < max_varint_size; ++i)
+		{
+			uint8_t byte = std::to_integer<uint8_t>(next());
+			value |= static_cast<uint64_t>(byte & 0x7F) << (7 * i);
+			if (!(byte & 0x80))
+				break;
+		}
+		return value;
+	}
+
+	uint64_t fixed(std::size_t size)
+	{
+		uint64_t value = 0;
+		for (std::size_t i = 0; i < size; ++i)
+			value |= std::to_integer<uint64_t>(next()) << (8 * i);
+		return value;
+	}
+
+	void skip(std::size_t size)
+	{
+		position_ = (position_ + size) % data_.size();
+	}
+
+	uint32_t position() const
+	{
+		return position_;
+	}
+
+private:
+	std::span<const std::byte> data_;
+	uint32_t position_;
+};
+
+// Reads the header and time of a record, returns the index of its kind
+std::size_t read_header(ring_reader& reader, bool starts_block, uint64_t& timestamp_us)
+{
+	uint8_t header = std::to_integer<uint8_t>(reader.next());
+	std::size_t index = header & kind_escape;
+	if (index == kind_escape)
+		index += std::to_integer<uint8_t>(reader.next());
+
+	if (starts_block)
+	{
+		timestamp_us = reader.varint();
+		return index;
+	}
+	switch (header >> time_shift)
+	{
+		case same_time:
+			break;
+		case short_delta:
+			timestamp_us += reader.fixed(2);
+			break;
+		case medium_delta:
+			timestamp_us += reader.fixed(3);
+			break;
+		default:
+			timestamp_us += unzigzag(reader.varint());
+			break;
+	}
+	return index;
+}
+
+// Unpacks the values of the arguments of a signature, or only skips them
+// if there is no entry to unpack them to
+void unpack_args(ring_reader& reader, uint32_t signature, log_entry *entry)
+{
+	for (uint32_t i = 0; i < (signature & 0xF); ++i)
+	{
+		switch (static_cast<log_arg>((signature >> (4 + 3 * i)) & 0x7))
+		{
+			case log_arg::u32:
+			{
+				uint64_t value = reader.varint();
+				if (entry)
+					entry->add(static_cast<uint32_t>(value));
+				break;
+			}
+			case log_arg::i32:
+			{
+				uint64_t value = reader.varint();
+				if (entry)
+					entry->add(static_cast<int32_t>(unzigzag(value)));
+				break;
+			}
+			case log_arg::u64:
+			{
+				uint64_t value = reader.varint();
+				if (entry)
+					entry->add(value);
+				break;
+			}
+			case log_arg::i64:
+			{
+				uint64_t value = reader.varint();
+				if (entry)
+					entry->add(unzigzag(value));
+				break;
+			}
+			case log_arg::boolean:
+			{
+				std::byte value = reader.next();
+				if (entry)
+					entry->add(value != std::byte(0));
+				break;
+			}
+			case log_arg::string:
+			{
+				std::size_t length = std::to_integer<uint8_t>(reader.next());
+				if (!entry)
+				{
+					reader.skip(length);
+					break;
+				}
+				std::array<char, 255> text;
+				for (std::size_t j = 0; j < length; ++j)
+					text[j] = std::to_integer<char>(reader.next());
+				entry->add(std::string_view(text.data(), length));
+				break;
+			}
+		}
+	}
+}
+
+}
+
+packed_log::packed_log(std::span<std::byte> data, std::span<checkpoint> checkpoints)
+:data_(data), checkpoints_(checkpoints), head_(0), tail_(0), used_(0), first_(0), next_(0),
+	last_timestamp_us_(0), kinds_{}, kind_count_(0), kind_slots_{}, read_next_{0, 0, 0}
+{
+	// Taken first, so it is always there for entries of kinds that don't
+	// fit
+	find_kind(&overflow_format, 0);
+}
+
+void packed_log::append(const log_entry& entry)
+{
+	std::span<const std::byte> args = std::span(entry.args).first(entry.args_size);
+	uint32_t signature = signature_of(args);
+	std::size_t index = find_kind(entry.format, signature);
+	if (!index)
+		signature = 0;
+
+	std::array<std::byte, max_record_size> record;
+	std::size_t size = 1;
+	if (index >= kind_escape)
+		record[size++] = static_cast<std::byte>(index - kind_escape);
+
+	bool starts_block = (next_ % block_size) == 0;
+	int64_t delta = static_cast<int64_t>(entry.timestamp_us - last_timestamp_us_);
+	uint8_t code = long_delta;
+	if (starts_block)
+		size += put_varint(record.data() + size, entry.timestamp_us);
+	else if (delta == 0)
+		code = same_time;
+	else if (delta > 0 && delta < (1 << 16))
+		code = short_delta;
+	else if (delta > 0 && delta < (1 << 24))
+		code = medium_delta;
+	else
+		size += put_varint(record.data() + size, zigzag(delta));
+	for (std::size_t i = 0; code == short_delta || code == medium_delta; ++i)
+	{
+		record[size++] = static_cast<std::byte>(delta >> (8 * i));
+		if (i + 1 == static_cast<std::size_t>(code + 1))
+			break;
+	}
+	record[0] = static_cast<std::byte>(code << time_shift | std::min(index, kind_escape));
+	size += pack_args(args, signature, record.data() + size);
+
+	// Whole blocks are dropped to make room, but never the one being filled
+	uint32_t block_start = next_ & ~static_cast<uint32_t>(block_size - 1);
+	while (static_cast<int32_t>(block_start - first_) > 0 &&
+		(used_ + size > data_.size() || (starts_block && blocks() == checkpoints_.size())))
+	{
+		drop_block();
+	}
+
+	if (starts_block)
+		checkpoints_[(next_ / block_size) & (checkpoints_.size() - 1)] = { head_ };
+	put(head_, std::span(record).first(size));
+	head_ = (head_ + size) % data_.size();
+	used_ += size;
+	last_timestamp_us_ = entry.timestamp_us;
+	++next_;
+}
+
+bool packed_log::read(uint32_t sequence, log_entry& entry)
+{
+	// Unsigned math, so sequence numbers that wrapped still work
+	if (sequence - first_ >= next_ - first_)
+		return false;
+
+	cursor at = read_next_;
+	if (at.sequence != sequence)
+	{
+		const checkpoint& start = checkpoints_[(sequence / block_size) & (checkpoints_.size() - 1)];
+		at = { sequence & ~static_cast<uint32_t>(block_size - 1), start.position, 0 };
+	}
+	for (; at.sequence != sequence; ++at.sequence)
+		at.position = skip(at.sequence, at.position, at.timestamp_us);
+
+	ring_reader reader(data_, at.position);
+	entry.timestamp_us = at.timestamp_us;
+	std::size_t index = read_header(reader, (sequence % block_size) == 0, entry.timestamp_us);
+	// Corrupt, which can't happen short of a bug
+	if (index >= kind_count_)
+		return false;
+	entry.format = kinds_[index].format;
+	entry.sequence = sequence;
+	entry.args_size = 0;
+	unpack_args(reader, kinds_[index].signature, &entry);
+
+	read_next_ = { sequence + 1, reader.position(), entry.timestamp_us };
+	return true;
+}
+
+uint32_t packed_log::first() const
+{
+	return first_;
+}
+
+uint32_t packed_log::end() const
+{
+	return next_;
+}
+
+std::size_t packed_log::used() const
+{
+	return used_ + blocks() * sizeof(checkpoint);
+}
+
+std::size_t packed_log::capacity() const
+{
+	return data_.size() + checkpoints_.size_bytes() + sizeof(kinds_) + sizeof(kind_slots_);
+}
+
+std::size_t packed_log::kinds() const
+{
+	return kind_count_;
+}
+
+std::size_t packed_log::blocks() const
+{
+	return (next_ - first_ + block_size - 1) / block_size;
+}
+
+void packed_log::drop_block()
+{
+	uint32_t next_block = first_ + block_size;
+	if (static_cast<int32_t>(next_ - next_block) <= 0)
+	{
+		// Only that block was held
+		tail_ = head_;
+		used_ = 0;
+	}
+	else
+	{
+		uint32_t position = checkpoints_[(next_block / block_size) & (checkpoints_.size() - 1)].position;
+		used_ -= (position + data_.size() - tail_) % data_.size();
+		tail_ = position;
+	}
+	first_ = next_block;
+}
+
+std::size_t packed_log::find_kind(const log_format *format, uint32_t signature)
+{
+	uint32_t hash = (static_cast<uint32_t>(reinterpret_cast<uintptr_t>(format)) ^ signature * 0x85EBCA6B) * 0x9E3779B1;
+	for (std::size_t probe = 0; probe < kind_slots_.size(); ++probe)
+	{
+		uint8_t& slot = kind_slots_[(hash + probe) % kind_slots_.size()];
+		if (!slot)
+		{
+			if (kind_count_ == kinds_.size())
+				return 0;
+			kinds_[kind_count_] = { format, signature };
+			slot = ++kind_count_;
+			return kind_count_ - 1;
+		}
+		const kind& found = kinds_[slot - 1];
+		if (found.format == format && found.signature == signature)
+			return slot - 1;
+	}
+	return 0;
+}
+
+void packed_log::put(uint32_t position, std::span<const std::byte> data)
+{
+	std::size_t first_part = std::min(data.size(), data_.size() - position);
+	memcpy(data_.data() + position, data.data(), first_part);
+	memcpy(data_.data(), data.data() + first_part, data.size() - first_part);
+}
+
+uint32_t packed_log::skip(uint32_t sequence, uint32_t position, uint64_t& timestamp_us) const
+{
+	ring_reader reader(data_, position);
+	std::size_t index = read_header(reader, (sequence % block_size) == 0, timestamp_us);
+	if (index < kind_count_)
+		unpack_args(reader, kinds_[index].signature, nullptr);
+	return reader.position();
+}
+
+}
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/protocol.h>
+#include <pcrb/format_fixed.h>
+#include <pcrb/server.h>
+
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include <errno.h>
+
+namespace pcrb
+{
+
+std::span<const std::byte> response::encode(std::span<std::byte, max_size> buffer) const
+{
+	size_t size = 0;
+	buffer[size++] = static_cast<std::byte>(status);
+	uint32_t command_ = hton(command);
+	memcpy(buffer.data() + size, &command_, sizeof(command_));
+	size += sizeof(command_);
+	buffer[size++] = static_cast<std::byte>(type);
+
+	switch (type)
+	{
+		case payload_type::none:
+		// Only used by state_event and log_page
+		case payload_type::state_event:
+		case payload_type::log_page:
+			break;
+		case payload_type::boolean:
+			buffer[size++] = static_cast<std::byte>(value != 0);
+			break;
+		case payload_type::u32:
+		{
+			uint32_t value_ = hton(value);
+			memcpy(buffer.data() + size, &value_, sizeof(value_));
+			size += sizeof(value_);
+			break;
+		}
+	}
+	return buffer.first(size);
+}
+
+std::span<const std::byte> state_event::encode(std::span<std::byte, max_size> buffer) const
+{
+	size_t size = 0;
+	buffer[size++] = static_cast<std::byte>(response_status::ok);
+	uint32_t command_ = hton(std::to_underlying(opcode::subscribe));
+	memcpy(buffer.data() + size, &command_, sizeof(command_));
+	size += sizeof(command_);
+	buffer[size++] = static_cast<std::byte>(payload_type::state_event);
+	buffer[size++] = static_cast<std::byte>(state);
+	uint64_t timestamp_ = hton(timestamp);
+	memcpy(buffer.data() + size, &timestamp_, sizeof(timestamp_));
+	size += sizeof(timestamp_);
+	uint32_t dropped_ = hton(dropped);
+	memcpy(buffer.data() + size, &dropped_, sizeof(dropped_));
+	size += sizeof(dropped_);
+	return buffer.first(size);
+}
+
+std::span<const std::byte> log_page::encode(std::span<std::byte, max_size> buffer) const
+{
+	size_t size = 0;
+	buffer[size++] = static_cast<std::byte>(response_status::ok);
+	uint32_t command_ = hton(command);
+	memcpy(buffer.data() + size, &command_, sizeof(command_));
+	size += sizeof(command_);
+	buffer[size++] = static_cast<std::byte>(payload_type::log_page);
+	uint32_t next_ = hton(next);
+	memcpy(buffer.data() + size, &next_, sizeof(next_));
+	size += sizeof(next_);
+	size_t count = std::min(lines.size(), max_lines);
+	buffer[size++] = static_cast<std::byte>(count);
+	for (const log_line& line: lines.first(count))
+	{
+		uint32_t sequence = hton(line.sequence);
+		memcpy(buffer.data() + size, &sequence, sizeof(sequence));
+		size += sizeof(sequence);
+		uint64_t timestamp = hton(line.timestamp_us);
+		memcpy(buffer.data() + size, &timestamp, sizeof(timestamp));
+		size += sizeof(timestamp);
+		buffer[size++] = static_cast<std::byte>(line.level);
+		size_t text_size = std::min<size_t>(line.size, log_entry::max_text_size - 1);
+		buffer[size++] = static_cast<std::byte>(text_size);
+		memcpy(buffer.data() + size, line.text.data(), text_size);
+		size += text_size;
+	}
+	return buffer.first(size);
+}
+
+std::expected<request, response> decode_request(std::span<const std::byte> data)
+{
+	// First 4 bytes are a magic field, followed by a 4 byte
+	// request. Additional bytes may be required by the request
+	// type.
+	size_t amount = data.size();
+	if (amount < 8)
+	{
+		return std::unexpected(response(response_status::bad_size, no_command, static_cast<uint32_t>(amount)));
+	}
+
+	uint32_t magic;
+	memcpy(&magic, data.data(), 4);
+	magic = ntoh(magic);
+
+	uint32_t code;
+	memcpy(&code, data.data() + 4, 4);
+	code = ntoh(code);
+
+	if (magic != request_magic)
+	{
+		return std::unexpected(response(response_status::bad_magic, code, magic));
+	}
+
+	uint32_t argument = 0;
+	if (amount >= 12)
+	{
+		memcpy(&argument, data.data() + 8, 4);
+		argument = ntoh(argument);
+	}
+
+	return request{ .code = code, .argument = argument, .size = amount, .payload = data.subspan(8) };
+}
+
+std::expected<log_query, response> decode_log_query(const request& request)
+{
+	// The payload starts with the argument
+	std::span<const std::byte> payload = request.payload;
+	if (payload.size() < 4)
+	{
+		return std::unexpected(response(response_status::bad_size, request.code, static_cast<uint32_t>(request.size)));
+	}
+
+	log_query result = { .since = request.argument, .tail = 0, .filter = {} };
+	if (payload.size() >= 5)
+	{
+		uint8_t level = static_cast<uint8_t>(payload[4]);
+		if (level > std::to_underlying(log_level::error))
+		{
+			return std::unexpected(response(response_status::bad_argument, request.code, static_cast<uint32_t>(level)));
+		}
+		result.filter.level = static_cast<log_level>(level);
+	}
+	if (payload.size() >= 6)
+		result.tail = static_cast<uint8_t>(payload[5]);
+	if (payload.size() > 6)
+	{
+		std::span<const std::byte> text = payload.subspan(6);
+		result.filter.text = std::string_view(reinterpret_cast<const char*>(text.data()), text.size());
+	}
+	return result;
+}
+
+std::string_view describe(const response& error, std::span<char> output)
+{
+	switch (error.status)
+	{
+		case response_status::ok:
+			return "ok";
+		case response_status::bad_size:
+			if (error.command == no_command)
+				return format_fixed(output, "Received bad network request with size {}", error.value);
+			return format_fixed(output, "Received bad network request, bad size {}", error.value);
+		case response_status::bad_magic:
+			return format_fixed(output, "Received bad network request, bad magic {}", error.value);
+		case response_status::unknown_command:
+			return format_fixed(output, "Received bad network request, unknown command {}", error.command);
+		case response_status::timeout:
+			return format_fixed(output, "failed to handle request: {}", "timeout");
+		case response_status::error:
+			return format_fixed(output, "failed to handle request: {}",
+				error.value == ENOTCONN ? "connection closed" : strerror(error.value));
+		case response_status::busy:
+			return format_fixed(output, "command {} is busy", error.command);
+		case response_status::unauthorized:
+			switch (error.value)
+			{
+				case 0: return "Received bad network request, not authenticated";
+				case 1: return "Received bad network request, bad authentication tag";
+				case 2: return "Received bad network request, replayed counter";
+			}
+			return format_fixed(output, "Received bad network request, authentication failure {}", error.value);
+		case response_status::bad_argument:
+			return format_fixed(output, "Received bad network request, bad argument {}", error.value);
+	}
+	return format_fixed(output, "unknown status {}", std::to_underlying(error.status));
+}
+
+std::string_view describe(const state_event& event, std::span<char> output)
+{
+	return format_fixed(output, "PC 3.3V rail status: {} at {} us, {} dropped",
+		event.state, event.timestamp, event.dropped);
+}
+
+std::string_view describe(const log_page& page, std::span<char> output)
+{
+	std::span<char> rest = output;
+	for (const log_line& line: page.lines.first(std::min(page.lines.size(), log_page::max_lines)))
+	{
+		rest = rest.subspan(format_fixed(rest, "{} {} {}: {}\r\n",
+			line.sequence, line.timestamp_us, log_level_name(line.level), line.view()).size());
+	}
+	rest = rest.subspan(format_fixed(rest, "next: {}", page.next).size());
+	return std::string_view(output.data(), output.size() - rest.size());
+}
+
+}
@@ -1,63 +1,634 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2025
+// SPDX-FileCopyrightText: Gabriel Marcano, 2025 - 2026
 /// @file
 
 #include <pcrb/request_handler.h>
 #include <pcrb/server.h>
+#include <pcrb/protocol.h>
+#include <pcrb/log.h>
 
-#include <gpico/log.h>
+#include <pico/cyw43_arch.h>
 
-#include <lwip/sockets.h>
+#include <lwip/altcp.h>
+#include <lwip/tcp.h>
+#include <lwip/pbuf.h>
+#include <lwip/err.h>
+#include <lwip/timeouts.h>
+#include <lwip/tcpip.h>
 
-#include <string>
-#include <format>
-#include <vector>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <optional>
 #include <span>
+#include <utility>
 
-using gpico::sys_log;
+#include <errno.h>
 
 namespace pcrb
 {
 
-request_handler::request_handler(socket socket_)
-:socket_(std::move(socket_))
-{}
+// Resolution of the connection deadlines, in milliseconds.
+constexpr const uint32_t deadline_tick_ms = 100;
 
-std::expected<std::size_t, int> request_handler::read(std::span<std::byte> data)
+// Limit for each connection phase, in deadline ticks, in the order of
+// request_handler::deadline. The idle limit is how long keep-alive
+// connections may sit between requests.
+constexpr const std::array<uint32_t, request_handler::deadline_count> deadline_ticks = {
+	2000 / deadline_tick_ms,
+	500 / deadline_tick_ms,
+	1000 / deadline_tick_ms,
+	30 * 1000 / deadline_tick_ms,
+};
+
+// Setup limit for TLS connections, which includes the handshake. A full
+// handshake takes a few seconds of public key operations on the RP2040.
+constexpr const uint32_t secure_setup_ticks = 10 * 1000 / deadline_tick_ms;
+
+// Send buffer space needed to send a state change event, in either form.
+constexpr const std::size_t max_event_size = 128;
+
+// TCP keep-alive settings for subscribers, which may otherwise sit idle
+// forever on a dead connection, in milliseconds.
+constexpr const uint32_t subscriber_keep_idle = 60 * 1000;
+constexpr const uint32_t subscriber_keep_interval = 10 * 1000;
+constexpr const uint32_t subscriber_keep_count = 3;
+
+session_frame_pool session_frames;
+
+// Replies gathered for a single write. Only one connection runs at a time,
+// and it flushes before anything else can, so they can all share it.
+using reply_builder = response_builder<2 * request_handler::max_reply_size>;
+
+// Only ever touched from the lwIP thread
+static std::array<std::optional<request_handler>, max_connections> handlers;
+static reply_builder pending;
+// Text form of the reply being sent, see respond()
+static std::array<char, request_handler::max_reply_size> reply_text;
+static request_handler *pending_owner = nullptr;
+static deadline_wheel deadlines;
+static bool ticking = false;
+static uint32_t next_id = 0;
+
+// Only written from the lwIP thread, so plain loads and stores are enough
+static std::array<std::atomic<uint32_t>, request_handler::deadline_count> eviction_counts;
+static std::atomic<uint32_t> reply_count;
+static std::atomic<uint32_t> write_count;
+static std::atomic<uint32_t> segment_count;
+
+static void count(std::atomic<uint32_t>& counter, uint32_t amount = 1)
+{
+	counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+request_handler::request_handler(altcp_pcb *pcb, request_callback callback, bool secure)
+:pcb_(pcb), callback_(callback), id_(++next_id), chain_(nullptr), waiter_(),
+	reason_(wait_reason::data), wanted_(0), options_(0), deadline_(),
+	phase_(deadline::setup), secure_(secure), closed_(false),
+	cancelled_(false), finished_(false), subscribed_(false), deferred_(false),
+	events_()
+{
+	deadline_.expire = expire;
+	deadline_.context = this;
+}
+
+request_handler::~request_handler()
 {
-	uint16_t size = 0;
-	for (ssize_t amount = 0, received = 0; received < 2; received += amount)
+	deadlines.cancel(deadline_);
+	if (pending_owner == this)
+	{
+		pending.clear();
+		pending_owner = nullptr;
+	}
+}
+
+uint32_t request_handler::evictions(deadline phase)
+{
+	return eviction_counts[std::to_underlying(phase)].load(std::memory_order_relaxed);
+}
+
+request_handler::reply_stats request_handler::reply_counts()
+{
+	return {
+		.replies = reply_count.load(std::memory_order_relaxed),
+		.writes = write_count.load(std::memory_order_relaxed),
+		.segments = segment_count.load(std::memory_order_relaxed),
+	};
+}
+
+err_t request_handler::start(altcp_pcb *pcb, request_callback callback, bool secure)
+{
+	auto slot = std::ranges::find_if(handlers, [](auto& handler){ return !handler.has_value(); });
+	if (slot == handlers.end())
+	{
+		sys_log.push<"too many connections, dropping new connection", log_level::warning>();
+		altcp_abort(pcb);
+		return ERR_ABRT;
+	}
+
+	request_handler& handler = slot->emplace(pcb, callback, secure);
+	altcp_arg(pcb, &handler);
+	altcp_recv(pcb, on_recv);
+	altcp_sent(pcb, on_sent);
+	altcp_err(pcb, on_err);
+	// Clients wait on every reply, and replies go out in one write anyway
+	altcp_nagle_disable(pcb);
+
+	if (!ticking)
+	{
+		sys_timeout(deadline_tick_ms, tick, nullptr);
+		ticking = true;
+	}
+
+	// Runs until it needs the first bytes of the first request
+	if (!handler.run())
+	{
+		sys_log.push<"no room for connection, dropping new connection", log_level::warning>();
+		handler.finished_ = true;
+		return release(&handler);
+	}
+	sys_log.push<"new connection accepted">();
+	return ERR_OK;
+}
+
+coroutine<session_frames> request_handler::run()
+{
+	arm(deadline::setup);
+	for (;;)
+	{
+		// Subscribers get their events sent while waiting for a request
+		bool open;
+		while ((open = co_await incoming()) && !available())
+			send_events();
+		if (!open)
+			break;
+
+		arm(deadline::header);
+		if (!co_await receive(2))
+			break;
+
+		uint16_t size = (pbuf_get_at(chain_, 0) << 8) | pbuf_get_at(chain_, 1);
+		std::size_t kept = std::min<std::size_t>(size, max_request_size);
+		arm(deadline::body);
+		if (!co_await receive(2 + kept))
+			break;
+		// Replies are never left half written, wait for room for them first
+		if (!co_await writable(max_reply_size))
+			break;
+
+		consume(2);
+		dispatch(kept);
+		consume(kept);
+
+		// Nothing else is read until a deferred request is replied to
+		if (deferred_)
+		{
+			if (!co_await completion())
+				break;
+		}
+
+		// Skip whatever did not fit of a truncated request, still as part of
+		// its body. Not a co_await on the right of &&, which GCC 12 awaits
+		// even when the left is false.
+		std::size_t discard = size - kept;
+		while (discard)
+		{
+			if (!co_await receive(1))
+				break;
+			std::size_t skipped = std::min(discard, available());
+			consume(skipped);
+			discard -= skipped;
+		}
+		if (discard)
+			break;
+
+		if (!(options_ & option_keep_alive))
+		{
+			finished_ = true;
+			co_return;
+		}
+		if (subscribed_)
+			deadlines.cancel(deadline_);
+		else
+			arm(deadline::idle);
+	}
+
+	// Closed, failed, or evicted before a full request came in. Evictions
+	// are replied to by expire().
+	if (pcb_ && !cancelled_)
 	{
-		amount = recv(socket_.get(), reinterpret_cast<std::byte*>(&size) + received, 2 - received, 0);
-		if (amount == -1)
+		// Keep-alive clients hang up between requests when done
+		if (idle())
+		{
+			sys_log.push<"connection closed">();
+		}
+		else
 		{
-			return std::unexpected(errno);
+			respond(response(response_status::error, no_command, static_cast<uint32_t>(ENOTCONN)));
 		}
 	}
-	size = ntoh(size);
+	finished_ = true;
+}
+
+request_handler::awaiter request_handler::receive(std::size_t amount)
+{
+	return {*this, wait_reason::data, amount};
+}
+
+request_handler::awaiter request_handler::writable(std::size_t amount)
+{
+	return {*this, wait_reason::send_space, amount};
+}
+
+request_handler::awaiter request_handler::incoming()
+{
+	return {*this, wait_reason::data_or_events, 1};
+}
 
-	size = std::min<uint16_t>(size, data.size());
+request_handler::awaiter request_handler::completion()
+{
+	return {*this, wait_reason::deferred, 0};
+}
 
-	for (size_t amount = 0, received = 0; received < size; received += amount)
+bool request_handler::awaiter::await_ready() const noexcept
+{
+	return handler.satisfied(reason, amount);
+}
+
+void request_handler::awaiter::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+	handler.waiter_ = handle;
+	handler.reason_ = reason;
+	handler.wanted_ = amount;
+}
+
+bool request_handler::awaiter::await_resume() const noexcept
+{
+	if (handler.cancelled_ || !handler.pcb_)
+		return false;
+	switch (reason)
 	{
-		amount = recv(socket_.get(), data.data() + received, size - received, 0);
-		if (amount == -1)
+		case wait_reason::data:
+			return handler.available() >= amount;
+		case wait_reason::send_space:
+			return true;
+		case wait_reason::data_or_events:
+			return handler.available() || !handler.closed_;
+		case wait_reason::deferred:
+			return !handler.deferred_;
+	}
+	return true;
+}
+
+bool request_handler::satisfied(wait_reason reason, std::size_t amount) const
+{
+	if (cancelled_ || !pcb_)
+		return true;
+	switch (reason)
+	{
+		case wait_reason::data:
+			return closed_ || available() >= amount;
+		case wait_reason::send_space:
+			return send_space(amount);
+		case wait_reason::data_or_events:
+			return closed_ || available() >= amount ||
+				(!events_.empty() && send_space(max_event_size));
+		case wait_reason::deferred:
+			// The client closing its side still gets the reply
+			return !deferred_;
+	}
+	return true;
+}
+
+bool request_handler::send_space(std::size_t amount) const
+{
+	// Replies not flushed yet still need their room too
+	std::size_t queued = pending_owner == this ? pending.size() : 0;
+	return altcp_sndbuf(pcb_) >= amount + queued &&
+		(altcp_sndqueuelen(pcb_) + 2) <= TCP_SND_QUEUELEN;
+}
+
+std::size_t request_handler::available() const
+{
+	return chain_ ? chain_->tot_len : 0;
+}
+
+bool request_handler::idle() const
+{
+	return !available();
+}
+
+void request_handler::consume(std::size_t amount)
+{
+	if (!amount)
+		return;
+	chain_ = pbuf_free_header(chain_, amount);
+	// Only now let the client send more
+	if (pcb_)
+		altcp_recved(pcb_, amount);
+}
+
+void request_handler::dispatch(std::size_t size)
+{
+	// Requests within a single pbuf are used in place, only ones split across
+	// pbufs are gathered here
+	std::array<std::byte, max_request_size> scratch;
+	const void *data = nullptr;
+	if (size)
+		data = pbuf_get_contiguous(chain_, scratch.data(), scratch.size(), size, 0);
+	callback_(*this, std::span(static_cast<const std::byte*>(data), size));
+}
+
+err_t request_handler::wake()
+{
+	if (waiter_ && satisfied(reason_, wanted_))
+	{
+		std::exchange(waiter_, nullptr).resume();
+	}
+	flush();
+
+	if (finished_)
+		return release(this);
+	return ERR_OK;
+}
+
+err_t request_handler::release(request_handler *handler)
+{
+	err_t result = ERR_OK;
+	handler->flush();
+	altcp_pcb *pcb = handler->pcb_;
+	if (handler->chain_)
+	{
+		// Closing with unacknowledged received data resets the connection,
+		// which would throw away the reply
+		if (pcb)
+			altcp_recved(pcb, handler->chain_->tot_len);
+		pbuf_free(handler->chain_);
+	}
+
+	if (pcb)
+	{
+		altcp_arg(pcb, nullptr);
+		altcp_recv(pcb, nullptr);
+		altcp_sent(pcb, nullptr);
+		altcp_err(pcb, nullptr);
+		if (altcp_close(pcb) != ERR_OK)
 		{
-			return std::unexpected(errno);
+			altcp_abort(pcb);
+			result = ERR_ABRT;
 		}
 	}
 
-	return size;
+	auto slot = std::ranges::find_if(handlers,
+		[handler](auto& entry){ return entry && &*entry == handler; });
+	slot->reset();
+	return result;
+}
+
+err_t request_handler::on_recv(void *arg, altcp_pcb*, pbuf *p, err_t err)
+{
+	request_handler *self = static_cast<request_handler*>(arg);
+	if (err != ERR_OK)
+	{
+		if (p)
+			pbuf_free(p);
+		return ERR_OK;
+	}
+
+	if (!p)
+	{
+		self->closed_ = true;
+	}
+	else
+	{
+		if (self->chain_)
+			pbuf_cat(self->chain_, p);
+		else
+			self->chain_ = p;
+	}
+	return self->wake();
+}
+
+err_t request_handler::on_sent(void *arg, altcp_pcb*, u16_t)
+{
+	return static_cast<request_handler*>(arg)->wake();
 }
 
-int request_handler::send(std::span<std::byte> data)
+void request_handler::subscribe()
 {
-	return ::send(socket_.get(), data.data(), data.size(), 0);
+	if (subscribed_)
+		return;
+	subscribed_ = true;
+	options_ |= option_keep_alive;
+	events_.clear();
+	if (pcb_)
+	{
+		altcp_keepalive_enable(pcb_, subscriber_keep_idle,
+			subscriber_keep_interval, subscriber_keep_count);
+	}
+	sys_log.push<"new subscriber">();
+}
+
+void request_handler::publish(const state_event& event)
+{
+	bool queued = false;
+	cyw43_arch_lwip_begin();
+	for (auto& handler : handlers)
+	{
+		if (handler && handler->subscribed_)
+		{
+			handler->events_.push(event);
+			queued = true;
+		}
+	}
+	cyw43_arch_lwip_end();
+
+	// Events are already queued, so if this fails they just go out with the
+	// next one
+	if (queued)
+		tcpip_try_callback(wake_subscribers, nullptr);
+}
+
+void request_handler::wake_subscribers(void*)
+{
+	for (auto& handler : handlers)
+	{
+		if (handler && handler->subscribed_)
+			handler->wake();
+	}
+}
+
+void request_handler::send_events()
+{
+	while (!events_.empty() && send_space(max_event_size))
+	{
+		state_event event = events_.front();
+		event.dropped = events_.dropped();
+		events_.pop();
+		if (options_ & option_binary)
+		{
+			std::array<std::byte, state_event::max_size> buffer;
+			send(event.encode(buffer));
+		}
+		else
+		{
+			send(describe(event, text_buffer()));
+		}
+	}
+}
+
+void request_handler::arm(deadline phase)
+{
+	phase_ = phase;
+	uint32_t ticks = deadline_ticks[std::to_underlying(phase)];
+	if (secure_ && phase == deadline::setup)
+		ticks = secure_setup_ticks;
+	deadlines.schedule(deadline_, ticks);
+}
+
+void request_handler::expire(void *context)
+{
+	request_handler *self = static_cast<request_handler*>(context);
+	count(eviction_counts[std::to_underlying(self->phase_)]);
+
+	if (self->phase_ == deadline::idle)
+	{
+		sys_log.push<"closing idle connection">();
+	}
+	else
+	{
+		self->respond(response(response_status::timeout, no_command, std::to_underlying(self->phase_)));
+	}
+	self->cancelled_ = true;
+	self->wake();
+}
+
+void request_handler::tick(void*)
+{
+	deadlines.advance();
+	sys_timeout(deadline_tick_ms, tick, nullptr);
+}
+
+void request_handler::on_err(void *arg, err_t)
+{
+	// lwIP already freed the PCB
+	request_handler *self = static_cast<request_handler*>(arg);
+	self->pcb_ = nullptr;
+	self->wake();
+}
+
+int request_handler::send(std::span<const std::byte> data)
+{
+	if (!pcb_)
+		return ENOTCONN;
+
+	// Whoever queued replies before is done running
+	if (pending_owner && pending_owner != this)
+		pending_owner->flush();
+
+	bool framed = options_ & (option_keep_alive | option_binary);
+	std::size_t size = data.size() + (framed ? 2 : 0);
+	if (!pending.fits(size))
+	{
+		int err = flush();
+		if (err)
+			return err;
+	}
+
+	count(reply_count);
+	bool queued = framed ? pending.append_framed(data) : pending.append(data);
+	if (!queued)
+	{
+		// Too large to ever be gathered, so it goes out on its own
+		std::array<std::byte, 2> size_bytes = {
+			static_cast<std::byte>(data.size() >> 8),
+			static_cast<std::byte>(data.size()),
+		};
+		int err = framed ? write(size_bytes) : 0;
+		return err ? err : write(data);
+	}
+	pending_owner = this;
+	return 0;
+}
+
+int request_handler::flush()
+{
+	if (pending_owner != this)
+		return 0;
+	pending_owner = nullptr;
+	int err = write(pending.data());
+	pending.clear();
+	return err;
+}
+
+int request_handler::write(std::span<const std::byte> data)
+{
+	if (!pcb_)
+		return ENOTCONN;
+	if (data.empty())
+		return 0;
+
+	err_t err = altcp_write(pcb_, data.data(), data.size(), TCP_WRITE_FLAG_COPY);
+	if (err == ERR_OK)
+		err = altcp_output(pcb_);
+	if (err != ERR_OK)
+		return err_to_errno(err);
+
+	u16_t mss = std::max<u16_t>(altcp_mss(pcb_), 1);
+	count(write_count);
+	count(segment_count, (data.size() + mss - 1) / mss);
+	return 0;
 }
 
 int request_handler::send(std::string_view data)
 {
-	return ::send(socket_.get(), data.data(), data.size(), 0);
+	return send(std::as_bytes(std::span(data)));
+}
+
+void request_handler::respond(const response& error)
+{
+	respond(error, [&error](std::span<char> output) { return describe(error, output); });
+}
+
+std::span<char> request_handler::text_buffer()
+{
+	return reply_text;
+}
+
+void request_handler::log_response(const response& binary)
+{
+	sys_log.push<"reply to command {}: status {}, value {}">(
+		binary.command, std::to_underlying(binary.status), binary.value);
+}
+
+uint32_t request_handler::defer()
+{
+	deferred_ = true;
+	deadlines.cancel(deadline_);
+	return id_;
+}
+
+void request_handler::resume()
+{
+	deferred_ = false;
+	wake();
+}
+
+request_handler* request_handler::find(uint32_t id)
+{
+	auto slot = std::ranges::find_if(handlers,
+		[id](auto& entry){ return entry && entry->id_ == id; });
+	return slot != handlers.end() ? &**slot : nullptr;
+}
+
+uint32_t request_handler::options() const
+{
+	return options_;
+}
+
+void request_handler::set_options(uint32_t options)
+{
+	options_ = options & supported_options;
 }
 
 }
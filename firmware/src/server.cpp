@@ -1,140 +1,115 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2024
+// SPDX-FileCopyrightText: Gabriel Marcano, 2024 - 2026
 /// @file
 
 #include <pcrb/server.h>
+#include <pcrb/request_handler.h>
+#include <pcrb/log.h>
 
-#include <gpico/log.h>
+#include <pico/cyw43_arch.h>
 
-#include <lwip/dns.h>
-#include <lwip/pbuf.h>
-#include <lwip/udp.h>
-#include <lwip/sockets.h>
-#include <lwip/netdb.h>
-
-#include <string>
-#include <format>
-#include <vector>
-#include <span>
+#include <lwip/altcp.h>
+#include <lwip/altcp_tcp.h>
+#include <lwip/altcp_tls.h>
+#include <lwip/tcp.h>
+#include <lwip/err.h>
 
 #include <errno.h>
 
-using gpico::sys_log;
-
 namespace pcrb
 {
 
-socket::socket()
-:socket_(-1)
+server::server()
+:pcb_(nullptr), callback_(nullptr), tls_(nullptr)
 {}
 
-socket::socket(int sock)
-:socket_(sock)
-{}
-
-socket::~socket()
-{
-	if (socket_ != -1)
-	{
-		shutdown();
-		close();
-	}
-}
-
-void socket::shutdown()
+server::~server()
 {
-	::shutdown(socket_, SHUT_RDWR);
+	close();
 }
 
-void socket::close()
+int server::listen(uint16_t port, request_callback callback, altcp_tls_config *tls)
 {
-	::close(socket_);
-	socket_ = -1;
-}
+	close();
+	callback_ = callback;
+	tls_ = tls;
 
-socket::socket(socket&& sock)
-:socket_(-1)
-{
-	std::swap(socket_, sock.socket_);
-}
-
-socket& socket::operator=(socket&& sock)
-{
-	std::swap(socket_, sock.socket_);
-	return *this;
-}
-
-int socket::get()
-{
-	return socket_;
-}
+	cyw43_arch_lwip_begin();
+	tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+	if (!pcb)
+	{
+		cyw43_arch_lwip_end();
+		return ENOMEM;
+	}
 
-void addrinfo_deleter::operator()(addrinfo *info)
-{
-	if (info)
-		freeaddrinfo(info);
-}
+	// Allow listening again right away if we're restarted
+	ip_set_option(pcb, SOF_REUSEADDR);
+	err_t err = tcp_bind(pcb, IP_ANY_TYPE, port);
+	if (err != ERR_OK)
+	{
+		tcp_close(pcb);
+		cyw43_arch_lwip_end();
+		return err_to_errno(err);
+	}
 
-int server::listen(uint16_t port)
-{
-	const addrinfo hints = {
-		.ai_flags = 0,
-		.ai_family = AF_UNSPEC,
-		.ai_socktype = SOCK_STREAM,
-		.ai_protocol = 0,
-		.ai_addrlen = 0,
-		.ai_addr = 0,
-		.ai_canonname = 0,
-		.ai_next = 0,
-	};
-	addrinfo_ptr result = NULL;
-	addrinfo *result_ = NULL;
-	int err = getaddrinfo("0.0.0.0", std::to_string(port).c_str(), &hints, &result_);
-	if (err == -1)
-		return errno;
-	result.reset(result_);
-	result_ = nullptr;
-
-	socket sock{::socket(result->ai_family, result->ai_socktype, result->ai_protocol)};
-	if (sock.get() == -1)
-		return errno;
-
-	err = bind(sock.get(), result->ai_addr, result->ai_addrlen);
-	if (err == -1)
-		return errno;
-
-	// FIXME Should we only have a queue depth of 1?
-	err = ::listen(sock.get(), 1);
-	if (err == -1)
-		return errno;
-
-	socket_ipv4 = std::move(sock);
+	// On success this frees the original PCB
+	tcp_pcb *listener = tcp_listen(pcb);
+	if (!listener)
+	{
+		tcp_close(pcb);
+		cyw43_arch_lwip_end();
+		return ENOMEM;
+	}
 
+	tcp_arg(listener, this);
+	tcp_accept(listener, accept);
+	pcb_ = listener;
+	cyw43_arch_lwip_end();
 	return 0;
 }
 
-std::expected<socket, int> server::accept()
+void server::close()
 {
-	struct sockaddr_storage remote_addr;
-	socklen_t addr_size = sizeof(remote_addr);
-	int sock = ::accept(socket_ipv4.get(), reinterpret_cast<sockaddr*>(&remote_addr), &addr_size);
-	if (sock == -1)
-		return std::unexpected(errno);
-
-	constexpr const timeval read_timeout = {
-		.tv_sec = 1,
-		.tv_usec = 0
-	};
-
-	setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &read_timeout, sizeof(read_timeout));
-	return socket(sock);
+	if (!pcb_)
+		return;
+	cyw43_arch_lwip_begin();
+	tcp_arg(pcb_, nullptr);
+	tcp_accept(pcb_, nullptr);
+	tcp_close(pcb_);
+	cyw43_arch_lwip_end();
+	pcb_ = nullptr;
 }
 
-
-void server::close()
+err_t server::accept(void *arg, tcp_pcb *pcb, err_t err)
 {
-	socket_ipv4.shutdown();
-	socket_ipv4.close();
+	server *self = static_cast<server*>(arg);
+	if (err != ERR_OK || !pcb || !self)
+	{
+		sys_log.push<"unable to accept connection, error {}", log_level::warning>(err);
+		return ERR_VAL;
+	}
+
+	// Connections are only wrapped once accepted, so the listener stays a
+	// plain PCB either way
+	altcp_pcb *conn = altcp_tcp_wrap(pcb);
+	if (!conn)
+	{
+		sys_log.push<"no memory for connection, dropping new connection", log_level::warning>();
+		tcp_abort(pcb);
+		return ERR_ABRT;
+	}
+	if (self->tls_)
+	{
+		altcp_pcb *secure = altcp_tls_wrap(self->tls_, conn);
+		if (!secure)
+		{
+			sys_log.push<"no memory for TLS, dropping new connection", log_level::warning>();
+			altcp_abort(conn);
+			return ERR_ABRT;
+		}
+		conn = secure;
+	}
+	return request_handler::start(conn, self->callback_, self->tls_ != nullptr);
 }
 
 }
@@ -1,11 +1,10 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2024
+// SPDX-FileCopyrightText: Gabriel Marcano, 2023 - 2026
 /// @file
 
 #include <pcrb/switch_task.h>
 #include <pcrb/switch.h>
-
-#include <gpico/log.h>
+#include <pcrb/log.h>
 
 #include <pico/stdlib.h>
 #include <pico/cyw43_arch.h>
@@ -14,15 +13,38 @@
 #include <queue.h>
 #include <task.h>
 
-#include <format>
-
-using gpico::sys_log;
+#include <atomic>
+#include <cstdint>
 
 namespace pcrb
 {
 
 switch_queue switch_comms;
 
+// Presses are numbered from 1, so 0 is never a valid press
+static uint32_t presses_queued = 0;
+static std::atomic<uint32_t> presses_done = 0;
+// Task in wait_for_press(), if any
+static std::atomic<TaskHandle_t> press_waiter = nullptr;
+
+uint32_t queue_press(unsigned time_ms)
+{
+	if (xQueueSendToBack(switch_comms.get(), &time_ms, 0) != pdTRUE)
+		return 0;
+	return ++presses_queued;
+}
+
+void wait_for_press(uint32_t press)
+{
+	// Sequentially consistent, so either the switch task sees the waiter or
+	// the waiter sees the press done
+	press_waiter.store(xTaskGetCurrentTaskHandle());
+	// Serial comparison, in case the count ever wraps
+	while (static_cast<int32_t>(presses_done.load() - press) < 0)
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	press_waiter.store(nullptr);
+}
+
 void switch_task(void*)
 {
 	static pcrb::pc_switch<22> switch_(false);
@@ -30,12 +52,16 @@ void switch_task(void*)
 	{
 		unsigned data = 0;
 		xQueueReceive(switch_comms.get(), &data, portMAX_DELAY);
-		sys_log.push(std::format("switch task: toggling pin for {} ms", data));
+		sys_log.push<"switch task: toggling pin for {} ms">(data);
 		cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 1);
 		switch_.set(true);
 		vTaskDelay(data);
 		cyw43_arch_gpio_put(CYW43_WL_GPIO_LED_PIN, 0);
 		switch_.set(false);
+
+		presses_done.fetch_add(1);
+		if (TaskHandle_t waiter = press_waiter.load())
+			xTaskNotifyGive(waiter);
 	}
 }
 
@@ -0,0 +1,261 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/syslog_task.h>
+#include <pcrb/log.h>
+#include <pcrb/wifi_management_task.h>
+// This secrets.h includes strings for WIFI_SSID and WIFI_PASSWORD, and
+// optionally SYSLOG_COLLECTOR and SYSLOG_PORT
+#include "secrets.h"
+
+#include <pico/cyw43_arch.h>
+
+#include <lwip/netdb.h>
+#include <lwip/sockets.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <span>
+
+#ifndef SYSLOG_PORT
+#define SYSLOG_PORT 514
+#endif
+
+namespace pcrb
+{
+
+// How often to send what was logged since the last time.
+constexpr const TickType_t ship_period = pdMS_TO_TICKS(1000);
+
+// Time between attempts to resolve the collector.
+constexpr const TickType_t resolve_delay = pdMS_TO_TICKS(10000);
+
+// Header, host name and the longest text an entry renders to.
+constexpr const size_t max_message_size = 128 + log_entry::max_text_size;
+
+static_assert(max_message_size <= 1280 - 40 - 8,
+	"a message must fit in a single packet at the minimum IPv6 MTU, so it is never fragmented");
+
+// local0, syslog has nothing better for this.
+constexpr const unsigned facility = 16;
+
+static std::atomic<uint32_t> sent_count = 0;
+static std::atomic<uint32_t> dropped_count = 0;
+
+syslog_stats syslog_counts()
+{
+	return {
+		.sent = sent_count.load(std::memory_order_relaxed),
+		.dropped = dropped_count.load(std::memory_order_relaxed),
+	};
+}
+
+#ifdef SYSLOG_COLLECTOR
+
+static unsigned severity(log_level level)
+{
+	switch (level)
+	{
+		case log_level::debug:
+			return 7;
+		case log_level::info:
+			return 6;
+		case log_level::warning:
+			return 4;
+		case log_level::error:
+			return 3;
+	}
+	return 6;
+}
+
+struct addrinfo_deleter
+{
+	void operator()(addrinfo *info) const
+	{
+		freeaddrinfo(info);
+	}
+};
+
+// UDP socket connected to the collector
+class collector
+{
+public:
+	collector()
+	:socket_(-1)
+	{}
+
+	~collector()
+	{
+		close();
+	}
+
+	bool ready() const
+	{
+		return socket_ >= 0;
+	}
+
+	bool open()
+	{
+		close();
+
+		addrinfo hints = {};
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_DGRAM;
+		addrinfo *result = nullptr;
+		int err = getaddrinfo(SYSLOG_COLLECTOR, nullptr, &hints, &result);
+		std::unique_ptr<addrinfo, addrinfo_deleter> info(result);
+		if (err != 0 || !info)
+		{
+			sys_log.push<"syslog: unable to resolve {}, error {}", log_level::warning>(SYSLOG_COLLECTOR, err);
+			return false;
+		}
+
+		if (info->ai_family == AF_INET6)
+			reinterpret_cast<sockaddr_in6*>(info->ai_addr)->sin6_port = htons(SYSLOG_PORT);
+		else
+			reinterpret_cast<sockaddr_in*>(info->ai_addr)->sin_port = htons(SYSLOG_PORT);
+
+		int socket_fd = socket(info->ai_family, SOCK_DGRAM, 0);
+		if (socket_fd < 0)
+		{
+			sys_log.push<"syslog: unable to create socket, error {}", log_level::warning>(errno);
+			return false;
+		}
+		// Connected, so sends don't need the address, and errors the
+		// collector reports back are seen
+		if (connect(socket_fd, info->ai_addr, info->ai_addrlen) != 0)
+		{
+			sys_log.push<"syslog: unable to connect to {}, error {}", log_level::warning>(SYSLOG_COLLECTOR, errno);
+			::close(socket_fd);
+			return false;
+		}
+		socket_ = socket_fd;
+		return true;
+	}
+
+	bool send(std::span<const char> data)
+	{
+		if (::send(socket_, data.data(), data.size(), 0) < 0)
+		{
+			// Resolved again later, in case the collector moved
+			sys_log.push<"syslog: unable to send, error {}", log_level::warning>(errno);
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close()
+	{
+		if (socket_ >= 0)
+			::close(socket_);
+		socket_ = -1;
+	}
+
+	collector(const collector&) = delete;
+	collector& operator=(const collector&) = delete;
+
+private:
+	int socket_;
+};
+
+// Formats a message as RFC 5424. There is no wall clock, so the timestamp
+// is left out, and the order and uptime go in the standard meta parameters
+// instead.
+static size_t format_message(const log_entry& entry, std::span<char> output)
+{
+	std::array<char, log_entry::max_text_size> text;
+	entry.render(text);
+	int size = snprintf(output.data(), output.size(),
+		"<%u>1 - %s pcrb - - [meta sequenceId=\"%lu\" sysUpTime=\"%llu\"] %s",
+		facility * 8 + severity(entry.level()), CYW43_HOST_NAME,
+		// sequenceId counts from 1, and wraps before 2^31
+		entry.sequence % 2147483647 + 1,
+		// sysUpTime is in hundredths of a second
+		static_cast<unsigned long long>(entry.timestamp_us / 10000),
+		text.data());
+	if (size < 0)
+		return 0;
+	// Truncated otherwise, snprintf() leaves room for the NUL
+	return std::min<size_t>(size, output.size() - 1);
+}
+
+// Sends the messages from next up to end, each in a datagram of its own as
+// RFC 5426 asks. Returns the sequence number of the first message not sent.
+static uint32_t ship(collector& to, uint32_t next, uint32_t end)
+{
+	for (; next != end; ++next)
+	{
+		log_entry entry;
+		// Overwritten while sending the rest, counted as lost next time
+		if (!sys_log.read(next, entry))
+			break;
+
+		std::array<char, max_message_size> message;
+		size_t size = format_message(entry, message);
+		if (!to.send(std::span(message).first(size)))
+			break;
+		sent_count.fetch_add(1, std::memory_order_relaxed);
+	}
+	return next;
+}
+
+void syslog_task(void*)
+{
+	collector collector_;
+	// Everything still in the log is shipped, including what was logged
+	// while booting
+	uint32_t next = sys_log.first();
+	TickType_t last_attempt = xTaskGetTickCount() - resolve_delay;
+	for (;;)
+	{
+		vTaskDelay(ship_period);
+		if (!network_ready())
+			continue;
+
+		if (!collector_.ready())
+		{
+			TickType_t now = xTaskGetTickCount();
+			if ((now - last_attempt) < resolve_delay)
+				continue;
+			last_attempt = now;
+			if (!collector_.open())
+				continue;
+		}
+
+		// The oldest first, as reading collects newer messages
+		uint32_t first = sys_log.first();
+		uint32_t end = sys_log.end();
+		if (static_cast<int32_t>(next - first) < 0)
+		{
+			// Reported in the log, so it gets shipped next time around
+			uint32_t lost = first - next;
+			dropped_count.fetch_add(lost, std::memory_order_relaxed);
+			sys_log.push<"syslog: {} messages lost before they could be sent", log_level::warning>(lost);
+			next = first;
+		}
+
+		next = ship(collector_, next, end);
+	}
+}
+
+#else
+
+void syslog_task(void*)
+{
+	sys_log.push<"syslog: no collector configured">();
+	vTaskDelete(nullptr);
+	for(;;);
+}
+
+#endif
+
+}
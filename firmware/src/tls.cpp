@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/tls.h>
+#include <pcrb/log.h>
+// This secrets.h includes strings for WIFI_SSID and WIFI_PASSWORD, and
+// optionally TLS_CERT and TLS_KEY
+#include "secrets.h"
+
+#include <pico/cyw43_arch.h>
+
+#include <lwip/altcp_tls.h>
+
+#include <cstdint>
+
+#if defined(TLS_CERT) && !defined(TLS_KEY)
+#error "TLS_CERT is set in secrets.h, but TLS_KEY is not"
+#endif
+
+namespace pcrb
+{
+
+altcp_tls_config* tls_server_config()
+{
+#ifdef TLS_CERT
+	static altcp_tls_config *config = nullptr;
+	if (config)
+		return config;
+
+	// mbedTLS parses PEM up to its terminating NUL, so it is included in the
+	// sizes
+	static constexpr const char cert[] = TLS_CERT;
+	static constexpr const char key[] = TLS_KEY;
+
+	// Allocates from the lwIP heap, which the lwIP thread also uses
+	cyw43_arch_lwip_begin();
+	config = altcp_tls_create_config_server_privkey_cert(
+		reinterpret_cast<const u8_t*>(key), sizeof(key), nullptr, 0,
+		reinterpret_cast<const u8_t*>(cert), sizeof(cert));
+	cyw43_arch_lwip_end();
+	if (!config)
+		sys_log.push<"tls: unable to create server configuration", log_level::warning>();
+	return config;
+#else
+	return nullptr;
+#endif
+}
+
+}
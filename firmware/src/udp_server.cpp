@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/udp_server.h>
+#include <pcrb/protocol.h>
+#include <pcrb/auth.h>
+#include <pcrb/commands.h>
+#include <pcrb/log.h>
+
+#include <pico/cyw43_arch.h>
+
+#include <lwip/udp.h>
+#include <lwip/pbuf.h>
+#include <lwip/err.h>
+
+#include <array>
+#include <cstring>
+#include <span>
+#include <utility>
+
+#include <errno.h>
+
+namespace pcrb
+{
+
+// Nonce, then the authentication envelope around magic, command, and
+// argument
+constexpr const size_t nonce_size = 4;
+constexpr const size_t max_datagram_size = nonce_size + auth_overhead + 12;
+
+udp_server::udp_server()
+:pcb_(nullptr)
+{}
+
+udp_server::~udp_server()
+{
+	close();
+}
+
+int udp_server::listen(uint16_t port)
+{
+	close();
+
+	cyw43_arch_lwip_begin();
+	udp_pcb *pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+	if (!pcb)
+	{
+		cyw43_arch_lwip_end();
+		return ENOMEM;
+	}
+
+	err_t err = udp_bind(pcb, IP_ANY_TYPE, port);
+	if (err != ERR_OK)
+	{
+		udp_remove(pcb);
+		cyw43_arch_lwip_end();
+		return err_to_errno(err);
+	}
+
+	udp_recv(pcb, receive, this);
+	pcb_ = pcb;
+	cyw43_arch_lwip_end();
+	return 0;
+}
+
+void udp_server::close()
+{
+	if (!pcb_)
+		return;
+	cyw43_arch_lwip_begin();
+	udp_remove(pcb_);
+	cyw43_arch_lwip_end();
+	pcb_ = nullptr;
+}
+
+void udp_server::receive(void*, udp_pcb *pcb, pbuf *p, const ip_addr_t *addr, u16_t port)
+{
+	std::array<std::byte, max_datagram_size> data;
+	size_t size = p->tot_len;
+	pbuf_copy_partial(p, data.data(), data.size(), 0);
+	pbuf_free(p);
+
+	// Without a nonce there is no way to send back a reply the client can use
+	if (size < nonce_size)
+	{
+		sys_log.push<"udp: dropping datagram with size {}", log_level::warning>(size);
+		return;
+	}
+
+	std::expected<request, response> decoded = std::unexpected(
+		response(response_status::bad_size, no_command, static_cast<uint32_t>(size - nonce_size)));
+	if (size <= data.size())
+	{
+		auto body = authenticate(std::span(data).first(size).subspan(nonce_size));
+		decoded = body ? decode_request(*body) : std::unexpected(body.error());
+	}
+
+	reply result = decoded ?
+		run_request(*decoded) :
+		reply{ decoded.error(), nullptr, 0 };
+	sys_log.push<"udp: reply to command {}: status {}, value {}">(
+		result.binary.command, std::to_underlying(result.binary.status), result.binary.value);
+
+	std::array<std::byte, nonce_size + response::max_size> buffer;
+	memcpy(buffer.data(), data.data(), nonce_size);
+	auto encoded = result.binary.encode(std::span(buffer).subspan<nonce_size>());
+	size_t reply_size = nonce_size + encoded.size();
+
+	pbuf *out = pbuf_alloc(PBUF_TRANSPORT, reply_size, PBUF_RAM);
+	if (!out)
+	{
+		sys_log.push<"udp: unable to allocate reply", log_level::warning>();
+		return;
+	}
+	pbuf_take(out, buffer.data(), reply_size);
+	udp_sendto(pcb, out, addr, port);
+	pbuf_free(out);
+}
+
+}
@@ -2,7 +2,7 @@
  * The MIT License (MIT)
  *
  * Copyright (c) 2019 Ha Thach (tinyusb.org),
- * Copyright (c) 2024 Gabriel Marcano (gabemarcano@yahoo.com)
+ * Copyright (c) 2024 - 2026 Gabriel Marcano (gabemarcano@yahoo.com)
  *
  * Permission is hereby granted, free of charge, to any person obtaining a copy
  * of this software and associated documentation files (the "Software"), to deal
@@ -24,6 +24,9 @@
  *
  */
 
+#include <pcrb/cli_task.h>
+#include <pcrb/cdc_output.h>
+
 #include <gpico/reset.h>
 
 #include <tusb.h>
@@ -509,6 +512,18 @@ int32_t tud_msc_scsi_cb(uint8_t lun, const uint8_t scsi_cmd[16], void *buffer, u
 	return resplen;
 }
 
+// The CLI task sleeps until there is something to read
+void tud_cdc_rx_cb(uint8_t)
+{
+	pcrb::cli_input_ready();
+}
+
+// Invoked when a packet of CDC data went out, making room for more
+void tud_cdc_tx_complete_cb(uint8_t)
+{
+	pcrb::cdc_output::transmitted();
+}
+
 constexpr unsigned PICO_STDIO_USB_RESET_MAGIC_BAUD_RATE = 1200;
 
 void tud_cdc_line_coding_cb(__unused uint8_t itf, cdc_line_coding_t const* p_line_coding) {
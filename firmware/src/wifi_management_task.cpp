@@ -1,15 +1,18 @@
 // SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
-// SPDX-FileCopyrightText: Gabriel Marcano, 2024
+// SPDX-FileCopyrightText: Gabriel Marcano, 2024 - 2026
 /// @file
 
 #include <pcrb/wifi_management_task.h>
+#include <pcrb/mqtt_task.h>
+#include <pcrb/log.h>
 // This secrets.h includes strings for WIFI_SSID and WIFI_PASSWORD
 #include "secrets.h"
 
-#include <gpico/log.h>
-
 #include <pico/cyw43_arch.h>
+#include <pico/time.h>
 #include <lwip/netdb.h>
+#include <lwip/netif.h>
+#include <lwip/dhcp6.h>
 
 #include <FreeRTOS.h>
 #include <queue.h>
@@ -17,58 +20,100 @@
 
 #include <cstdint>
 #include <atomic>
-#include <format>
-
-using gpico::sys_log;
 
 namespace pcrb
 {
 
 std::atomic_bool wifi_initd = false;
 
+// How long to wait for the network to be joined and usable.
+constexpr const uint32_t connect_timeout_ms = 10000;
+
+bool network_ready()
+{
+	netif *netif_ = netif_default;
+	if (!netif_ || !netif_is_link_up(netif_))
+		return false;
+	if (!ip4_addr_isany_val(*netif_ip4_addr(netif_)))
+		return true;
+	// Link-local addresses alone mean there is no router to reach anyone
+	// through
+	for (int i = 0; i < LWIP_IPV6_NUM_ADDRESSES; ++i)
+	{
+		if (ip6_addr_isvalid(netif_ip6_addr_state(netif_, i)) &&
+			!ip6_addr_islinklocal(netif_ip6_addr(netif_, i)))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Unlike cyw43_arch_wifi_connect_timeout_ms(), this does not insist on an
+// IPv4 address, as IPv6-only networks never hand one out
+static int connect_wifi()
+{
+	int result = cyw43_arch_wifi_connect_async(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK);
+	if (result)
+		return result;
+
+	absolute_time_t until = make_timeout_time_ms(connect_timeout_ms);
+	while (!time_reached(until))
+	{
+		int status = cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA);
+		// Negative statuses are failures to join
+		if (status < 0)
+			return status;
+		if (status == CYW43_LINK_JOIN && network_ready())
+			return 0;
+		vTaskDelay(pdMS_TO_TICKS(100));
+	}
+	return PICO_ERROR_TIMEOUT;
+}
+
 static void status_callback(netif *netif_)
 {
-	sys_log.push("status: changed");
-	sys_log.push(std::format("status: IP Address: {}", ip4addr_ntoa(netif_ip4_addr(netif_))));
-	sys_log.push(std::format("status: NETIF flags: {:#02x}", netif_->flags));
+	sys_log.push<"status: changed">();
+	sys_log.push<"status: IP Address: {}">(ip4addr_ntoa(netif_ip4_addr(netif_)));
+	sys_log.push<"status: NETIF flags: {:#02x}">(netif_->flags);
 	int32_t rssi = 0;
 	cyw43_wifi_get_rssi(&cyw43_state, &rssi);
-	sys_log.push(std::format("status: RSSI: {}", rssi));
-	sys_log.push(std::format("status: Wifi state: {}", cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA)));
+	sys_log.push<"status: RSSI: {}">(rssi);
+	sys_log.push<"status: Wifi state: {}">(cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA));
 }
 
 static void link_callback(netif *netif_)
 {
-	sys_log.push("link changed");
-	sys_log.push(std::format("link: IP Address: {}", ip4addr_ntoa(netif_ip4_addr(netif_))));
-	sys_log.push(std::format("link: NETIF flags: {:#02x}", netif_->flags));
+	sys_log.push<"link changed">();
+	sys_log.push<"link: IP Address: {}">(ip4addr_ntoa(netif_ip4_addr(netif_)));
+	sys_log.push<"link: NETIF flags: {:#02x}">(netif_->flags);
 	int32_t rssi = 0;
 	cyw43_wifi_get_rssi(&cyw43_state, &rssi);
-	sys_log.push(std::format("link: RSSI: {}", rssi));
-	sys_log.push(std::format("link: Wifi state: {}", cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA)));
+	sys_log.push<"link: RSSI: {}">(rssi);
+	sys_log.push<"link: Wifi state: {}">(cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA));
 }
 
 static void init_wifi()
 {
-	sys_log.push(std::format("Connecting to SSID {}:", WIFI_SSID));
+	sys_log.push<"Connecting to SSID {}:">(WIFI_SSID);
 	for (;;)
 	{
 		int result = 0;
-		if (!(result = cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 10000))) {
-			sys_log.push("    DONE");
+		if (!(result = connect_wifi())) {
+			sys_log.push<"    DONE">();
 			break;
 		}
-		sys_log.push(std::format("    FAILED: {}", result));
+		sys_log.push<"    FAILED: {}", log_level::warning>(result);
 
 		int32_t rssi = 0;
 		cyw43_wifi_get_rssi(&cyw43_state, &rssi);
-		sys_log.push(std::format("link: RSSI: {}", rssi));
+		sys_log.push<"link: RSSI: {}">(rssi);
 	}
 }
 
 void wifi_management_task(void*)
 {
-	sys_log.push("Initializing cyw43 with USA region...: ");
+	sys_log.push<"Initializing cyw43 with USA region...: ">();
 	for (;;)
 	{
 		// cyw43_arch_init _must_ be called within a FreeRTOS task, see
@@ -76,10 +121,10 @@ void wifi_management_task(void*)
 		int result = 0;
 		if (!(result = cyw43_arch_init_with_country(CYW43_COUNTRY_USA)))
 		{
-			sys_log.push("    DONE");
+			sys_log.push<"    DONE">();
 			break;
 		}
-		sys_log.push(std::format("    FAILED: {}", result));
+		sys_log.push<"    FAILED: {}", log_level::warning>(result);
 	}
 
 	cyw43_arch_enable_sta_mode();
@@ -90,6 +135,11 @@ void wifi_management_task(void*)
 	cyw43_arch_lwip_begin();
 	netif_set_status_callback(netif_default, status_callback);
 	netif_set_link_callback(netif_default, link_callback);
+	// IPv6: link-local address, SLAAC for global addresses, and stateless
+	// DHCPv6 for DNS servers
+	netif_create_ip6_linklocal_address(netif_default, 1);
+	netif_set_ip6_autoconfig_enabled(netif_default, 1);
+	dhcp6_enable_stateless(netif_default);
 	cyw43_arch_lwip_end();
 
 	init_wifi();
@@ -102,19 +152,20 @@ void wifi_management_task(void*)
 		int current_state = cyw43_wifi_link_status(&cyw43_state, CYW43_ITF_STA);
 		if (current_state != CYW43_LINK_JOIN || !(netif_default->flags & NETIF_FLAG_LINK_UP))
 		{
-			sys_log.push(std::format("wifi: state is bad? {}", current_state));
-			sys_log.push(std::format("wifi: or is it flags? {:#02x}", netif_default->flags));
+			sys_log.push<"wifi: state is bad? {}", log_level::warning>(current_state);
+			sys_log.push<"wifi: or is it flags? {:#02x}", log_level::warning>(netif_default->flags);
 			if (current_state != CYW43_LINK_DOWN)
 			{
-				sys_log.push(std::format("wifi: disconnecting from network"));
+				sys_log.push<"wifi: disconnecting from network">();
 				cyw43_wifi_leave(&cyw43_state, CYW43_ITF_STA);
 			}
 			int connect_result;
-			sys_log.push(std::format("wifi: trying to reconnect"));
-			while ((connect_result = cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 10000))) {
-				sys_log.push(std::format("FAILED to reconnect, result {}, trying again", connect_result));
+			sys_log.push<"wifi: trying to reconnect">();
+			while ((connect_result = connect_wifi())) {
+				sys_log.push<"FAILED to reconnect, result {}, trying again", log_level::warning>(connect_result);
 			}
-			sys_log.push(std::format("wifi: hopefully succeeded in connecting"));
+			sys_log.push<"wifi: hopefully succeeded in connecting">();
+			mqtt_reconnect();
 			if (current_state != wifi_state)
 				wifi_state = current_state;
 		}
@@ -0,0 +1,223 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/wol_server.h>
+#include <pcrb/auth.h>
+#include <pcrb/commands.h>
+#include <pcrb/protocol.h>
+#include <pcrb/monitor_task.h>
+#include <pcrb/log.h>
+// This secrets.h includes strings for WIFI_SSID and WIFI_PASSWORD, and
+// optionally WOL_MAC and WOL_PULSE_MS
+#include "secrets.h"
+
+#include <pico/cyw43_arch.h>
+
+#include <lwip/udp.h>
+#include <lwip/pbuf.h>
+#include <lwip/err.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+
+#include <errno.h>
+
+#ifndef WOL_PULSE_MS
+#define WOL_PULSE_MS 500
+#endif
+
+namespace pcrb
+{
+
+// Matching packets this soon after one that pressed the button are repeats
+constexpr const TickType_t burst_holdoff = pdMS_TO_TICKS(5000);
+
+using mac_address = std::array<uint8_t, 6>;
+
+static consteval mac_address parse_mac(std::string_view text)
+{
+	auto nibble = [](char c) -> uint8_t
+	{
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		throw "invalid hex digit in WOL_MAC";
+	};
+
+	if (text.size() != 17)
+		throw "WOL_MAC must look like 01:23:45:67:89:ab";
+	mac_address result{};
+	for (std::size_t i = 0; i < result.size(); ++i)
+	{
+		if (i && text[i * 3 - 1] != ':' && text[i * 3 - 1] != '-')
+			throw "WOL_MAC bytes must be separated by : or -";
+		result[i] = nibble(text[i * 3]) << 4 | nibble(text[i * 3 + 1]);
+	}
+	return result;
+}
+
+/** Finds a magic packet in a stream of bytes, one byte at a time.
+ *
+ * If the MAC itself contains 0xFF bytes, a magic packet starting inside a
+ * failed partial match can be missed, which is harmless as senders repeat
+ * them anyway.
+ */
+class magic_matcher
+{
+public:
+	static constexpr std::size_t sync_size = 6;
+	static constexpr std::size_t repeats = 16;
+	static constexpr std::size_t size = sync_size + repeats * 6;
+
+	constexpr explicit magic_matcher(const mac_address& mac)
+	:mac_(mac), matched_(0)
+	{}
+
+	/** Matches the next byte.
+	 *
+	 * @param[in] byte Next byte of the datagram.
+	 *
+	 * @returns True once a whole magic packet has been matched.
+	 */
+	constexpr bool feed(uint8_t byte)
+	{
+		if (byte == expected())
+		{
+			++matched_;
+		}
+		// Longer runs of 0xFF still end in a valid sync stream
+		else if (!(matched_ == sync_size && byte == 0xFF))
+		{
+			matched_ = byte == 0xFF ? 1 : 0;
+		}
+		return matched_ == size;
+	}
+
+private:
+	constexpr uint8_t expected() const
+	{
+		if (matched_ < sync_size)
+			return 0xFF;
+		return mac_[(matched_ - sync_size) % mac_.size()];
+	}
+
+	const mac_address& mac_;
+	std::size_t matched_;
+};
+
+#ifdef WOL_MAC
+static constexpr mac_address target_mac = parse_mac(WOL_MAC);
+#endif
+
+// Only ever touched from the lwIP thread
+static TickType_t last_press;
+static bool pressed = false;
+
+wol_server::wol_server()
+:pcb_(nullptr)
+{}
+
+wol_server::~wol_server()
+{
+	close();
+}
+
+int wol_server::listen(uint16_t port)
+{
+	close();
+
+#ifndef WOL_MAC
+	sys_log.push<"wol: WOL_MAC is not set, not listening", log_level::warning>();
+	return 0;
+#else
+	// Magic packets can't be authenticated, so anyone on the LAN could
+	// turn the PC on
+	if (authentication_required())
+	{
+		sys_log.push<"wol: AUTH_KEY is set, not listening", log_level::warning>();
+		return 0;
+	}
+
+	cyw43_arch_lwip_begin();
+	udp_pcb *pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+	if (!pcb)
+	{
+		cyw43_arch_lwip_end();
+		return ENOMEM;
+	}
+
+	err_t err = udp_bind(pcb, IP_ANY_TYPE, port);
+	if (err != ERR_OK)
+	{
+		udp_remove(pcb);
+		cyw43_arch_lwip_end();
+		return err_to_errno(err);
+	}
+
+	udp_recv(pcb, receive, this);
+	pcb_ = pcb;
+	cyw43_arch_lwip_end();
+	return 0;
+#endif
+}
+
+void wol_server::close()
+{
+	if (!pcb_)
+		return;
+	cyw43_arch_lwip_begin();
+	udp_remove(pcb_);
+	cyw43_arch_lwip_end();
+	pcb_ = nullptr;
+}
+
+void wol_server::receive(void*, udp_pcb*, pbuf *p, const ip_addr_t*, u16_t)
+{
+#ifdef WOL_MAC
+	bool found = false;
+	if (p->tot_len >= magic_matcher::size)
+	{
+		magic_matcher matcher(target_mac);
+		for (pbuf *q = p; q && !found; q = q->next)
+		{
+			const uint8_t *data = static_cast<const uint8_t*>(q->payload);
+			for (u16_t i = 0; i < q->len && !found; ++i)
+				found = matcher.feed(data[i]);
+		}
+	}
+	pbuf_free(p);
+	if (!found)
+		return;
+
+	TickType_t now = xTaskGetTickCount();
+	if (pressed && (now - last_press) < burst_holdoff)
+		return;
+	// A repeat arriving right after the PC turned on must not turn it off
+	pressed = true;
+	last_press = now;
+
+	if (current_pc_state())
+	{
+		sys_log.push<"wol: magic packet received, PC is already on">();
+		return;
+	}
+
+	const command *toggle = find_command(opcode::toggle);
+	response result = try_execute(*toggle, WOL_PULSE_MS);
+	sys_log.push<"wol: toggle {}: status {}, value {}">(
+		WOL_PULSE_MS, std::to_underlying(result.status), result.value);
+#else
+	pbuf_free(p);
+#endif
+}
+
+}
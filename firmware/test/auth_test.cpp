@@ -0,0 +1,225 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+/// SHA-256 and HMAC-SHA256 against the FIPS 180-4 and RFC 4231 test
+/// vectors, the replay window, and comparing tags.
+
+#include <pcrb/auth.h>
+#include <pcrb/sha256.h>
+
+#include <gtest/gtest.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace
+{
+
+using pcrb::hmac_sha256;
+using pcrb::replay_window;
+using pcrb::sha256;
+
+std::span<const std::byte> bytes(std::string_view text)
+{
+	return std::as_bytes(std::span(text));
+}
+
+// Digest as lowercase hex, so it compares against the vectors as printed
+std::string hex(const sha256::digest& digest)
+{
+	constexpr std::string_view digits = "0123456789abcdef";
+	std::string result;
+	for (std::byte byte: digest)
+	{
+		result += digits[std::to_integer<unsigned>(byte) >> 4];
+		result += digits[std::to_integer<unsigned>(byte) & 0xF];
+	}
+	return result;
+}
+
+std::string hash(std::string_view message)
+{
+	sha256 hasher;
+	hasher.update(bytes(message));
+	return hex(hasher.finish());
+}
+
+std::string sign(std::string_view key, std::string_view message)
+{
+	return hex(hmac_sha256(key).sign(bytes(message)));
+}
+
+// Usable at compile time, as auth.cpp relies on for the key
+constexpr sha256::digest abc_digest = [] {
+	sha256 hasher;
+	std::byte message[] = { std::byte('a'), std::byte('b'), std::byte('c') };
+	hasher.update(message);
+	return hasher.finish();
+}();
+static_assert(abc_digest[0] == std::byte(0xba) && abc_digest[31] == std::byte(0xad));
+
+TEST(sha256, fips_180_4_vectors)
+{
+	EXPECT_EQ(hash("abc"), "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+	EXPECT_EQ(hash(""), "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+	EXPECT_EQ(hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+		"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+	EXPECT_EQ(hash(std::string(1000000, 'a')),
+		"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+TEST(sha256, padding_spills_into_another_block)
+{
+	// The length still fits after 55 bytes, not after 56, and 64 is a
+	// whole block of message
+	EXPECT_EQ(hash(std::string(55, 'a')), "9f4390f8d30c2dd92ec9f095b65e2b9ae9b0a925a5258e241c9f1e910f734318");
+	EXPECT_EQ(hash(std::string(56, 'a')), "b35439a4ac6f0948b6d6f9e3c6af0f5f590ce20f1bde7090ef7970686ec6738a");
+	EXPECT_EQ(hash(std::string(64, 'a')), "ffe054fe7ae0cb6dc65c3af9b61d5209f439851db43d0ba5997337df154668eb");
+}
+
+TEST(sha256, update_in_pieces)
+{
+	std::string message(200, 'x');
+	for (std::size_t i = 0; i < message.size(); ++i)
+		message[i] = static_cast<char>(i * 7);
+
+	sha256 hasher;
+	std::string_view rest = message;
+	for (std::size_t piece: {1, 62, 3, 64, 70})
+	{
+		hasher.update(bytes(rest.substr(0, piece)));
+		rest.remove_prefix(piece);
+	}
+	EXPECT_EQ(hex(hasher.finish()), hash(message));
+}
+
+TEST(hmac_sha256, rfc_4231_vectors)
+{
+	// Test cases 1 to 4, and 6 and 7, whose keys are longer than a block
+	// and so are hashed first. Case 5 only differs in truncating the tag.
+	EXPECT_EQ(sign(std::string(20, '\x0b'), "Hi There"),
+		"b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7");
+	EXPECT_EQ(sign("Jefe", "what do ya want for nothing?"),
+		"5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843");
+	EXPECT_EQ(sign(std::string(20, '\xaa'), std::string(50, '\xdd')),
+		"773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe");
+	std::string counting;
+	for (char c = 1; c <= 25; ++c)
+		counting += c;
+	EXPECT_EQ(sign(counting, std::string(50, '\xcd')),
+		"82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b");
+	EXPECT_EQ(sign(std::string(131, '\xaa'), "Test Using Larger Than Block-Size Key - Hash Key First"),
+		"60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+	EXPECT_EQ(sign(std::string(131, '\xaa'),
+			"This is a test using a larger than block-size key and a larger than block-size data. "
+			"The key needs to be hashed before being used by the HMAC algorithm."),
+		"9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2");
+}
+
+TEST(hmac_sha256, key_of_exactly_a_block_is_not_hashed)
+{
+	EXPECT_EQ(sign(std::string(64, '\xaa'), "Key of exactly one block"),
+		"41736a52bae029e8f8feee9738818dbbbefd5bbae4738e179320b36330d2cc5f");
+}
+
+TEST(hmac_sha256, tag_mismatch)
+{
+	hmac_sha256 key("secret");
+	std::string message = "toggle 500";
+	sha256::digest tag = key.sign(bytes(message));
+	EXPECT_TRUE(pcrb::constant_time_equal(tag, key.sign(bytes(message))));
+
+	// Tampered with, in the message or in the tag
+	std::string tampered = message;
+	tampered.back() ^= 1;
+	EXPECT_FALSE(pcrb::constant_time_equal(tag, key.sign(bytes(tampered))));
+	sha256::digest bad_tag = tag;
+	bad_tag[31] ^= std::byte(0x80);
+	EXPECT_FALSE(pcrb::constant_time_equal(bad_tag, key.sign(bytes(message))));
+
+	// Signed with another key
+	EXPECT_FALSE(pcrb::constant_time_equal(tag, hmac_sha256("Secret").sign(bytes(message))));
+}
+
+TEST(constant_time_equal, compares_size_and_contents)
+{
+	EXPECT_TRUE(pcrb::constant_time_equal(bytes("abcd"), bytes("abcd")));
+	EXPECT_TRUE(pcrb::constant_time_equal(bytes(""), bytes("")));
+	EXPECT_FALSE(pcrb::constant_time_equal(bytes("abcd"), bytes("abce")));
+	EXPECT_FALSE(pcrb::constant_time_equal(bytes("abcd"), bytes("xbcd")));
+	// A prefix is not a match
+	EXPECT_FALSE(pcrb::constant_time_equal(bytes("abc"), bytes("abcd")));
+}
+
+TEST(replay_window, rejects_duplicates)
+{
+	replay_window window;
+	EXPECT_TRUE(window.accept(10));
+	EXPECT_FALSE(window.accept(10));
+	EXPECT_TRUE(window.accept(11));
+	EXPECT_FALSE(window.accept(11));
+	EXPECT_FALSE(window.accept(10));
+}
+
+TEST(replay_window, accepts_out_of_order_inside_window)
+{
+	replay_window window;
+	EXPECT_TRUE(window.accept(100));
+	EXPECT_TRUE(window.accept(95));
+	EXPECT_TRUE(window.accept(99));
+	EXPECT_TRUE(window.accept(100 - replay_window::window_size + 1));
+	// But each only once
+	EXPECT_FALSE(window.accept(95));
+	EXPECT_FALSE(window.accept(99));
+	EXPECT_TRUE(window.accept(98));
+}
+
+TEST(replay_window, rejects_too_old)
+{
+	replay_window window;
+	EXPECT_TRUE(window.accept(1000));
+	// Never seen, but too far behind to tell
+	EXPECT_FALSE(window.accept(1000 - replay_window::window_size));
+	EXPECT_FALSE(window.accept(1));
+}
+
+TEST(replay_window, first_counter_may_be_zero)
+{
+	replay_window window;
+	EXPECT_TRUE(window.accept(0));
+	EXPECT_FALSE(window.accept(0));
+	EXPECT_TRUE(window.accept(1));
+}
+
+TEST(replay_window, jump_beyond_window_forgets_what_was_seen)
+{
+	replay_window window;
+	EXPECT_TRUE(window.accept(10));
+	EXPECT_TRUE(window.accept(8));
+	uint64_t far = 10 + replay_window::window_size + 5;
+	EXPECT_TRUE(window.accept(far));
+	// Everything before the jump is now too old
+	EXPECT_FALSE(window.accept(10));
+	EXPECT_FALSE(window.accept(far - replay_window::window_size));
+	// And nothing inside the new window was seen yet but the jump itself
+	EXPECT_TRUE(window.accept(far - 1));
+	EXPECT_TRUE(window.accept(far - replay_window::window_size + 1));
+	EXPECT_FALSE(window.accept(far));
+}
+
+TEST(replay_window, shifts_what_was_seen_along)
+{
+	replay_window window;
+	EXPECT_TRUE(window.accept(50));
+	EXPECT_TRUE(window.accept(48));
+	// Moving up less than the window keeps track of both
+	EXPECT_TRUE(window.accept(60));
+	EXPECT_FALSE(window.accept(50));
+	EXPECT_FALSE(window.accept(48));
+	EXPECT_TRUE(window.accept(49));
+}
+
+}
@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb_host/fake.h>
+
+#include <pico/time.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+TickType_t xTaskGetTickCount()
+{
+	return time_us_64() / 1000;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	pcrb::host::advance_time_us(static_cast<uint64_t>(ticks) * 1000);
+}
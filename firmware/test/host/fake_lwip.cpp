@@ -0,0 +1,333 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb_host/lwip.h>
+#include <pcrb_host/fake.h>
+
+#include <pico/time.h>
+
+#include <lwip/altcp.h>
+#include <lwip/err.h>
+#include <lwip/pbuf.h>
+#include <lwip/tcp.h>
+#include <lwip/tcpip.h>
+#include <lwip/timeouts.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <new>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <errno.h>
+
+namespace
+{
+
+struct timeout
+{
+	uint64_t due_ms;
+	sys_timeout_handler handler;
+	void *arg;
+};
+
+struct callback
+{
+	tcpip_callback_fn function;
+	void *ctx;
+};
+
+std::vector<timeout> timeouts;
+std::deque<callback> callbacks;
+std::deque<std::unique_ptr<altcp_pcb>> connections;
+std::size_t pbufs = 0;
+
+uint64_t now_ms()
+{
+	return time_us_64() / 1000;
+}
+
+pbuf* pbuf_new(std::span<const std::byte> data)
+{
+	// Payload right after the pbuf, as with PBUF_RAM
+	void *block = std::malloc(sizeof(pbuf) + data.size());
+	pbuf *p = new (block) pbuf{};
+	p->payload = p + 1;
+	std::memcpy(p->payload, data.data(), data.size());
+	p->tot_len = data.size();
+	p->len = data.size();
+	p->ref = 1;
+	++pbufs;
+	return p;
+}
+
+void run_callbacks()
+{
+	while (!callbacks.empty())
+	{
+		callback next = callbacks.front();
+		callbacks.pop_front();
+		next.function(next.ctx);
+	}
+}
+
+}
+
+namespace pcrb::host
+{
+
+altcp_pcb* new_connection()
+{
+	connections.push_back(std::make_unique<altcp_pcb>());
+	return connections.back().get();
+}
+
+err_t receive(altcp_pcb *conn, std::span<const std::byte> data)
+{
+	return conn->recv(conn->arg, conn, pbuf_new(data), ERR_OK);
+}
+
+err_t receive(altcp_pcb *conn, std::string_view data)
+{
+	return receive(conn, std::as_bytes(std::span(data)));
+}
+
+err_t receive_fin(altcp_pcb *conn)
+{
+	return conn->recv(conn->arg, conn, nullptr, ERR_OK);
+}
+
+err_t acknowledge(altcp_pcb *conn)
+{
+	u16_t amount = std::exchange(conn->unacked, 0);
+	if (!conn->sent)
+		return ERR_OK;
+	return conn->sent(conn->arg, conn, amount);
+}
+
+void reset(altcp_pcb *conn)
+{
+	conn->closed = true;
+	if (conn->err)
+		conn->err(conn->arg, ERR_RST);
+}
+
+void run_for(uint64_t ms)
+{
+	uint64_t end = now_ms() + ms;
+	for (;;)
+	{
+		run_callbacks();
+		auto next = std::ranges::min_element(timeouts, {}, &timeout::due_ms);
+		if (next == timeouts.end() || next->due_ms > end)
+			break;
+		timeout due = *next;
+		timeouts.erase(next);
+		set_time_us(std::max(now_ms(), due.due_ms) * 1000);
+		due.handler(due.arg);
+	}
+	set_time_us(end * 1000);
+}
+
+std::size_t live_pbufs()
+{
+	return pbufs;
+}
+
+}
+
+int err_to_errno(err_t err)
+{
+	switch (err)
+	{
+		case ERR_OK:
+			return 0;
+		case ERR_MEM:
+			return ENOMEM;
+		case ERR_TIMEOUT:
+			return ETIMEDOUT;
+		case ERR_CONN:
+		case ERR_CLSD:
+			return ENOTCONN;
+		case ERR_ABRT:
+			return ECONNABORTED;
+		case ERR_RST:
+			return ECONNRESET;
+		default:
+			return EIO;
+	}
+}
+
+u8_t pbuf_free(pbuf *p)
+{
+	u8_t count = 0;
+	while (p && --p->ref == 0)
+	{
+		pbuf *next = p->next;
+		std::free(p);
+		--pbufs;
+		++count;
+		p = next;
+	}
+	return count;
+}
+
+void pbuf_cat(pbuf *head, pbuf *tail)
+{
+	pbuf *p = head;
+	for (; p->next; p = p->next)
+		p->tot_len += tail->tot_len;
+	p->tot_len += tail->tot_len;
+	p->next = tail;
+}
+
+u8_t pbuf_get_at(const pbuf *p, u16_t offset)
+{
+	for (; p && offset >= p->len; p = p->next)
+		offset -= p->len;
+	return p ? static_cast<const u8_t*>(p->payload)[offset] : 0;
+}
+
+pbuf* pbuf_free_header(pbuf *q, u16_t size)
+{
+	// Whole pbufs are freed, what is left of the last one is moved past
+	while (q && size >= q->len)
+	{
+		size -= q->len;
+		pbuf *next = q->next;
+		q->next = nullptr;
+		pbuf_free(q);
+		q = next;
+	}
+	if (q && size)
+	{
+		q->payload = static_cast<std::byte*>(q->payload) + size;
+		q->len -= size;
+		q->tot_len -= size;
+	}
+	return q;
+}
+
+void* pbuf_get_contiguous(const pbuf *p, void *buffer, std::size_t bufsize, u16_t len, u16_t offset)
+{
+	for (; p && offset >= p->len; p = p->next)
+		offset -= p->len;
+	if (!p || p->tot_len < offset + len)
+		return nullptr;
+	if (offset + len <= p->len)
+		return static_cast<std::byte*>(p->payload) + offset;
+	if (bufsize < len)
+		return nullptr;
+
+	std::byte *out = static_cast<std::byte*>(buffer);
+	for (std::size_t copied = 0; copied < len; p = p->next, offset = 0)
+	{
+		std::size_t amount = std::min<std::size_t>(p->len - offset, len - copied);
+		std::memcpy(out + copied, static_cast<const std::byte*>(p->payload) + offset, amount);
+		copied += amount;
+	}
+	return buffer;
+}
+
+void altcp_arg(altcp_pcb *conn, void *arg)
+{
+	conn->arg = arg;
+}
+
+void altcp_recv(altcp_pcb *conn, altcp_recv_fn recv)
+{
+	conn->recv = recv;
+}
+
+void altcp_sent(altcp_pcb *conn, altcp_sent_fn sent)
+{
+	conn->sent = sent;
+}
+
+void altcp_err(altcp_pcb *conn, altcp_err_fn err)
+{
+	conn->err = err;
+}
+
+void altcp_recved(altcp_pcb *conn, u16_t len)
+{
+	conn->recved += len;
+}
+
+err_t altcp_write(altcp_pcb *conn, const void *dataptr, u16_t len, u8_t)
+{
+	if (conn->closed)
+		return ERR_CLSD;
+	if (len > altcp_sndbuf(conn))
+		return ERR_MEM;
+	const std::byte *data = static_cast<const std::byte*>(dataptr);
+	conn->written.insert(conn->written.end(), data, data + len);
+	conn->unacked += len;
+	return ERR_OK;
+}
+
+err_t altcp_output(altcp_pcb*)
+{
+	return ERR_OK;
+}
+
+u16_t altcp_mss(altcp_pcb*)
+{
+	return 1460;
+}
+
+u16_t altcp_sndbuf(altcp_pcb *conn)
+{
+	return conn->send_buffer - std::min(conn->unacked, conn->send_buffer);
+}
+
+u16_t altcp_sndqueuelen(altcp_pcb*)
+{
+	return 0;
+}
+
+void altcp_nagle_disable(altcp_pcb *conn)
+{
+	conn->nagle = false;
+}
+
+void altcp_keepalive_enable(altcp_pcb *conn, u32_t, u32_t, u32_t)
+{
+	conn->keepalive = true;
+}
+
+err_t altcp_close(altcp_pcb *conn)
+{
+	conn->closed = true;
+	return ERR_OK;
+}
+
+void altcp_abort(altcp_pcb *conn)
+{
+	conn->closed = true;
+	conn->aborted = true;
+}
+
+void sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg)
+{
+	timeouts.push_back({ now_ms() + msecs, handler, arg });
+}
+
+err_t tcpip_callback(tcpip_callback_fn function, void *ctx)
+{
+	callbacks.push_back({ function, ctx });
+	return ERR_OK;
+}
+
+err_t tcpip_try_callback(tcpip_callback_fn function, void *ctx)
+{
+	return tcpip_callback(function, ctx);
+}
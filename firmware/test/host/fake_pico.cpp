@@ -0,0 +1,85 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb_host/fake.h>
+
+#include <pico/mutex.h>
+#include <pico/platform.h>
+#include <pico/time.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+static std::atomic<uint64_t> fake_now_us = 0;
+static std::atomic_bool real_clock = false;
+static thread_local uint32_t current_core = 0;
+
+namespace pcrb::host
+{
+
+void set_time_us(uint64_t now_us)
+{
+	fake_now_us = now_us;
+}
+
+void advance_time_us(uint64_t amount_us)
+{
+	fake_now_us += amount_us;
+}
+
+void use_real_clock(bool real)
+{
+	real_clock = real;
+}
+
+void set_core(uint32_t core)
+{
+	current_core = core;
+}
+
+}
+
+uint64_t time_us_64()
+{
+	if (real_clock)
+	{
+		auto now = std::chrono::steady_clock::now().time_since_epoch();
+		return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+	}
+	return fake_now_us;
+}
+
+uint32_t get_core_num()
+{
+	return current_core;
+}
+
+void mutex_init(mutex_t*)
+{}
+
+void mutex_enter_blocking(mutex_t *mtx)
+{
+	mtx->lock.lock();
+}
+
+void mutex_exit(mutex_t *mtx)
+{
+	mtx->lock.unlock();
+}
+
+void recursive_mutex_enter_blocking(recursive_mutex_t *mtx)
+{
+	mtx->lock.lock();
+}
+
+bool recursive_mutex_enter_timeout_ms(recursive_mutex_t *mtx, uint32_t timeout_ms)
+{
+	return mtx->lock.try_lock_for(std::chrono::milliseconds(timeout_ms));
+}
+
+void recursive_mutex_exit(recursive_mutex_t *mtx)
+{
+	mtx->lock.unlock();
+}
@@ -0,0 +1,38 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+/// Host stand-in for the flash the persistent log lives in, kept in RAM.
+
+#include <pcrb/flash_log_storage.h>
+#include <pcrb/log_storage.h>
+
+#include <cstddef>
+#include <span>
+
+namespace pcrb
+{
+
+static_assert(persistent_log_storage<flash_log_storage>);
+
+static ram_log_storage<flash_log_storage::sector_size, flash_log_storage::max_sectors> flash;
+
+flash_log_storage::flash_log_storage()
+:offset_(0), sectors_(max_sectors)
+{}
+
+std::size_t flash_log_storage::sectors() const
+{
+	return sectors_;
+}
+
+void flash_log_storage::read(std::size_t sector, std::size_t offset, std::span<std::byte> output) const
+{
+	flash.read(sector, offset, output);
+}
+
+bool flash_log_storage::write(std::size_t sector, std::span<const std::byte> data)
+{
+	return flash.write(sector, data);
+}
+
+}
@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+/// Host fake of the parts of FreeRTOS the tested code uses.
+
+#ifndef PCRB_HOST_FREERTOS_H_
+#define PCRB_HOST_FREERTOS_H_
+
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef void* TaskHandle_t;
+typedef void* QueueHandle_t;
+
+/// Ticks are milliseconds
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFFu
+
+#endif//PCRB_HOST_FREERTOS_H_
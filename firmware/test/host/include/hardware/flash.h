@@ -0,0 +1,10 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_HARDWARE_FLASH_H_
+#define PCRB_HOST_HARDWARE_FLASH_H_
+
+#define FLASH_SECTOR_SIZE (1u << 12)
+
+#endif//PCRB_HOST_HARDWARE_FLASH_H_
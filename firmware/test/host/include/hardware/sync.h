@@ -0,0 +1,19 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_HARDWARE_SYNC_H_
+#define PCRB_HOST_HARDWARE_SYNC_H_
+
+#include <cstdint>
+
+/// Nothing to mask, each fake core is a thread of its own
+inline uint32_t save_and_disable_interrupts()
+{
+	return 0;
+}
+
+inline void restore_interrupts(uint32_t)
+{}
+
+#endif//PCRB_HOST_HARDWARE_SYNC_H_
@@ -0,0 +1,34 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_LWIP_ALTCP_H_
+#define PCRB_HOST_LWIP_ALTCP_H_
+
+#include <lwip/arch.h>
+#include <lwip/err.h>
+#include <lwip/pbuf.h>
+
+/// Defined in pcrb_host/lwip.h, for tests to look into
+struct altcp_pcb;
+
+typedef err_t (*altcp_recv_fn)(void *arg, altcp_pcb *conn, pbuf *p, err_t err);
+typedef err_t (*altcp_sent_fn)(void *arg, altcp_pcb *conn, u16_t len);
+typedef void (*altcp_err_fn)(void *arg, err_t err);
+
+void altcp_arg(altcp_pcb *conn, void *arg);
+void altcp_recv(altcp_pcb *conn, altcp_recv_fn recv);
+void altcp_sent(altcp_pcb *conn, altcp_sent_fn sent);
+void altcp_err(altcp_pcb *conn, altcp_err_fn err);
+void altcp_recved(altcp_pcb *conn, u16_t len);
+err_t altcp_write(altcp_pcb *conn, const void *dataptr, u16_t len, u8_t apiflags);
+err_t altcp_output(altcp_pcb *conn);
+u16_t altcp_mss(altcp_pcb *conn);
+u16_t altcp_sndbuf(altcp_pcb *conn);
+u16_t altcp_sndqueuelen(altcp_pcb *conn);
+void altcp_nagle_disable(altcp_pcb *conn);
+void altcp_keepalive_enable(altcp_pcb *conn, u32_t idle, u32_t intvl, u32_t count);
+err_t altcp_close(altcp_pcb *conn);
+void altcp_abort(altcp_pcb *conn);
+
+#endif//PCRB_HOST_LWIP_ALTCP_H_
@@ -0,0 +1,12 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_LWIP_ALTCP_TLS_H_
+#define PCRB_HOST_LWIP_ALTCP_TLS_H_
+
+#include <lwip/altcp.h>
+
+struct altcp_tls_config;
+
+#endif//PCRB_HOST_LWIP_ALTCP_TLS_H_
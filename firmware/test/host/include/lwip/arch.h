@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+/// Host fake of the parts of lwIP the tested code uses, see pcrb_host/lwip.h.
+
+#ifndef PCRB_HOST_LWIP_ARCH_H_
+#define PCRB_HOST_LWIP_ARCH_H_
+
+#include <cstdint>
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t s8_t;
+
+#endif//PCRB_HOST_LWIP_ARCH_H_
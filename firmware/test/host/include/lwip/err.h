@@ -0,0 +1,27 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_LWIP_ERR_H_
+#define PCRB_HOST_LWIP_ERR_H_
+
+#include <lwip/arch.h>
+
+typedef s8_t err_t;
+
+enum
+{
+	ERR_OK = 0,
+	ERR_MEM = -1,
+	ERR_BUF = -2,
+	ERR_TIMEOUT = -3,
+	ERR_VAL = -6,
+	ERR_CONN = -11,
+	ERR_ABRT = -13,
+	ERR_RST = -14,
+	ERR_CLSD = -15,
+};
+
+int err_to_errno(err_t err);
+
+#endif//PCRB_HOST_LWIP_ERR_H_
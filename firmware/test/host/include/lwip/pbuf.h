@@ -0,0 +1,29 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_LWIP_PBUF_H_
+#define PCRB_HOST_LWIP_PBUF_H_
+
+#include <lwip/arch.h>
+#include <lwip/err.h>
+
+#include <cstddef>
+
+/// Only the fields the tested code looks at, and a reference count
+struct pbuf
+{
+	pbuf *next;
+	void *payload;
+	u16_t tot_len;
+	u16_t len;
+	u16_t ref;
+};
+
+u8_t pbuf_free(pbuf *p);
+void pbuf_cat(pbuf *head, pbuf *tail);
+u8_t pbuf_get_at(const pbuf *p, u16_t offset);
+pbuf* pbuf_free_header(pbuf *q, u16_t size);
+void* pbuf_get_contiguous(const pbuf *p, void *buffer, std::size_t bufsize, u16_t len, u16_t offset);
+
+#endif//PCRB_HOST_LWIP_PBUF_H_
@@ -0,0 +1,20 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_LWIP_TCP_H_
+#define PCRB_HOST_LWIP_TCP_H_
+
+#include <lwip/arch.h>
+#include <lwip/err.h>
+#include <lwip/pbuf.h>
+
+/// Same as the firmware's lwipopts.h
+#define TCP_SND_QUEUELEN 32
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+struct tcp_pcb;
+
+#endif//PCRB_HOST_LWIP_TCP_H_
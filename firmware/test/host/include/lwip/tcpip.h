@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_LWIP_TCPIP_H_
+#define PCRB_HOST_LWIP_TCPIP_H_
+
+#include <lwip/err.h>
+
+typedef void (*tcpip_callback_fn)(void *ctx);
+
+/// Both run from pcrb::host::run_for()
+err_t tcpip_callback(tcpip_callback_fn function, void *ctx);
+err_t tcpip_try_callback(tcpip_callback_fn function, void *ctx);
+
+#endif//PCRB_HOST_LWIP_TCPIP_H_
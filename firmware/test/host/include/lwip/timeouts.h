@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_LWIP_TIMEOUTS_H_
+#define PCRB_HOST_LWIP_TIMEOUTS_H_
+
+#include <lwip/arch.h>
+
+typedef void (*sys_timeout_handler)(void *arg);
+
+/// Runs from pcrb::host::run_for(), on the fake clock
+void sys_timeout(u32_t msecs, sys_timeout_handler handler, void *arg);
+
+#endif//PCRB_HOST_LWIP_TIMEOUTS_H_
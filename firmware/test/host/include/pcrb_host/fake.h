@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_FAKE_H_
+#define PCRB_HOST_FAKE_H_
+
+#include <cstdint>
+
+/** Controls for the fakes the host tests run the firmware against.
+ */
+namespace pcrb::host
+{
+
+/** Sets the time returned by time_us_64().
+ *
+ * The clock only moves when told to, unless use_real_clock() is set.
+ *
+ * @param[in] now_us Time since boot, in microseconds.
+ */
+void set_time_us(uint64_t now_us);
+
+/** Moves the time returned by time_us_64() forward.
+ *
+ * @param[in] amount_us Microseconds to move forward by.
+ */
+void advance_time_us(uint64_t amount_us);
+
+/** Makes time_us_64() follow the host's monotonic clock instead, for
+ * measuring.
+ *
+ * @param[in] real True to follow the host clock.
+ */
+void use_real_clock(bool real);
+
+/** Sets the core get_core_num() reports for the calling thread.
+ *
+ * Each thread is core 0 until set otherwise. Two threads must not claim
+ * the same core while logging, as each core's ring has a single producer.
+ *
+ * @param[in] core Core number, 0 or 1.
+ */
+void set_core(uint32_t core);
+
+}
+
+#endif//PCRB_HOST_FAKE_H_
@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_LWIP_H_
+#define PCRB_HOST_LWIP_H_
+
+#include <lwip/altcp.h>
+#include <lwip/pbuf.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/** A fake connection, standing in for lwIP's TCP PCB.
+ *
+ * Everything written is kept, and the send buffer only frees up when the
+ * test acknowledges it, see pcrb::host::acknowledge().
+ */
+struct altcp_pcb
+{
+	void *arg = nullptr;
+	altcp_recv_fn recv = nullptr;
+	altcp_sent_fn sent = nullptr;
+	altcp_err_fn err = nullptr;
+
+	/// Everything written, acknowledged or not
+	std::vector<std::byte> written;
+	/// Bytes written but not yet acknowledged
+	std::size_t unacked = 0;
+	std::size_t send_buffer = 8 * 1024;
+	/// Bytes the receiver said it was done with
+	std::size_t recved = 0;
+	bool nagle = true;
+	bool keepalive = false;
+	bool closed = false;
+	bool aborted = false;
+};
+
+/** Controls for the fake lwIP.
+ */
+namespace pcrb::host
+{
+
+/** Makes a new connection, for request_handler::start().
+ *
+ * The connection lives until the end of the test program, so it can still
+ * be looked at once closed.
+ */
+altcp_pcb* new_connection();
+
+/** Delivers data to a connection, as a single pbuf.
+ *
+ * @returns What the receive callback returned.
+ */
+err_t receive(altcp_pcb *conn, std::span<const std::byte> data);
+err_t receive(altcp_pcb *conn, std::string_view data);
+
+/** Delivers the client closing its side of a connection.
+ */
+err_t receive_fin(altcp_pcb *conn);
+
+/** Acknowledges everything written to a connection, freeing its send
+ * buffer, and calls its sent callback.
+ */
+err_t acknowledge(altcp_pcb *conn);
+
+/** Resets a connection, as lwIP does when the peer goes away.
+ */
+void reset(altcp_pcb *conn);
+
+/** Moves the fake clock forward, running lwIP timeouts and callbacks as
+ * they come due.
+ *
+ * @param[in] ms Milliseconds to run for.
+ */
+void run_for(uint64_t ms);
+
+/** Gets the number of pbufs allocated and not yet freed.
+ */
+std::size_t live_pbufs();
+
+}
+
+#endif//PCRB_HOST_LWIP_H_
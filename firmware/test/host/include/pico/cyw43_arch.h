@@ -0,0 +1,15 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_PICO_CYW43_ARCH_H_
+#define PCRB_HOST_PICO_CYW43_ARCH_H_
+
+/// Tests drive lwIP from a single thread, so there is nothing to lock
+inline void cyw43_arch_lwip_begin()
+{}
+
+inline void cyw43_arch_lwip_end()
+{}
+
+#endif//PCRB_HOST_PICO_CYW43_ARCH_H_
@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_PICO_MUTEX_H_
+#define PCRB_HOST_PICO_MUTEX_H_
+
+#include <cstdint>
+#include <mutex>
+
+struct mutex_t
+{
+	std::mutex lock;
+};
+
+struct recursive_mutex_t
+{
+	std::recursive_timed_mutex lock;
+};
+
+#define auto_init_mutex(name) static mutex_t name
+#define auto_init_recursive_mutex(name) static recursive_mutex_t name
+
+void mutex_init(mutex_t *mtx);
+void mutex_enter_blocking(mutex_t *mtx);
+void mutex_exit(mutex_t *mtx);
+
+void recursive_mutex_enter_blocking(recursive_mutex_t *mtx);
+bool recursive_mutex_enter_timeout_ms(recursive_mutex_t *mtx, uint32_t timeout_ms);
+void recursive_mutex_exit(recursive_mutex_t *mtx);
+
+#endif//PCRB_HOST_PICO_MUTEX_H_
@@ -0,0 +1,13 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_PICO_PLATFORM_H_
+#define PCRB_HOST_PICO_PLATFORM_H_
+
+#include <cstdint>
+
+/// Core of the calling thread, see pcrb::host::set_core()
+uint32_t get_core_num();
+
+#endif//PCRB_HOST_PICO_PLATFORM_H_
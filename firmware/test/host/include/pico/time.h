@@ -0,0 +1,13 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_PICO_TIME_H_
+#define PCRB_HOST_PICO_TIME_H_
+
+#include <cstdint>
+
+/// Fake clock, see pcrb::host::set_time_us()
+uint64_t time_us_64();
+
+#endif//PCRB_HOST_PICO_TIME_H_
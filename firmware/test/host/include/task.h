@@ -0,0 +1,16 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#ifndef PCRB_HOST_TASK_H_
+#define PCRB_HOST_TASK_H_
+
+#include <FreeRTOS.h>
+
+/// Ticks follow time_us_64()
+TickType_t xTaskGetTickCount();
+
+/// Moves time_us_64() forward, unless it follows the host clock
+void vTaskDelay(TickType_t ticks);
+
+#endif//PCRB_HOST_TASK_H_
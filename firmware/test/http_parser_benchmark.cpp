@@ -0,0 +1,112 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+/// Requests per second and cost per request of http_parser, to compare
+/// against the Wi-Fi round trip of a few milliseconds. Host numbers, the
+/// RP2040 at 125 MHz is roughly 20 to 50 times slower.
+
+#include <pcrb/http_parser.h>
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace
+{
+
+using pcrb::http_parser;
+
+constexpr std::string_view curl_request =
+	"GET /sense HTTP/1.1\r\n"
+	"Host: pcrb.local\r\n"
+	"User-Agent: curl/8.5.0\r\n"
+	"Accept: */*\r\n"
+	"\r\n";
+
+constexpr std::string_view toggle_request =
+	"POST /toggle?value=500 HTTP/1.1\r\n"
+	"Host: pcrb.local\r\n"
+	"User-Agent: python-requests/2.31.0\r\n"
+	"Accept-Encoding: gzip, deflate\r\n"
+	"Accept: */*\r\n"
+	"Connection: keep-alive\r\n"
+	"Content-Length: 0\r\n"
+	"\r\n";
+
+constexpr std::string_view browser_request =
+	"GET /boot HTTP/1.1\r\n"
+	"Host: pcrb.local\r\n"
+	"User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+	"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+	"Accept-Language: en-US,en;q=0.5\r\n"
+	"Accept-Encoding: gzip, deflate\r\n"
+	"Connection: keep-alive\r\n"
+	"Upgrade-Insecure-Requests: 1\r\n"
+	"Priority: u=0, i\r\n"
+	"\r\n";
+
+// Whole request in one piece, as when it arrives in a single segment
+void parse(benchmark::State& state, std::string_view request)
+{
+	http_parser parser;
+	for (auto _ : state)
+	{
+		parser.reset();
+		std::size_t used = parser.feed(std::span(request.data(), request.size()));
+		benchmark::DoNotOptimize(used);
+		if (parser.state() != http_parser::status::complete)
+			state.SkipWithError("request not parsed");
+	}
+	state.SetItemsProcessed(state.iterations());
+	state.SetBytesProcessed(state.iterations() * request.size());
+}
+
+// A byte at a time, the worst a client can split a request up
+void parse_bytewise(benchmark::State& state, std::string_view request)
+{
+	http_parser parser;
+	for (auto _ : state)
+	{
+		parser.reset();
+		for (const char& c : request)
+			parser.feed(std::span(&c, 1));
+		if (parser.state() != http_parser::status::complete)
+			state.SkipWithError("request not parsed");
+	}
+	state.SetItemsProcessed(state.iterations());
+	state.SetBytesProcessed(state.iterations() * request.size());
+}
+
+// Pipelined requests in one buffer, fed back to back as the server does
+void parse_pipelined(benchmark::State& state)
+{
+	std::string requests;
+	for (int i = 0; i < 10; ++i)
+		requests += toggle_request;
+
+	http_parser parser;
+	for (auto _ : state)
+	{
+		std::span<const char> rest(requests.data(), requests.size());
+		while (!rest.empty())
+		{
+			parser.reset();
+			rest = rest.subspan(parser.feed(rest));
+		}
+		benchmark::DoNotOptimize(parser.state());
+	}
+	state.SetItemsProcessed(state.iterations() * 10);
+	state.SetBytesProcessed(state.iterations() * requests.size());
+}
+
+BENCHMARK_CAPTURE(parse, curl, curl_request);
+BENCHMARK_CAPTURE(parse, toggle, toggle_request);
+BENCHMARK_CAPTURE(parse, browser, browser_request);
+BENCHMARK_CAPTURE(parse_bytewise, curl, curl_request);
+BENCHMARK_CAPTURE(parse_bytewise, browser, browser_request);
+BENCHMARK(parse_pipelined);
+
+}
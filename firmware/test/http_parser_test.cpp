@@ -0,0 +1,107 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/http_parser.h>
+
+#include <gtest/gtest.h>
+
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace
+{
+
+using pcrb::http_parser;
+
+// Feeds a whole buffer at once, as the server does with each pbuf
+std::size_t feed_all(http_parser& parser, std::string_view data)
+{
+	return parser.feed(std::span(data.data(), data.size()));
+}
+
+TEST(http_parser, parses_request)
+{
+	http_parser parser;
+	std::string_view request = "GET /api/sense HTTP/1.1\r\nHost: pcrb\r\n\r\n";
+	EXPECT_EQ(feed_all(parser, request), request.size());
+	EXPECT_EQ(parser.state(), http_parser::status::complete);
+	EXPECT_EQ(parser.request_method(), http_parser::method::get);
+	EXPECT_EQ(parser.target(), "/api/sense");
+	EXPECT_TRUE(parser.keep_alive());
+}
+
+TEST(http_parser, parses_byte_at_a_time)
+{
+	http_parser parser;
+	std::string_view request = "POST /api/toggle?ms=500 HTTP/1.0\r\nContent-Length: 3\r\n\r\nabc";
+	for (char c : request)
+		EXPECT_EQ(parser.feed(std::span(&c, 1)), 1u);
+	EXPECT_EQ(parser.state(), http_parser::status::complete);
+	EXPECT_EQ(parser.request_method(), http_parser::method::post);
+	EXPECT_EQ(parser.target(), "/api/toggle?ms=500");
+	EXPECT_FALSE(parser.keep_alive());
+}
+
+TEST(http_parser, skips_empty_lines_before_request_line)
+{
+	http_parser parser;
+	std::string_view request = "\r\n\r\n\nGET / HTTP/1.1\r\n\r\n";
+	EXPECT_EQ(feed_all(parser, request), request.size());
+	EXPECT_EQ(parser.state(), http_parser::status::complete);
+	EXPECT_EQ(parser.request_method(), http_parser::method::get);
+	EXPECT_EQ(parser.target(), "/");
+}
+
+TEST(http_parser, skips_crlf_after_body_of_previous_request)
+{
+	http_parser parser;
+	std::string_view requests =
+		"POST /api/toggle HTTP/1.1\r\nContent-Length: 2\r\n\r\nhi\r\n"
+		"GET /api/sense HTTP/1.1\r\n\r\n";
+	std::size_t used = feed_all(parser, requests);
+	EXPECT_EQ(parser.state(), http_parser::status::complete);
+	parser.reset();
+	feed_all(parser, requests.substr(used));
+	EXPECT_EQ(parser.state(), http_parser::status::complete);
+	EXPECT_EQ(parser.target(), "/api/sense");
+}
+
+TEST(http_parser, endless_empty_lines_rejected)
+{
+	http_parser parser;
+	std::string lines;
+	for (std::size_t i = 0; i <= http_parser::max_header_size; i += 2)
+		lines += "\r\n";
+	feed_all(parser, lines);
+	EXPECT_EQ(parser.state(), http_parser::status::error);
+	EXPECT_EQ(parser.error_code(), 431u);
+}
+
+TEST(http_parser, unknown_method_rejected)
+{
+	http_parser parser;
+	feed_all(parser, "BREW / HTTP/1.1\r\n\r\n");
+	EXPECT_EQ(parser.state(), http_parser::status::error);
+	EXPECT_EQ(parser.error_code(), 501u);
+}
+
+TEST(http_parser, chunked_body_rejected)
+{
+	http_parser parser;
+	feed_all(parser, "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n");
+	EXPECT_EQ(parser.state(), http_parser::status::error);
+	EXPECT_EQ(parser.error_code(), 501u);
+}
+
+TEST(http_parser, long_target_rejected)
+{
+	http_parser parser;
+	std::string request = "GET /" + std::string(http_parser::max_target_size, 'a') + " HTTP/1.1\r\n\r\n";
+	feed_all(parser, request);
+	EXPECT_EQ(parser.state(), http_parser::status::error);
+	EXPECT_EQ(parser.error_code(), 414u);
+}
+
+}
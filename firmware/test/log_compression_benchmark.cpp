@@ -0,0 +1,343 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+/// How small packed_log keeps a sample log (data/sample_log.txt), and what
+/// pushing, packing and reading it back cost.
+///
+/// History is compared against the text log packed_log replaced, a 128 KB
+/// ring of rendered lines, each with its terminating null.
+
+#include <pcrb/log.h>
+#include <pcrb/packed_log.h>
+#include <pcrb_host/fake.h>
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+using pcrb::event_log;
+using pcrb::log_entry;
+using pcrb::log_format;
+using pcrb::log_level;
+using pcrb::log_line;
+using pcrb::packed_log;
+
+// As in log.cpp
+constexpr std::size_t firmware_log_bytes = 30 * 1024;
+constexpr std::size_t firmware_checkpoints = 128;
+
+// Size of the text log packed_log replaced
+constexpr std::size_t text_log_bytes = 128 * 1024;
+
+// Bytes the table of kinds takes on the RP2040, where pointers are 4 bytes
+// rather than 8
+constexpr std::size_t target_kinds_bytes = packed_log::max_kinds * (4 + 4 + 2);
+
+struct sample
+{
+	std::vector<log_entry> entries;
+	std::vector<std::string> rendered;
+	// Formats and the strings arguments point into must stay put
+	std::deque<std::string> texts;
+	std::deque<log_format> formats;
+};
+
+log_level parse_level(std::string_view name)
+{
+	for (log_level level: {log_level::debug, log_level::info, log_level::warning, log_level::error})
+	{
+		if (name == pcrb::log_level_name(level))
+			return level;
+	}
+	return log_level::info;
+}
+
+template<class T>
+T parse_number(std::string_view text)
+{
+	T value = 0;
+	std::from_chars(text.data(), text.data() + text.size(), value);
+	return value;
+}
+
+const sample& load_sample()
+{
+	static sample result = [] {
+		sample loaded;
+		std::map<std::pair<std::string, log_level>, const log_format*> known;
+		std::ifstream file(PCRB_TEST_DATA_DIR "/sample_log.txt");
+		if (!file)
+		{
+			std::fprintf(stderr, "unable to open %s\n", PCRB_TEST_DATA_DIR "/sample_log.txt");
+			std::exit(1);
+		}
+
+		std::string text;
+		while (std::getline(file, text))
+		{
+			if (text.empty() || text[0] == '#')
+				continue;
+			std::vector<std::string_view> fields;
+			std::string_view rest = loaded.texts.emplace_back(std::move(text));
+			for (std::size_t tab; (tab = rest.find('\t')) != std::string_view::npos; rest.remove_prefix(tab + 1))
+				fields.push_back(rest.substr(0, tab));
+			fields.push_back(rest);
+			if (fields.size() < 3)
+				continue;
+
+			log_level level = parse_level(fields[1]);
+			auto key = std::make_pair(std::string(fields[2]), level);
+			auto found = known.find(key);
+			if (found == known.end())
+				found = known.emplace(key, &loaded.formats.emplace_back(log_format{ fields[2], level })).first;
+
+			log_entry entry;
+			entry.format = found->second;
+			entry.timestamp_us = parse_number<uint64_t>(fields[0]);
+			entry.sequence = loaded.entries.size();
+			for (std::string_view field: std::span(fields).subspan(3))
+			{
+				std::string_view value = field.substr(2);
+				switch (field[0])
+				{
+					case 'u':
+						entry.add(parse_number<uint32_t>(value));
+						break;
+					case 'i':
+						entry.add(parse_number<int32_t>(value));
+						break;
+					case 'b':
+						entry.add(value == "true");
+						break;
+					default:
+						entry.add(value);
+						break;
+				}
+			}
+			loaded.entries.push_back(entry);
+			log_line line;
+			entry.render(line);
+			loaded.rendered.emplace_back(line.view());
+		}
+		return loaded;
+	}();
+	return result;
+}
+
+// Ring as configured in the firmware, filled with the sample over and over
+struct firmware_ring
+{
+	firmware_ring()
+	:log(storage, checkpoints)
+	{}
+
+	std::array<std::byte, firmware_log_bytes> storage;
+	std::array<packed_log::checkpoint, firmware_checkpoints> checkpoints;
+	packed_log log;
+};
+
+// Sizes, and a check that every message reads back as it went in
+void compression(benchmark::State& state)
+{
+	const sample& data = load_sample();
+	std::size_t count = data.entries.size();
+	std::size_t checkpoints = 1;
+	while (checkpoints * packed_log::block_size < count + packed_log::block_size)
+		checkpoints *= 2;
+
+	double packed_bytes = 0;
+	for (auto _ : state)
+	{
+		std::vector<std::byte> storage(count * packed_log::max_record_size);
+		std::vector<packed_log::checkpoint> marks(checkpoints);
+		packed_log log(storage, marks);
+		for (const log_entry& entry: data.entries)
+			log.append(entry);
+		packed_bytes = static_cast<double>(log.used()) / count;
+
+		state.PauseTiming();
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			log_entry entry;
+			log_line line;
+			if (!log.read(i, entry))
+			{
+				state.SkipWithError("message missing");
+				return;
+			}
+			entry.render(line);
+			if (line.view() != data.rendered[i] || entry.timestamp_us != data.entries[i].timestamp_us)
+			{
+				state.SkipWithError("message read back differently");
+				return;
+			}
+		}
+		state.ResumeTiming();
+	}
+
+	double raw_bytes = 0;
+	double text_bytes = 0;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		raw_bytes += offsetof(log_entry, args) + data.entries[i].args_size;
+		text_bytes += data.rendered[i].size();
+	}
+	raw_bytes /= count;
+	text_bytes /= count;
+	double text_log_held = text_log_bytes / (text_bytes + 1);
+
+	// Messages the firmware's ring holds of this mix, once it wraps
+	firmware_ring ring;
+	for (std::size_t round = 0; round < 4; ++round)
+	{
+		for (const log_entry& entry: data.entries)
+			ring.log.append(entry);
+	}
+	double held = ring.log.end() - ring.log.first();
+
+	state.counters["messages"] = count;
+	state.counters["kinds"] = ring.log.kinds();
+	state.counters["raw_bytes"] = raw_bytes;
+	state.counters["text_bytes"] = text_bytes;
+	// Including checkpoints, which records no longer hold pointers to need
+	// adjusting for the RP2040
+	state.counters["packed_bytes"] = packed_bytes;
+	state.counters["ratio_vs_text"] = (text_bytes + 1) / packed_bytes;
+	state.counters["text_log_held"] = text_log_held;
+	state.counters["firmware_ram_rp2040"] = firmware_log_bytes
+		+ firmware_checkpoints * sizeof(packed_log::checkpoint) + target_kinds_bytes;
+	state.counters["firmware_held"] = held;
+	state.counters["held_vs_text_log"] = held / text_log_held;
+}
+
+// Pushing to a core ring, what whoever logs pays
+void push(benchmark::State& state)
+{
+	const sample& data = load_sample();
+	static std::array<std::byte, firmware_log_bytes> storage;
+	static std::array<packed_log::checkpoint, firmware_checkpoints> checkpoints;
+	static event_log log(storage, checkpoints);
+	std::size_t i = 0;
+	for (auto _ : state)
+	{
+		log.push(data.entries[i]);
+		if (++i == data.entries.size())
+			i = 0;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+// Pushing and then collecting into the packed log, as the log task does
+void push_and_collect(benchmark::State& state)
+{
+	const sample& data = load_sample();
+	static std::array<std::byte, firmware_log_bytes> storage;
+	static std::array<packed_log::checkpoint, firmware_checkpoints> checkpoints;
+	static event_log log(storage, checkpoints);
+	std::size_t i = 0;
+	for (auto _ : state)
+	{
+		// A ring's worth at a time, without losing any
+		for (std::size_t n = 0; n < event_log::core_ring_size - 1; ++n)
+		{
+			log.push(data.entries[i]);
+			if (++i == data.entries.size())
+				i = 0;
+		}
+		benchmark::DoNotOptimize(log.end());
+	}
+	state.SetItemsProcessed(state.iterations() * (event_log::core_ring_size - 1));
+}
+
+void append(benchmark::State& state)
+{
+	const sample& data = load_sample();
+	firmware_ring ring;
+	std::size_t i = 0;
+	for (auto _ : state)
+	{
+		ring.log.append(data.entries[i]);
+		if (++i == data.entries.size())
+			i = 0;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+void read_sequential(benchmark::State& state)
+{
+	const sample& data = load_sample();
+	firmware_ring ring;
+	for (const log_entry& entry: data.entries)
+		ring.log.append(entry);
+	uint32_t first = ring.log.first();
+	uint32_t sequence = first;
+	for (auto _ : state)
+	{
+		log_entry entry;
+		benchmark::DoNotOptimize(ring.log.read(sequence, entry));
+		if (++sequence == ring.log.end())
+			sequence = first;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+void read_random(benchmark::State& state)
+{
+	const sample& data = load_sample();
+	firmware_ring ring;
+	for (const log_entry& entry: data.entries)
+		ring.log.append(entry);
+	uint32_t first = ring.log.first();
+	uint32_t held = ring.log.end() - first;
+	// Fixed steps that never land next to each other
+	uint32_t sequence = 0;
+	for (auto _ : state)
+	{
+		log_entry entry;
+		benchmark::DoNotOptimize(ring.log.read(first + sequence, entry));
+		sequence = (sequence + 977) % held;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+void render(benchmark::State& state)
+{
+	const sample& data = load_sample();
+	std::size_t i = 0;
+	for (auto _ : state)
+	{
+		log_line line;
+		data.entries[i].render(line);
+		benchmark::DoNotOptimize(line);
+		if (++i == data.entries.size())
+			i = 0;
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(compression)->Unit(benchmark::kMicrosecond);
+BENCHMARK(push);
+BENCHMARK(push_and_collect);
+BENCHMARK(append);
+BENCHMARK(read_sequential);
+BENCHMARK(read_random);
+BENCHMARK(render);
+
+}
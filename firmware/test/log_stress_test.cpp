@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+/// Latency of event_log::push() with both cores logging flat out and a
+/// reader collecting the core rings at the same time, each fake core a
+/// thread of its own.
+
+#include <pcrb/log.h>
+#include <pcrb_host/fake.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+using pcrb::event_log;
+using pcrb::log_entry;
+using pcrb::packed_log;
+namespace host = pcrb::host;
+
+constexpr std::size_t pushes_per_core = 200000;
+
+// Generous, a push is a copy of well under 100 bytes, but the host may
+// preempt a thread at any point
+constexpr std::chrono::nanoseconds p99_limit = std::chrono::microseconds(20);
+
+constexpr pcrb::log_format stress_format = { "core {} message {}", pcrb::log_level::info };
+
+struct latencies
+{
+	std::chrono::nanoseconds p50;
+	std::chrono::nanoseconds p99;
+	std::chrono::nanoseconds max;
+};
+
+latencies summarize(std::vector<std::chrono::nanoseconds>& samples)
+{
+	std::sort(samples.begin(), samples.end());
+	return {
+		.p50 = samples[samples.size() / 2],
+		.p99 = samples[samples.size() * 99 / 100],
+		.max = samples.back(),
+	};
+}
+
+// Pushes distinct messages as fast as it can from one core, timing each
+std::vector<std::chrono::nanoseconds> saturate(event_log& log, uint32_t core, std::atomic_bool& go)
+{
+	host::set_core(core);
+	std::vector<std::chrono::nanoseconds> samples(pushes_per_core);
+	while (!go)
+		std::this_thread::yield();
+	for (uint32_t i = 0; i < pushes_per_core; ++i)
+	{
+		log_entry entry;
+		entry.format = &stress_format;
+		entry.add(core);
+		entry.add(i);
+		auto start = std::chrono::steady_clock::now();
+		log.push(entry);
+		samples[i] = std::chrono::steady_clock::now() - start;
+	}
+	return samples;
+}
+
+// Arguments of a stress message, as pushed by saturate()
+std::array<uint32_t, 2> arguments(const log_entry& entry)
+{
+	std::array<uint32_t, 2> values;
+	// Each is a 1 byte type tag followed by the value
+	memcpy(&values[0], entry.args.data() + 1, sizeof(uint32_t));
+	memcpy(&values[1], entry.args.data() + 6, sizeof(uint32_t));
+	return values;
+}
+
+TEST(log_stress, push_never_waits_with_both_cores_saturated)
+{
+	host::use_real_clock(true);
+	static std::array<std::byte, 256 * 1024> storage;
+	static std::array<packed_log::checkpoint, 4096> checkpoints;
+	static event_log log(storage, checkpoints);
+
+	std::atomic_bool go = false;
+	std::atomic_bool done = false;
+	std::vector<std::chrono::nanoseconds> core0;
+	std::vector<std::chrono::nanoseconds> core1;
+	std::thread producer0([&] { core0 = saturate(log, 0, go); });
+	std::thread producer1([&] { core1 = saturate(log, 1, go); });
+
+	// Reads everything as it comes in, like the log task, checking each
+	// core's messages stay in the order they were pushed
+	std::array<int64_t, 2> last = { -1, -1 };
+	std::size_t out_of_order = 0;
+	std::size_t read = 0;
+	uint32_t next = 0;
+	auto drain = [&] {
+		for (uint32_t end = log.end(); next != end; ++next)
+		{
+			log_entry entry;
+			if (!log.read(next, entry))
+				continue;
+			auto [core, i] = arguments(entry);
+			if (static_cast<int64_t>(i) <= last[core])
+				++out_of_order;
+			last[core] = i;
+			++read;
+		}
+	};
+	std::thread reader([&] {
+		host::set_core(0);
+		while (!done)
+			drain();
+	});
+
+	go = true;
+	producer0.join();
+	producer1.join();
+	done = true;
+	reader.join();
+	drain();
+	host::use_real_clock(false);
+
+	latencies first = summarize(core0);
+	latencies second = summarize(core1);
+	std::printf("core 0: p50 %lld ns, p99 %lld ns, max %lld ns\n",
+		static_cast<long long>(first.p50.count()), static_cast<long long>(first.p99.count()),
+		static_cast<long long>(first.max.count()));
+	std::printf("core 1: p50 %lld ns, p99 %lld ns, max %lld ns\n",
+		static_cast<long long>(second.p50.count()), static_cast<long long>(second.p99.count()),
+		static_cast<long long>(second.max.count()));
+	std::printf("collected %u, read %zu, dropped %u\n", log.end(), read, log.dropped());
+
+	EXPECT_LT(first.p99, p99_limit);
+	EXPECT_LT(second.p99, p99_limit);
+	EXPECT_EQ(out_of_order, 0u);
+	// Every push is either collected or counted as dropped, none are lost
+	// to torn slots
+	EXPECT_EQ(log.end() + log.dropped(), 2 * pushes_per_core);
+	EXPECT_GT(read, 0u);
+	EXPECT_EQ(last[0], static_cast<int64_t>(pushes_per_core - 1));
+	EXPECT_EQ(last[1], static_cast<int64_t>(pushes_per_core - 1));
+}
+
+}
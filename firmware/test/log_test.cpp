@@ -0,0 +1,305 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+/// Reading event_log a page at a time, rate limiting and collapsing
+/// repeats, on a fake clock.
+
+#include <pcrb/log.h>
+#include <pcrb_host/fake.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+using pcrb::event_log;
+using pcrb::log_entry;
+using pcrb::log_filter;
+using pcrb::log_level;
+using pcrb::log_line;
+using pcrb::packed_log;
+namespace host = pcrb::host;
+
+constexpr pcrb::log_format info_format = { "message {}", log_level::info };
+constexpr pcrb::log_format error_format = { "failure {}", log_level::error };
+
+class log_test : public testing::Test
+{
+protected:
+	void SetUp() override
+	{
+		host::use_real_clock(false);
+		host::set_time_us(1000000);
+		host::set_core(0);
+	}
+
+	// Pushes a message by hand, so rate limiting stays out of the way, and
+	// collects it as the log task would, as a core ring only holds a few
+	void push(const pcrb::log_format& format, uint32_t value)
+	{
+		log_entry entry;
+		entry.format = &format;
+		entry.add(value);
+		log.push(entry);
+		log.end();
+		host::advance_time_us(10);
+	}
+
+	// Text of every message held, oldest first
+	std::vector<std::string> messages()
+	{
+		std::vector<std::string> result;
+		std::array<log_line, 8> lines;
+		uint32_t cursor = 0;
+		for (;;)
+		{
+			uint32_t previous = cursor;
+			std::size_t count = log.query({}, cursor, lines);
+			for (std::size_t i = 0; i < count; ++i)
+				result.emplace_back(lines[i].view());
+			if (cursor == previous)
+				return result;
+		}
+	}
+
+	std::array<std::byte, 64 * 1024> storage;
+	std::array<packed_log::checkpoint, 1024> checkpoints;
+	event_log log{storage, checkpoints};
+};
+
+TEST_F(log_test, query_reads_pages_in_order)
+{
+	for (uint32_t i = 0; i < 10; ++i)
+		push(info_format, i);
+
+	std::array<log_line, 4> lines;
+	uint32_t cursor = 0;
+	ASSERT_EQ(log.query({}, cursor, lines), 4u);
+	EXPECT_EQ(lines[0].view(), "message 0");
+	EXPECT_EQ(lines[3].view(), "message 3");
+	EXPECT_EQ(cursor, 4u);
+	ASSERT_EQ(log.query({}, cursor, lines), 4u);
+	EXPECT_EQ(lines[0].sequence, 4u);
+	ASSERT_EQ(log.query({}, cursor, lines), 2u);
+	EXPECT_EQ(lines[1].view(), "message 9");
+	EXPECT_EQ(cursor, 10u);
+
+	// The end, for now
+	EXPECT_EQ(log.query({}, cursor, lines), 0u);
+	EXPECT_EQ(cursor, 10u);
+	push(info_format, 10);
+	ASSERT_EQ(log.query({}, cursor, lines), 1u);
+	EXPECT_EQ(lines[0].view(), "message 10");
+}
+
+TEST_F(log_test, query_filters_on_level_and_text)
+{
+	for (uint32_t i = 0; i < 10; ++i)
+		push(i % 2 ? error_format : info_format, i);
+
+	std::array<log_line, 4> lines;
+	uint32_t cursor = 0;
+	ASSERT_EQ(log.query({ .level = log_level::error, .text = {} }, cursor, lines), 4u);
+	EXPECT_EQ(lines[0].view(), "failure 1");
+	EXPECT_EQ(lines[3].view(), "failure 7");
+
+	cursor = 0;
+	ASSERT_EQ(log.query({ .text = "sage 4" }, cursor, lines), 1u);
+	EXPECT_EQ(lines[0].sequence, 4u);
+	EXPECT_EQ(cursor, 10u);
+}
+
+TEST_F(log_test, query_stops_after_scan_limit)
+{
+	// Plenty of messages the filter skips, then one it wants
+	const std::size_t skipped = 3 * event_log::query_scan_limit;
+	for (uint32_t i = 0; i < skipped; ++i)
+		push(info_format, i);
+	push(error_format, 0);
+
+	std::array<log_line, 4> lines;
+	log_filter errors = { .level = log_level::error, .text = {} };
+	uint32_t cursor = 0;
+	std::size_t pages = 0;
+	std::size_t found = 0;
+	for (;;)
+	{
+		uint32_t previous = cursor;
+		std::size_t count = log.query(errors, cursor, lines);
+		found += count;
+		if (cursor == previous)
+			break;
+		++pages;
+		// Each page resumes where the last stopped looking
+		EXPECT_LE(cursor - previous, event_log::query_scan_limit);
+	}
+	EXPECT_EQ(found, 1u);
+	EXPECT_EQ(cursor, skipped + 1);
+	EXPECT_EQ(pages, 4u);
+}
+
+TEST_F(log_test, query_starts_from_the_oldest_held)
+{
+	push(info_format, 0);
+	push(info_format, 1);
+
+	// Past the end of the log, clamped to it
+	std::array<log_line, 4> lines;
+	uint32_t cursor = 100;
+	EXPECT_EQ(log.query({}, cursor, lines), 0u);
+	EXPECT_EQ(cursor, 2u);
+
+	// Before the start, wrapped around, clamped to the oldest
+	cursor = -5;
+	EXPECT_EQ(log.query({}, cursor, lines), 2u);
+}
+
+TEST_F(log_test, tail_finds_the_last_matching)
+{
+	for (uint32_t i = 0; i < 20; ++i)
+		push(i % 4 ? info_format : error_format, i);
+
+	EXPECT_EQ(log.tail({}, 3), 17u);
+	EXPECT_EQ(log.tail({ .level = log_level::error, .text = {} }, 2), 12u);
+	EXPECT_EQ(log.tail({ .text = "message 1" }, 2), 18u);
+	// Not that many, so from the oldest
+	EXPECT_EQ(log.tail({ .level = log_level::error, .text = {} }, 100), 0u);
+}
+
+TEST_F(log_test, tail_stops_after_scan_limit)
+{
+	const std::size_t total = 2 * event_log::tail_scan_limit;
+	for (uint32_t i = 0; i < total; ++i)
+		push(info_format, i);
+
+	EXPECT_EQ(log.tail({ .level = log_level::error, .text = {} }, 1), total - event_log::tail_scan_limit);
+}
+
+TEST_F(log_test, rate_limit_lets_a_burst_through)
+{
+	for (uint32_t i = 0; i < event_log::rate_limit_burst + 5; ++i)
+		log.push<"burst {}">(i);
+	EXPECT_EQ(log.limited(), 5u);
+
+	// The next one let through says how many were turned away
+	host::advance_time_us(event_log::rate_limit_period_us);
+	log.push<"burst {}">(99u);
+	auto held = messages();
+	ASSERT_EQ(held.size(), event_log::rate_limit_burst + 2);
+	EXPECT_EQ(held[0], "burst 0");
+	EXPECT_EQ(held[9], "burst 9");
+	EXPECT_EQ(held[10], "5 more like the next message were rate limited");
+	EXPECT_EQ(held[11], "burst 99");
+	EXPECT_EQ(log.limited(), 5u);
+}
+
+TEST_F(log_test, rate_limit_refills_a_token_per_period)
+{
+	auto flood = [this](uint32_t count) {
+		uint32_t before = log.limited();
+		for (uint32_t i = 0; i < count; ++i)
+			log.push<"refill {}">(i);
+		log.end();
+		return count - (log.limited() - before);
+	};
+	EXPECT_EQ(flood(event_log::rate_limit_burst + 1), event_log::rate_limit_burst);
+
+	// Part of a period earns nothing
+	host::advance_time_us(event_log::rate_limit_period_us / 2);
+	EXPECT_EQ(flood(1), 0u);
+	host::advance_time_us(2 * event_log::rate_limit_period_us);
+	EXPECT_EQ(flood(3), 2u);
+	// Half a period was left over from before
+	host::advance_time_us(event_log::rate_limit_period_us / 2);
+	EXPECT_EQ(flood(2), 1u);
+
+	// A long quiet spell earns no more than a burst
+	host::advance_time_us(100 * event_log::rate_limit_period_us);
+	EXPECT_EQ(flood(event_log::rate_limit_burst + 5), event_log::rate_limit_burst);
+}
+
+TEST_F(log_test, rate_limit_is_per_core)
+{
+	for (uint32_t i = 0; i < event_log::rate_limit_burst + 1; ++i)
+		log.push<"cores {}">(i);
+	EXPECT_EQ(log.limited(), 1u);
+
+	host::set_core(1);
+	log.push<"cores {}">(100u);
+	host::set_core(0);
+	log.push<"cores {}">(101u);
+	EXPECT_EQ(log.limited(), 2u);
+	auto held = messages();
+	ASSERT_EQ(held.size(), event_log::rate_limit_burst + 1);
+	EXPECT_EQ(held.back(), "cores 100");
+}
+
+TEST_F(log_test, repeats_are_collapsed)
+{
+	push(error_format, 1);
+	for (int i = 0; i < 4; ++i)
+		push(error_format, 2);
+	push(info_format, 2);
+	EXPECT_EQ(log.repeated(), 3u);
+
+	std::array<log_line, 8> lines;
+	uint32_t cursor = 0;
+	ASSERT_EQ(log.query({}, cursor, lines), 4u);
+	EXPECT_EQ(lines[0].view(), "failure 1");
+	EXPECT_EQ(lines[1].view(), "failure 2");
+	EXPECT_EQ(lines[2].view(), "last message repeated 3 times");
+	// At the level of what was repeated, and the time of the last repeat
+	EXPECT_EQ(lines[2].level, log_level::error);
+	EXPECT_EQ(lines[2].timestamp_us, lines[3].timestamp_us - 10);
+	EXPECT_EQ(lines[3].view(), "message 2");
+}
+
+TEST_F(log_test, endless_repeats_are_reported_every_so_often)
+{
+	for (int i = 0; i < 3; ++i)
+		push(info_format, 7);
+	// Not yet
+	EXPECT_EQ(messages().size(), 1u);
+
+	host::advance_time_us(30000000);
+	auto held = messages();
+	ASSERT_EQ(held.size(), 2u);
+	EXPECT_EQ(held[1], "last message repeated 2 times");
+
+	// Still the same message, so counting starts over
+	push(info_format, 7);
+	push(info_format, 8);
+	held = messages();
+	ASSERT_EQ(held.size(), 4u);
+	EXPECT_EQ(held[2], "last message repeated 1 times");
+	EXPECT_EQ(held[3], "message 8");
+	EXPECT_EQ(log.repeated(), 3u);
+}
+
+TEST_F(log_test, storm_costs_a_counter)
+{
+	// The same failure over and over, as from a loop retrying it
+	for (int i = 0; i < 100; ++i)
+		log.push<"storm {}">(7u);
+	EXPECT_EQ(log.limited(), 90u);
+	EXPECT_EQ(log.repeated(), 9u);
+
+	host::advance_time_us(event_log::rate_limit_period_us);
+	log.push<"storm {}">(7u);
+	auto held = messages();
+	ASSERT_EQ(held.size(), 4u);
+	EXPECT_EQ(held[0], "storm 7");
+	EXPECT_EQ(held[1], "last message repeated 9 times");
+	EXPECT_EQ(held[2], "90 more like the next message were rate limited");
+	EXPECT_EQ(held[3], "storm 7");
+}
+
+}
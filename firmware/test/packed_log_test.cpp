@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+/// Packing entries into packed_log and reading them back, across the edges
+/// of its format: times, kinds, arguments and the ring wrapping around.
+
+#include <pcrb/log.h>
+#include <pcrb/packed_log.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+
+namespace
+{
+
+using pcrb::log_entry;
+using pcrb::log_format;
+using pcrb::log_level;
+using pcrb::log_line;
+using pcrb::packed_log;
+
+constexpr log_format plain_format = { "tick", log_level::info };
+constexpr log_format value_format = { "value {}", log_level::info };
+constexpr log_format mixed_format = { "{} {} {} {} {} {}", log_level::warning };
+
+log_entry make_entry(const log_format& format, uint64_t timestamp_us)
+{
+	log_entry entry;
+	entry.format = &format;
+	entry.timestamp_us = timestamp_us;
+	return entry;
+}
+
+std::string text(const log_entry& entry)
+{
+	log_line line;
+	entry.render(line);
+	return std::string(line.view());
+}
+
+class packed_log_test : public testing::Test
+{
+protected:
+	std::array<std::byte, 2048> storage;
+	std::array<packed_log::checkpoint, 16> checkpoints;
+	packed_log log{storage, checkpoints};
+};
+
+TEST_F(packed_log_test, reads_back_every_type_of_argument)
+{
+	log_entry entry = make_entry(mixed_format, 5);
+	entry.add(uint32_t(0xFFFFFFFF));
+	entry.add(int32_t(-7));
+	entry.add(uint64_t(1) << 63);
+	entry.add(int64_t(-1) << 40);
+	entry.add(true);
+	entry.add(std::string_view("text"));
+	log.append(entry);
+
+	log_entry read;
+	ASSERT_TRUE(log.read(0, read));
+	EXPECT_EQ(read.format, &mixed_format);
+	EXPECT_EQ(read.timestamp_us, 5u);
+	EXPECT_EQ(read.sequence, 0u);
+	EXPECT_EQ(text(read), text(entry));
+	EXPECT_FALSE(log.read(1, read));
+}
+
+TEST_F(packed_log_test, times_in_every_encoding)
+{
+	// The same time, short, medium and long steps, going back, and the
+	// first entry of the next block, which has its time in full
+	const uint64_t times[] = { 1000, 1000, 1100, 70000, 20000000, 19999000, 1ull << 40 };
+	for (uint64_t time: times)
+		log.append(make_entry(plain_format, time));
+	for (uint32_t i = log.end(); i < packed_log::block_size + 2; ++i)
+		log.append(make_entry(plain_format, (1ull << 40) + i));
+
+	log_entry read;
+	for (uint32_t i = 0; i < std::size(times); ++i)
+	{
+		ASSERT_TRUE(log.read(i, read));
+		EXPECT_EQ(read.timestamp_us, times[i]) << i;
+	}
+	ASSERT_TRUE(log.read(packed_log::block_size, read));
+	EXPECT_EQ(read.timestamp_us, (1ull << 40) + packed_log::block_size);
+	// Out of order, from the checkpoint rather than the entry before
+	ASSERT_TRUE(log.read(3, read));
+	EXPECT_EQ(read.timestamp_us, 70000u);
+}
+
+TEST_F(packed_log_test, same_format_with_other_arguments_is_another_kind)
+{
+	log_entry number = make_entry(value_format, 0);
+	number.add(uint32_t(3));
+	log_entry word = make_entry(value_format, 0);
+	word.add(std::string_view("three"));
+	log.append(number);
+	log.append(word);
+	log.append(number);
+	EXPECT_EQ(log.kinds(), 3u);
+
+	log_entry read;
+	ASSERT_TRUE(log.read(1, read));
+	EXPECT_EQ(text(read), "value three");
+	ASSERT_TRUE(log.read(2, read));
+	EXPECT_EQ(text(read), "value 3");
+}
+
+TEST_F(packed_log_test, kinds_past_a_byte_of_header_and_past_the_table)
+{
+	std::deque<log_format> formats;
+	std::deque<std::string> texts;
+	for (std::size_t i = 0; i < packed_log::max_kinds + 2; ++i)
+	{
+		texts.push_back("kind " + std::to_string(i) + " {}");
+		formats.push_back({ texts.back(), log_level::info });
+	}
+	for (const log_format& format: formats)
+	{
+		log_entry entry = make_entry(format, 0);
+		entry.add(uint32_t(1));
+		log.append(entry);
+	}
+	EXPECT_EQ(log.kinds(), packed_log::max_kinds);
+
+	log_entry read;
+	ASSERT_TRUE(log.read(100, read));
+	EXPECT_EQ(text(read), "kind 100 1");
+	// The first kind is taken by the note for those that don't fit
+	ASSERT_TRUE(log.read(packed_log::max_kinds - 2, read));
+	EXPECT_EQ(read.format, &formats[packed_log::max_kinds - 2]);
+	ASSERT_TRUE(log.read(packed_log::max_kinds - 1, read));
+	EXPECT_EQ(read.level(), log_level::error);
+	EXPECT_EQ(read.args_size, 0u);
+}
+
+TEST_F(packed_log_test, drops_the_oldest_block_when_full)
+{
+	for (uint32_t i = 0; i < 2000; ++i)
+	{
+		log_entry entry = make_entry(value_format, i * 1000);
+		entry.add(i);
+		log.append(entry);
+	}
+	EXPECT_EQ(log.end(), 2000u);
+	EXPECT_EQ(log.first() % packed_log::block_size, 0u);
+	EXPECT_GT(log.first(), 0u);
+	EXPECT_LE(log.used(), log.capacity());
+
+	log_entry read;
+	EXPECT_FALSE(log.read(log.first() - 1, read));
+	for (uint32_t i = log.first(); i < log.end(); ++i)
+	{
+		ASSERT_TRUE(log.read(i, read));
+		EXPECT_EQ(text(read), "value " + std::to_string(i));
+		EXPECT_EQ(read.timestamp_us, i * 1000u);
+	}
+}
+
+}
@@ -0,0 +1,321 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+/// persistent_log on RAM storage: finding the newest sector after a reboot,
+/// wrapping around, and ignoring sectors it did not write.
+
+#include <pcrb/persistent_log.h>
+#include <pcrb/log_storage.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <span>
+#include <string>
+
+namespace
+{
+
+using pcrb::log_line;
+using pcrb::persistent_log;
+
+// Small sectors, so a handful of lines fill one
+constexpr std::size_t sector_size = 512;
+constexpr std::size_t sectors = 4;
+using storage = pcrb::ram_log_storage<sector_size, sectors>;
+
+// Sector header as persistent_log lays it out
+constexpr uint32_t sector_magic = 0x474F4C50;
+
+struct sector_header
+{
+	uint32_t magic;
+	uint32_t serial;
+	uint32_t boot;
+	uint32_t check;
+};
+
+sector_header make_header(uint32_t serial, uint32_t boot)
+{
+	return { sector_magic, serial, boot, ~(sector_magic ^ serial ^ (boot * 0x9E3779B9)) };
+}
+
+// Writes a sector with a header and no lines, as if written by an earlier
+// boot
+void write_sector(storage& to, std::size_t sector, const sector_header& header)
+{
+	std::array<std::byte, sector_size> data;
+	data.fill(std::byte(0xFF));
+	memcpy(data.data(), &header, sizeof(header));
+	to.write(sector, data);
+}
+
+sector_header read_header(const storage& from, std::size_t sector)
+{
+	sector_header header;
+	from.read(sector, 0, std::as_writable_bytes(std::span(&header, 1)));
+	return header;
+}
+
+log_line make_line(uint32_t sequence)
+{
+	log_line line;
+	line.sequence = sequence;
+	line.timestamp_us = sequence * 1000;
+	line.level = pcrb::log_level::info;
+	std::string text = std::format("message {}", sequence);
+	memcpy(line.text.data(), text.data(), text.size());
+	line.size = text.size();
+	line.text[line.size] = '\0';
+	return line;
+}
+
+// Lines of a boot, one per sector so each append lands in a sector of its
+// own
+void log_sectors(persistent_log<storage>& log, uint32_t first, std::size_t count)
+{
+	for (uint32_t sequence = first; sequence < first + count; ++sequence)
+	{
+		ASSERT_TRUE(log.append(make_line(sequence)));
+		ASSERT_TRUE(log.flush());
+	}
+}
+
+TEST(persistent_log, erased_storage_starts_at_first_boot)
+{
+	storage flash;
+	persistent_log log(flash);
+	log.open();
+	EXPECT_TRUE(log.enabled());
+	EXPECT_EQ(log.boot(), 1u);
+	EXPECT_EQ(log.previous_boot(), 0u);
+
+	std::array<log_line, 4> lines;
+	EXPECT_EQ(log.read(1, 0, lines), 0u);
+}
+
+TEST(persistent_log, lines_wait_for_flush)
+{
+	storage flash;
+	persistent_log log(flash);
+	log.open();
+	ASSERT_TRUE(log.append(make_line(0)));
+	EXPECT_EQ(flash.writes(), 0u);
+
+	std::array<log_line, 4> lines;
+	EXPECT_EQ(log.read(log.boot(), 0, lines), 0u);
+	ASSERT_TRUE(log.flush());
+	EXPECT_EQ(flash.writes(), 1u);
+	ASSERT_EQ(log.read(log.boot(), 0, lines), 1u);
+	EXPECT_EQ(lines[0].view(), "message 0");
+
+	// Nothing new, so nothing written
+	ASSERT_TRUE(log.flush());
+	EXPECT_EQ(flash.writes(), 1u);
+}
+
+TEST(persistent_log, finds_previous_boot)
+{
+	storage flash;
+	{
+		persistent_log log(flash);
+		log.open();
+		log_sectors(log, 0, 2);
+	}
+
+	persistent_log log(flash);
+	log.open();
+	EXPECT_EQ(log.boot(), 2u);
+	EXPECT_EQ(log.previous_boot(), 1u);
+
+	std::array<log_line, 4> lines;
+	ASSERT_EQ(log.read(log.previous_boot(), 0, lines), 2u);
+	EXPECT_EQ(lines[0].view(), "message 0");
+	EXPECT_EQ(lines[0].sequence, 0u);
+	EXPECT_EQ(lines[0].timestamp_us, 0u);
+	EXPECT_EQ(lines[1].view(), "message 1");
+	EXPECT_EQ(lines[1].timestamp_us, 1000u);
+	EXPECT_EQ(log.read(log.boot(), 0, lines), 0u);
+
+	// A boot that wrote nothing leaves the one before it as the previous
+	// boot
+	persistent_log quiet(flash);
+	quiet.open();
+	EXPECT_EQ(quiet.previous_boot(), 1u);
+}
+
+TEST(persistent_log, full_sector_is_written_out)
+{
+	storage flash;
+	persistent_log log(flash);
+	log.open();
+	uint32_t sequence = 0;
+	while (flash.writes() == 0)
+		ASSERT_TRUE(log.append(make_line(sequence++)));
+
+	// The line that did not fit waits for the next sector
+	std::array<log_line, 64> lines;
+	EXPECT_EQ(log.read(log.boot(), 0, lines), sequence - 1);
+	ASSERT_TRUE(log.flush());
+	ASSERT_EQ(log.read(log.boot(), 0, lines), sequence);
+	EXPECT_EQ(lines[sequence - 1].sequence, sequence - 1);
+}
+
+TEST(persistent_log, wraps_around_over_the_oldest_sector)
+{
+	storage flash;
+	{
+		persistent_log log(flash);
+		log.open();
+		log_sectors(log, 0, sectors + 2);
+	}
+	// Every sector wears the same
+	EXPECT_EQ(flash.writes(), sectors + 2);
+
+	persistent_log log(flash);
+	log.open();
+	EXPECT_EQ(log.previous_boot(), 1u);
+	std::array<log_line, 8> lines;
+	ASSERT_EQ(log.read(1, 0, lines), sectors);
+	// Oldest first, starting after the two overwritten
+	for (std::size_t i = 0; i < sectors; ++i)
+		EXPECT_EQ(lines[i].sequence, i + 2);
+
+	// Writing carries on after the newest sector, over the oldest
+	log_sectors(log, 100, 1);
+	ASSERT_EQ(log.read(1, 0, lines), sectors - 1);
+	EXPECT_EQ(lines[0].sequence, 3u);
+	ASSERT_EQ(log.read(2, 0, lines), 1u);
+	EXPECT_EQ(lines[0].sequence, 100u);
+}
+
+TEST(persistent_log, serial_comparison_survives_wrap)
+{
+	storage flash;
+	write_sector(flash, 0, make_header(0xFFFFFFFF, 7));
+	write_sector(flash, 1, make_header(0, 7));
+	write_sector(flash, 2, make_header(0xFFFFFFFE, 6));
+	write_sector(flash, 3, make_header(0xFFFFFFFD, 6));
+
+	persistent_log log(flash);
+	log.open();
+	// Serial 0 comes after 0xFFFFFFFF
+	EXPECT_EQ(log.previous_boot(), 7u);
+	EXPECT_EQ(log.boot(), 8u);
+
+	log_sectors(log, 0, 1);
+	sector_header header = read_header(flash, 2);
+	EXPECT_EQ(header.serial, 1u);
+	EXPECT_EQ(header.boot, 8u);
+	EXPECT_EQ(read_header(flash, 1).serial, 0u);
+}
+
+TEST(persistent_log, ignores_torn_and_foreign_headers)
+{
+	storage flash;
+	{
+		persistent_log log(flash);
+		log.open();
+		log_sectors(log, 0, 2);
+	}
+	// A later boot that was cut off while writing its header
+	sector_header torn = make_header(2, 2);
+	torn.check ^= 1;
+	write_sector(flash, 2, torn);
+	// Something else's data in the last sector
+	std::array<std::byte, sector_size> foreign;
+	foreign.fill(std::byte(0x5A));
+	flash.write(3, foreign);
+
+	persistent_log log(flash);
+	log.open();
+	EXPECT_EQ(log.previous_boot(), 1u);
+	EXPECT_EQ(log.boot(), 2u);
+	std::array<log_line, 4> lines;
+	EXPECT_EQ(log.read(1, 0, lines), 2u);
+	EXPECT_EQ(log.read(2, 0, lines), 0u);
+
+	// The torn sector is the next one written, with the serial it was
+	// meant to have
+	log_sectors(log, 100, 1);
+	sector_header header = read_header(flash, 2);
+	EXPECT_EQ(header.serial, 2u);
+	EXPECT_EQ(header.check, make_header(2, 2).check);
+}
+
+TEST(persistent_log, stops_at_a_torn_record)
+{
+	storage flash;
+	persistent_log log(flash);
+	log.open();
+	ASSERT_TRUE(log.append(make_line(0)));
+	ASSERT_TRUE(log.append(make_line(1)));
+	ASSERT_TRUE(log.flush());
+
+	// Give the second record a size no line can have
+	std::array<std::byte, sector_size> data;
+	flash.read(0, 0, data);
+	std::size_t second = sizeof(sector_header) + 14 + make_line(0).size;
+	data[second] = std::byte(0xF0);
+	flash.write(0, data);
+
+	std::array<log_line, 4> lines;
+	ASSERT_EQ(log.read(log.boot(), 0, lines), 1u);
+	EXPECT_EQ(lines[0].sequence, 0u);
+}
+
+TEST(persistent_log, reads_a_page_at_a_time)
+{
+	storage flash;
+	persistent_log log(flash);
+	log.open();
+	// Lines of the page span sectors
+	for (uint32_t sequence = 0; sequence < 10; ++sequence)
+	{
+		ASSERT_TRUE(log.append(make_line(sequence)));
+		if (sequence % 3 == 2)
+		{
+			ASSERT_TRUE(log.flush());
+		}
+	}
+	ASSERT_TRUE(log.flush());
+
+	std::array<log_line, 4> lines;
+	uint32_t expected = 0;
+	for (std::size_t first = 0;; first += lines.size())
+	{
+		std::size_t count = log.read(log.boot(), first, lines);
+		for (std::size_t i = 0; i < count; ++i)
+			EXPECT_EQ(lines[i].sequence, expected++);
+		if (count < lines.size())
+			break;
+	}
+	EXPECT_EQ(expected, 10u);
+	EXPECT_EQ(log.read(log.boot(), 10, lines), 0u);
+	EXPECT_EQ(log.read(log.boot(), 100, lines), 0u);
+}
+
+TEST(persistent_log, no_sectors_turns_persistence_off)
+{
+	pcrb::ram_log_storage<sector_size, 0> none;
+	persistent_log log(none);
+	log.open();
+	EXPECT_FALSE(log.enabled());
+	EXPECT_EQ(log.boot(), 1u);
+	EXPECT_EQ(log.previous_boot(), 0u);
+
+	// Well past a sector's worth, which used to divide by zero
+	for (uint32_t sequence = 0; sequence < 100; ++sequence)
+		EXPECT_TRUE(log.append(make_line(sequence)));
+	EXPECT_TRUE(log.flush());
+	EXPECT_EQ(none.writes(), 0u);
+
+	std::array<log_line, 4> lines;
+	EXPECT_EQ(log.read(1, 0, lines), 0u);
+}
+
+}
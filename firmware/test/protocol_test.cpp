@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+/// Decoding of log queries, and the text of the errors they get.
+
+#include <pcrb/protocol.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+using pcrb::log_level;
+using pcrb::response_status;
+
+// A log_query request body, with the optional fields after the sequence
+// number given as they go on the wire
+std::vector<std::byte> log_query(uint32_t since, std::string_view rest = {})
+{
+	std::vector<std::byte> body;
+	for (uint32_t field: {pcrb::request_magic, std::to_underlying(pcrb::opcode::log_query), since})
+	{
+		for (int shift = 24; shift >= 0; shift -= 8)
+			body.push_back(static_cast<std::byte>(field >> shift));
+	}
+	for (char c: rest)
+		body.push_back(static_cast<std::byte>(c));
+	return body;
+}
+
+TEST(protocol, decodes_a_full_log_query)
+{
+	auto body = log_query(42, std::string_view("\x02\x05" "wifi", 6));
+	auto request = pcrb::decode_request(body);
+	ASSERT_TRUE(request);
+	auto query = pcrb::decode_log_query(*request);
+	ASSERT_TRUE(query);
+	EXPECT_EQ(query->since, 42u);
+	EXPECT_EQ(query->filter.level, log_level::warning);
+	EXPECT_EQ(query->tail, 5u);
+	EXPECT_EQ(query->filter.text, "wifi");
+}
+
+TEST(protocol, optional_log_query_fields_default)
+{
+	auto body = log_query(7);
+	auto query = pcrb::decode_log_query(*pcrb::decode_request(body));
+	ASSERT_TRUE(query);
+	EXPECT_EQ(query->since, 7u);
+	EXPECT_EQ(query->filter.level, log_level::debug);
+	EXPECT_EQ(query->tail, 0u);
+	EXPECT_TRUE(query->filter.text.empty());
+}
+
+TEST(protocol, log_query_without_sequence_is_bad_size)
+{
+	auto body = log_query(0);
+	body.resize(10);
+	auto query = pcrb::decode_log_query(*pcrb::decode_request(body));
+	ASSERT_FALSE(query);
+	EXPECT_EQ(query.error().status, response_status::bad_size);
+	EXPECT_EQ(query.error().value, 10u);
+}
+
+TEST(protocol, unknown_log_level_is_bad_argument)
+{
+	auto body = log_query(0, "\x09");
+	auto query = pcrb::decode_log_query(*pcrb::decode_request(body));
+	ASSERT_FALSE(query);
+	EXPECT_EQ(query.error().status, response_status::bad_argument);
+	EXPECT_EQ(query.error().command, std::to_underlying(pcrb::opcode::log_query));
+	EXPECT_EQ(query.error().value, 9u);
+
+	std::array<char, pcrb::max_description_size> text;
+	EXPECT_EQ(pcrb::describe(query.error(), text), "Received bad network request, bad argument 9");
+}
+
+}
@@ -0,0 +1,293 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+/// Deadlines of request_handler against slowloris clients, which hold on to
+/// connections by sending requests a byte at a time, run on a fake lwIP.
+
+#include <pcrb/request_handler.h>
+#include <pcrb_host/lwip.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+using pcrb::request_callback;
+using pcrb::request_handler;
+using deadline = request_handler::deadline;
+namespace host = pcrb::host;
+
+// Deadlines of each phase, as in request_handler.cpp
+constexpr uint64_t setup_ms = 2000;
+constexpr uint64_t secure_setup_ms = 10000;
+constexpr uint64_t header_ms = 500;
+constexpr uint64_t body_ms = 1000;
+constexpr uint64_t idle_ms = 30000;
+// Deadlines are checked on this tick, so they expire up to a tick early
+constexpr uint64_t tick_ms = 100;
+
+std::size_t served = 0;
+
+void reply(request_handler& handler, std::span<const std::byte>)
+{
+	++served;
+	handler.send(std::string_view("ok"));
+}
+
+void reply_keep_alive(request_handler& handler, std::span<const std::byte> request)
+{
+	handler.set_options(request_handler::option_keep_alive);
+	reply(handler, request);
+}
+
+uint32_t deferred_id = 0;
+
+void defer(request_handler& handler, std::span<const std::byte>)
+{
+	++served;
+	deferred_id = handler.defer();
+}
+
+std::string request(std::size_t size)
+{
+	std::string result(2 + size, 'x');
+	result[0] = static_cast<char>(size >> 8);
+	result[1] = static_cast<char>(size);
+	return result;
+}
+
+std::string_view written(altcp_pcb *conn)
+{
+	return std::string_view(reinterpret_cast<const char*>(conn->written.data()), conn->written.size());
+}
+
+struct request_handler_test : testing::Test
+{
+	altcp_pcb* connect(request_callback callback = reply, bool secure = false)
+	{
+		altcp_pcb *conn = host::new_connection();
+		request_handler::start(conn, callback, secure);
+		connections.push_back(conn);
+		return conn;
+	}
+
+	uint32_t evictions(deadline phase) const
+	{
+		return request_handler::evictions(phase) - evictions_before[std::to_underlying(phase)];
+	}
+
+	void SetUp() override
+	{
+		served = 0;
+		for (std::size_t i = 0; i < evictions_before.size(); ++i)
+			evictions_before[i] = request_handler::evictions(static_cast<deadline>(i));
+	}
+
+	void TearDown() override
+	{
+		// Leaves every slot free for the next test
+		for (altcp_pcb *conn : connections)
+		{
+			if (!conn->closed)
+				host::reset(conn);
+		}
+		host::run_for(tick_ms);
+		EXPECT_EQ(host::live_pbufs(), 0u);
+	}
+
+	std::vector<altcp_pcb*> connections;
+	std::array<uint32_t, request_handler::deadline_count> evictions_before;
+};
+
+TEST_F(request_handler_test, serves_request)
+{
+	altcp_pcb *conn = connect();
+	EXPECT_FALSE(conn->nagle);
+	host::receive(conn, request(8));
+	EXPECT_EQ(served, 1u);
+	EXPECT_EQ(written(conn), "ok");
+	EXPECT_TRUE(conn->closed);
+	EXPECT_EQ(conn->recved, 10u);
+}
+
+TEST_F(request_handler_test, silent_client_evicted_after_setup)
+{
+	altcp_pcb *conn = connect();
+	host::run_for(setup_ms - tick_ms);
+	EXPECT_FALSE(conn->closed);
+	host::run_for(tick_ms);
+	EXPECT_TRUE(conn->closed);
+	EXPECT_EQ(evictions(deadline::setup), 1u);
+	EXPECT_NE(written(conn).find("timeout"), std::string_view::npos);
+}
+
+TEST_F(request_handler_test, tls_gets_longer_setup)
+{
+	altcp_pcb *conn = connect(reply, true);
+	host::run_for(secure_setup_ms - tick_ms);
+	EXPECT_FALSE(conn->closed);
+	host::run_for(tick_ms);
+	EXPECT_TRUE(conn->closed);
+	EXPECT_EQ(evictions(deadline::setup), 1u);
+}
+
+TEST_F(request_handler_test, trickled_length_evicted)
+{
+	altcp_pcb *conn = connect();
+	host::receive(conn, std::string_view("\x00", 1));
+	host::run_for(header_ms - tick_ms);
+	EXPECT_FALSE(conn->closed);
+	host::run_for(tick_ms);
+	EXPECT_TRUE(conn->closed);
+	EXPECT_EQ(evictions(deadline::header), 1u);
+	EXPECT_EQ(served, 0u);
+}
+
+TEST_F(request_handler_test, trickled_body_evicted_despite_progress)
+{
+	altcp_pcb *conn = connect();
+	std::string data = request(request_handler::max_request_size);
+	host::receive(conn, std::string_view(data).substr(0, 2));
+
+	// A byte every 50 ms keeps coming, well within any per-byte timeout,
+	// and would take over 12 s to finish
+	uint64_t elapsed = 0;
+	std::size_t sent = 2;
+	while (!conn->closed && sent < data.size())
+	{
+		host::receive(conn, std::string_view(data).substr(sent++, 1));
+		host::run_for(50);
+		elapsed += 50;
+	}
+	EXPECT_TRUE(conn->closed);
+	EXPECT_GT(elapsed, body_ms - tick_ms);
+	EXPECT_LE(elapsed, body_ms);
+	EXPECT_EQ(evictions(deadline::body), 1u);
+	EXPECT_EQ(served, 0u);
+	EXPECT_NE(written(conn).find("timeout"), std::string_view::npos);
+}
+
+TEST_F(request_handler_test, fast_client_served_while_slow_clients_held)
+{
+	// Every connection slot but one is held by a client trickling in a
+	// request
+	std::vector<altcp_pcb*> slow;
+	for (std::size_t i = 0; i + 1 < pcrb::max_connections; ++i)
+	{
+		slow.push_back(connect());
+		host::receive(slow.back(), request(100).substr(0, 10));
+	}
+
+	altcp_pcb *fast = connect();
+	host::receive(fast, request(8));
+	EXPECT_EQ(served, 1u);
+	EXPECT_EQ(written(fast), "ok");
+	EXPECT_TRUE(std::ranges::none_of(slow, &altcp_pcb::closed));
+
+	// And the slow ones give their slots back on their own
+	host::run_for(body_ms);
+	EXPECT_TRUE(std::ranges::all_of(slow, &altcp_pcb::closed));
+	EXPECT_EQ(evictions(deadline::body), slow.size());
+}
+
+TEST_F(request_handler_test, slots_freed_after_eviction)
+{
+	for (std::size_t i = 0; i < pcrb::max_connections; ++i)
+		connect();
+	// No room for more
+	altcp_pcb *extra = connect();
+	EXPECT_TRUE(extra->aborted);
+
+	host::run_for(setup_ms);
+	EXPECT_EQ(evictions(deadline::setup), pcrb::max_connections);
+
+	altcp_pcb *later = connect();
+	EXPECT_FALSE(later->closed);
+	host::receive(later, request(8));
+	EXPECT_EQ(written(later), "ok");
+}
+
+TEST_F(request_handler_test, idle_keep_alive_closed_quietly)
+{
+	altcp_pcb *conn = connect(reply_keep_alive);
+	host::receive(conn, request(8));
+	EXPECT_FALSE(conn->closed);
+	std::size_t replied = conn->written.size();
+
+	host::run_for(idle_ms - tick_ms);
+	EXPECT_FALSE(conn->closed);
+	host::run_for(tick_ms);
+	EXPECT_TRUE(conn->closed);
+	EXPECT_EQ(evictions(deadline::idle), 1u);
+	// Nothing to reply to between requests
+	EXPECT_EQ(conn->written.size(), replied);
+}
+
+TEST_F(request_handler_test, each_request_gets_its_own_deadline)
+{
+	altcp_pcb *conn = connect(reply_keep_alive);
+	// Requests finishing in time keep the connection going well past any
+	// single deadline
+	for (int i = 0; i < 10; ++i)
+	{
+		std::string data = request(8);
+		host::receive(conn, std::string_view(data).substr(0, 2));
+		host::run_for(body_ms - 2 * tick_ms);
+		host::receive(conn, std::string_view(data).substr(2));
+		host::acknowledge(conn);
+	}
+	EXPECT_FALSE(conn->closed);
+	EXPECT_EQ(served, 10u);
+	EXPECT_EQ(evictions(deadline::body), 0u);
+}
+
+TEST_F(request_handler_test, client_with_full_window_evicted)
+{
+	// A client that never reads its replies leaves no room for the next
+	// one, which counts against the body deadline
+	altcp_pcb *conn = connect(reply_keep_alive);
+	conn->send_buffer = request_handler::max_reply_size + 1;
+	host::receive(conn, request(8));
+	host::receive(conn, request(8));
+	EXPECT_EQ(served, 1u);
+	host::run_for(body_ms);
+	EXPECT_TRUE(conn->closed);
+	EXPECT_EQ(evictions(deadline::body), 1u);
+}
+
+TEST_F(request_handler_test, deferred_request_has_no_deadline)
+{
+	altcp_pcb *conn = connect(defer);
+	host::receive(conn, request(8));
+	EXPECT_EQ(served, 1u);
+	// As long as a batch holding the switch takes
+	host::run_for(10 * body_ms);
+	EXPECT_FALSE(conn->closed);
+
+	request_handler *handler = request_handler::find(deferred_id);
+	ASSERT_NE(handler, nullptr);
+	handler->send(std::string_view("done"));
+	handler->resume();
+	EXPECT_EQ(written(conn), "done");
+	EXPECT_TRUE(conn->closed);
+	EXPECT_EQ(request_handler::find(deferred_id), nullptr);
+}
+
+TEST_F(request_handler_test, deferred_connection_reset_is_forgotten)
+{
+	altcp_pcb *conn = connect(defer);
+	host::receive(conn, request(8));
+	host::reset(conn);
+	EXPECT_EQ(request_handler::find(deferred_id), nullptr);
+}
+
+}
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+// SPDX-FileCopyrightText: Gabriel Marcano, 2026
+/// @file
+
+#include <pcrb/timer_wheel.h>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+
+using wheel = pcrb::timer_wheel<8>;
+
+// Deadline recording the tick it expired on
+struct deadline
+{
+	wheel::entry entry;
+	const uint32_t *now = nullptr;
+	std::vector<uint32_t> expired;
+
+	deadline()
+	{
+		entry.expire = [](void *context)
+		{
+			deadline *self = static_cast<deadline*>(context);
+			self->expired.push_back(*self->now);
+		};
+		entry.context = this;
+	}
+};
+
+struct timer_wheel_test : testing::Test
+{
+	void advance(uint32_t ticks)
+	{
+		for (uint32_t i = 0; i < ticks; ++i)
+		{
+			++now;
+			wheel_.advance();
+		}
+	}
+
+	wheel wheel_;
+	uint32_t now = 0;
+};
+
+TEST_F(timer_wheel_test, expires_on_its_tick)
+{
+	deadline d;
+	d.now = &now;
+	wheel_.schedule(d.entry, 3);
+	EXPECT_TRUE(d.entry.armed());
+	advance(2);
+	EXPECT_TRUE(d.expired.empty());
+	advance(1);
+	EXPECT_EQ(d.expired, std::vector<uint32_t>{3});
+	EXPECT_FALSE(d.entry.armed());
+	advance(20);
+	EXPECT_EQ(d.expired.size(), 1u);
+}
+
+TEST_F(timer_wheel_test, beyond_one_turn_waits_for_later_turns)
+{
+	deadline d;
+	d.now = &now;
+	// Shares a slot with tick 3, and must not expire there
+	wheel_.schedule(d.entry, 8 * 2 + 3);
+	advance(18);
+	EXPECT_TRUE(d.expired.empty());
+	advance(1);
+	EXPECT_EQ(d.expired, std::vector<uint32_t>{19});
+}
+
+TEST_F(timer_wheel_test, cancelled_never_expires)
+{
+	deadline d;
+	d.now = &now;
+	wheel_.schedule(d.entry, 2);
+	wheel_.cancel(d.entry);
+	EXPECT_FALSE(d.entry.armed());
+	advance(10);
+	EXPECT_TRUE(d.expired.empty());
+	// Cancelling again is harmless
+	wheel_.cancel(d.entry);
+}
+
+TEST_F(timer_wheel_test, reschedule_replaces_deadline)
+{
+	deadline d;
+	d.now = &now;
+	wheel_.schedule(d.entry, 2);
+	advance(1);
+	// As a connection moving on to its next phase does
+	wheel_.schedule(d.entry, 5);
+	advance(5);
+	EXPECT_EQ(d.expired, std::vector<uint32_t>{6});
+}
+
+TEST_F(timer_wheel_test, cancel_from_middle_of_slot)
+{
+	std::array<deadline, 3> d;
+	for (auto& one : d)
+	{
+		one.now = &now;
+		wheel_.schedule(one.entry, 4);
+	}
+	wheel_.cancel(d[1].entry);
+	advance(4);
+	EXPECT_EQ(d[0].expired.size(), 1u);
+	EXPECT_TRUE(d[1].expired.empty());
+	EXPECT_EQ(d[2].expired.size(), 1u);
+}
+
+TEST_F(timer_wheel_test, expire_may_reschedule_itself)
+{
+	struct periodic
+	{
+		wheel *wheel_;
+		wheel::entry entry;
+		uint32_t count = 0;
+	} p;
+	p.wheel_ = &wheel_;
+	p.entry.context = &p;
+	p.entry.expire = [](void *context)
+	{
+		periodic *self = static_cast<periodic*>(context);
+		++self->count;
+		self->wheel_->schedule(self->entry, 2);
+	};
+	wheel_.schedule(p.entry, 2);
+	advance(10);
+	EXPECT_EQ(p.count, 5u);
+}
+
+// A slowloris client pushes its deadline back with every byte only if the
+// deadline is counted from the last byte. Deadlines counted from the start
+// of the phase expire no matter how steadily the client trickles in.
+TEST_F(timer_wheel_test, phase_deadline_ignores_progress)
+{
+	deadline d;
+	d.now = &now;
+	wheel_.schedule(d.entry, 10);
+	for (int i = 0; i < 9; ++i)
+	{
+		// A byte arrives every tick, and does not touch the deadline
+		advance(1);
+		EXPECT_TRUE(d.expired.empty());
+	}
+	advance(1);
+	EXPECT_EQ(d.expired, std::vector<uint32_t>{10});
+}
+
+}
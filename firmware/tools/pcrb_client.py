@@ -0,0 +1,315 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-or-later OR LGPL-2.1-or-later
+# SPDX-FileCopyrightText: Gabriel Marcano, 2026
+
+"""Host-side client for the PC remote button, for measuring it over the
+network.
+
+Requests are sent exactly as other clients send them: a 2 byte big-endian
+length followed by the request body over TCP, see request_handler.h and
+protocol.h. If a key is given, requests are wrapped in the authenticated
+envelope of auth.h.
+"""
+
+import argparse
+import hashlib
+import hmac
+import os
+import socket
+import ssl
+import statistics
+import struct
+import threading
+import time
+
+REQUEST_MAGIC = 0x416E614D
+AUTHENTICATED_MAGIC = 0x416E6141
+SERVER_PORT = 48686
+TLS_PORT = 48687
+
+SENSE = 3
+SESSION_OPTIONS = 4
+
+OPTION_KEEP_ALIVE = 1 << 0
+OPTION_BINARY = 1 << 1
+
+
+class Signer:
+    """Wraps request bodies in the authenticated envelope, if there is a
+    key."""
+
+    def __init__(self, key):
+        self.key = key.encode() if key else None
+        # Counters must keep increasing across runs, so they start from the
+        # time
+        self.counter = time.time_ns() // 1000
+
+    def wrap(self, body):
+        if not self.key:
+            return body
+        self.counter += 1
+        signed = struct.pack(">IQ", AUTHENTICATED_MAGIC, self.counter) + body
+        return signed + hmac.new(self.key, signed, hashlib.sha256).digest()
+
+
+def request_body(code, argument=None):
+    body = struct.pack(">II", REQUEST_MAGIC, code)
+    if argument is not None:
+        body += struct.pack(">I", argument)
+    return body
+
+
+def receive_exactly(sock, size):
+    data = b""
+    while len(data) < size:
+        chunk = sock.recv(size - len(data))
+        if not chunk:
+            raise ConnectionError("connection closed by the board")
+        data += chunk
+    return data
+
+
+class Session:
+    """Keep-alive connection with binary replies."""
+
+    def __init__(self, host, port, signer, timeout):
+        self.signer = signer
+        self.sock = socket.create_connection((host, port), timeout=timeout)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        self.request(SESSION_OPTIONS, OPTION_KEEP_ALIVE | OPTION_BINARY)
+
+    def request(self, code, argument=None):
+        body = self.signer.wrap(request_body(code, argument))
+        self.sock.sendall(struct.pack(">H", len(body)) + body)
+        (size,) = struct.unpack(">H", receive_exactly(self.sock, 2))
+        reply = receive_exactly(self.sock, size)
+        if reply[0] != 0:
+            raise RuntimeError(f"command {code} failed with status {reply[0]}")
+        return reply
+
+    def close(self):
+        self.sock.close()
+
+
+def percentile(samples, fraction):
+    ordered = sorted(samples)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def report(name, samples):
+    if not samples:
+        print(f"{name}: no replies")
+        return
+    print(f"{name}: {len(samples)} requests, "
+          f"p50 {percentile(samples, 0.5) * 1000:.2f} ms, "
+          f"p90 {percentile(samples, 0.9) * 1000:.2f} ms, "
+          f"p99 {percentile(samples, 0.99) * 1000:.2f} ms, "
+          f"max {max(samples) * 1000:.2f} ms, "
+          f"mean {statistics.fmean(samples) * 1000:.2f} ms")
+
+
+def time_requests(args, signer):
+    """Times sense requests on a keep-alive connection, one at a time."""
+    session = Session(args.host, args.port, signer, args.timeout)
+    samples = []
+    try:
+        for _ in range(args.requests):
+            start = time.perf_counter()
+            session.request(SENSE)
+            samples.append(time.perf_counter() - start)
+    finally:
+        session.close()
+    return samples
+
+
+class StalledClient(threading.Thread):
+    """Client that sends the first byte of a request and then nothing, like
+    a client on a link that went away. It connects again whenever the board
+    drops it, so there is always one holding a connection."""
+
+    def __init__(self, host, port, stop):
+        super().__init__(daemon=True)
+        self.host = host
+        self.port = port
+        self.stop = stop
+        self.connections = 0
+
+    def run(self):
+        while not self.stop.is_set():
+            try:
+                with socket.create_connection((self.host, self.port), timeout=5) as sock:
+                    self.connections += 1
+                    sock.sendall(b"\x00")
+                    # Returns once the board gives up on the connection
+                    while not self.stop.is_set():
+                        try:
+                            if not sock.recv(64):
+                                break
+                        except socket.timeout:
+                            continue
+            except OSError:
+                self.stop.wait(0.1)
+
+
+def latency(args, signer):
+    """Fast client latency, alone and with stalled clients connected."""
+    time_requests(args, signer)
+    report("alone", time_requests(args, signer))
+
+    stop = threading.Event()
+    stalled = [StalledClient(args.host, args.port, stop) for _ in range(args.stalled)]
+    for client in stalled:
+        client.start()
+    # Let them get their connections in first
+    time.sleep(0.5)
+    try:
+        samples = time_requests(args, signer)
+    finally:
+        stop.set()
+    report(f"with {args.stalled} stalled", samples)
+    print(f"stalled clients connected {sum(client.connections for client in stalled)} times")
+
+
+def udp_request(sock, signer, code, argument=None):
+    """Sends a single datagram request, and waits for its reply."""
+    nonce = os.urandom(4)
+    sock.send(nonce + signer.wrap(request_body(code, argument)))
+    while True:
+        reply = sock.recv(64)
+        # Replies to earlier requests that timed out are skipped
+        if reply[:4] == nonce:
+            return reply[4:]
+
+
+def tcp_request(args, signer, code, argument=None):
+    """Sends a request over a new connection, as clients without keep-alive
+    do, and waits for the board to close it."""
+    body = signer.wrap(request_body(code, argument))
+    with socket.create_connection((args.host, args.port), timeout=args.timeout) as sock:
+        sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        sock.sendall(struct.pack(">H", len(body)) + body)
+        reply = b""
+        while chunk := sock.recv(256):
+            reply += chunk
+    return reply
+
+
+def rtt(args, signer):
+    """Round trip time of sense requests over UDP and over TCP."""
+    udp = socket.socket(socket.AF_INET6 if ":" in args.host else socket.AF_INET, socket.SOCK_DGRAM)
+    udp.settimeout(args.timeout)
+    udp.connect((args.host, args.port))
+    samples = []
+    lost = 0
+    for _ in range(args.requests):
+        start = time.perf_counter()
+        try:
+            reply = udp_request(udp, signer, SENSE)
+        except socket.timeout:
+            lost += 1
+            continue
+        samples.append(time.perf_counter() - start)
+        if reply[0] != 0:
+            raise RuntimeError(f"udp request failed with status {reply[0]}")
+    udp.close()
+    report("udp", samples)
+    if lost:
+        print(f"udp: {lost} requests lost")
+
+    samples = []
+    for _ in range(args.requests):
+        start = time.perf_counter()
+        tcp_request(args, signer, SENSE)
+        samples.append(time.perf_counter() - start)
+    report("tcp, connection per request", samples)
+
+    report("tcp, keep-alive", time_requests(args, signer))
+
+
+def tls_context(args):
+    """Client context for the TLS server. The board only speaks TLS 1.2, where
+    sessions are resumed from tickets."""
+    context = ssl.create_default_context(cafile=args.cafile)
+    context.maximum_version = ssl.TLSVersion.TLSv1_2
+    if not args.cafile:
+        # The board usually has a self-signed certificate
+        context.check_hostname = False
+        context.verify_mode = ssl.CERT_NONE
+    return context
+
+
+def tls_request(args, context, signer, session):
+    """Connects over TLS, resuming session if given, and sends a sense
+    request over the connection.
+
+    Returns the handshake time, the session to resume next, and whether this
+    one was resumed."""
+    with socket.create_connection((args.host, args.tls_port), timeout=args.timeout) as raw:
+        raw.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        with context.wrap_socket(raw, server_hostname=args.host, session=session,
+                                 do_handshake_on_connect=False) as sock:
+            start = time.perf_counter()
+            sock.do_handshake()
+            elapsed = time.perf_counter() - start
+            body = signer.wrap(request_body(SENSE))
+            sock.sendall(struct.pack(">H", len(body)) + body)
+            (size,) = struct.unpack(">H", receive_exactly(sock, 2))
+            reply = receive_exactly(sock, size)
+            if reply[0] != 0:
+                raise RuntimeError(f"tls request failed with status {reply[0]}")
+            return elapsed, sock.session, sock.session_reused
+
+
+def tls(args, signer):
+    """Handshake time of full and resumed TLS sessions."""
+    context = tls_context(args)
+    full = []
+    resumed = []
+    not_resumed = 0
+    for _ in range(args.requests):
+        elapsed, session, _ = tls_request(args, context, signer, None)
+        full.append(elapsed)
+        elapsed, _, reused = tls_request(args, context, signer, session)
+        if reused:
+            resumed.append(elapsed)
+        else:
+            not_resumed += 1
+    report("full handshake", full)
+    report("resumed handshake", resumed)
+    if not_resumed:
+        print(f"{not_resumed} sessions were not resumed")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("host", help="address of the board")
+    parser.add_argument("--port", type=int, default=SERVER_PORT)
+    parser.add_argument("--key", help="AUTH_KEY of the board, if it has one")
+    parser.add_argument("--timeout", type=float, default=5.0, help="seconds to wait for a reply")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    latency_parser = commands.add_parser("latency",
+        help="p50/p99 latency of a fast client, alone and next to stalled clients")
+    latency_parser.add_argument("--requests", type=int, default=1000)
+    latency_parser.add_argument("--stalled", type=int, default=1,
+        help="stalled clients to hold connections open")
+    latency_parser.set_defaults(run=latency)
+
+    rtt_parser = commands.add_parser("rtt",
+        help="round trip time over UDP, and over TCP with and without keep-alive")
+    rtt_parser.add_argument("--requests", type=int, default=200)
+    rtt_parser.set_defaults(run=rtt)
+
+    tls_parser = commands.add_parser("tls",
+        help="handshake time of full and resumed TLS sessions")
+    tls_parser.add_argument("--requests", type=int, default=20)
+    tls_parser.add_argument("--tls-port", type=int, default=TLS_PORT)
+    tls_parser.add_argument("--cafile", help="certificate to check the board's against")
+    tls_parser.set_defaults(run=tls)
+
+    args = parser.parse_args()
+    args.run(args, Signer(args.key))
+
+
+if __name__ == "__main__":
+    main()